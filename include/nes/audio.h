@@ -4,21 +4,22 @@
 #include <array>
 
 namespace nes {
+class Scheduler;
+
 class APU {
 public:
     APU();
     uint8_t read_register(uint16_t addr);
     void write_register(uint16_t addr, uint8_t value);
-    void step(); // Advance 1 APU cycle
+    void step(); // Advance 1 APU cycle (channel timers only)
+    int clock_frame_sequencer(); // ApuFrame event: runs one sequencer step, returns CPU cycles to the next
+    bool irq_pending() const noexcept { return state_.frame_irq_ || state_.dmc_.irq_; }
+    void attach_scheduler(Scheduler* scheduler) noexcept { scheduler_ = scheduler; }
     void generate_audio(int samples, std::vector<int16_t>& buffer); // Generate PCM samples
     void reset();
 
 private:
-    // Frame counter
-    uint8_t frame_counter_;
-    uint8_t frame_mode_;
-    int frame_step_;
-    bool frame_irq_;
+    Scheduler* scheduler_ = nullptr;
 
     // Channels
     struct Pulse {
@@ -31,7 +32,7 @@ private:
         void step_sweep();
         void step_length();
         uint8_t output();
-    } pulse1_, pulse2_;
+    };
 
     struct Triangle {
         uint8_t linear_, length_;
@@ -42,7 +43,7 @@ private:
         void step_linear();
         void step_length();
         uint8_t output();
-    } triangle_;
+    };
 
     struct Noise {
         uint8_t envelope_, length_;
@@ -54,7 +55,7 @@ private:
         void step_envelope();
         void step_length();
         uint8_t output();
-    } noise_;
+    };
 
     struct DMC {
         uint8_t direct_load_, sample_address_, sample_length_;
@@ -63,7 +64,31 @@ private:
         bool enabled_, loop_, irq_enable_, irq_;
         void step_timer();
         uint8_t output();
-    } dmc_;
+    };
+
+public:
+    // Frame counter and channel state, POD so save states can copy it in one go
+    struct State {
+        // Frame counter
+        uint8_t frame_counter_;
+        uint8_t frame_mode_;
+        int frame_step_;
+        bool frame_irq_;
+        bool irq_inhibit_;
+
+        Pulse pulse1_, pulse2_;
+        Triangle triangle_;
+        Noise noise_;
+        DMC dmc_;
+    };
+    const State& state() const noexcept { return state_; }
+    void set_state(const State& state) noexcept { state_ = state; } // assumes valid_state(state)
+    static bool valid_state(const State& state) noexcept; // frame step, duties and pulse steps index tables
+
+private:
+    State state_;
+    void quarter_frame();
+    void half_frame();
 
     // Mixer
     float mix_pulse(float p1, float p2);
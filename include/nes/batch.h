@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "nes/metrics.h"
+
+namespace nes {
+struct BatchJob {
+    std::string rom_path;
+    uint64_t frames = 60;
+    std::vector<uint8_t> inputs;   // controller 1 buttons per frame (a one-port movie); released after the last
+    std::string video_path;        // if set, every frame goes to this Y4M and the audio to video_path + ".wav"
+    std::string hash_log_path;     // if set, per-frame video/audio hashes are written here
+    std::string golden_path;       // if set, the hashes are checked against this log
+};
+
+struct BatchResult {
+    uint64_t frames = 0;           // frames actually completed
+    uint64_t frame_hash = 0;       // XXH64 over the final RGB frame
+    std::vector<uint8_t> ram;      // internal RAM at the end of the run
+    double load_ms = 0;
+    double run_ms = 0;
+    int worker = -1;
+    uint64_t video_frames_dropped = 0; // repeated in the video because the writer fell behind
+    int64_t divergent_frame = -1;  // first frame differing from the golden log; with a hash log, its
+                                   // image is saved as hash_log_path + ".frameN.ppm"
+    std::string error;             // empty on success
+};
+
+struct BatchOptions {
+    unsigned workers = 0;          // 0: one per online CPU
+    bool pin_threads = true;       // pin worker i to the i-th CPU, CPUs ordered node by node
+};
+
+struct BatchStats {
+    uint64_t frames = 0;
+    double wall_seconds = 0;
+    double frames_per_second = 0;
+    uint64_t steals = 0;
+    MetricsSnapshot metrics;       // summed over the workers' emulators
+};
+
+// Runs independent jobs on a pool of worker threads. Jobs are dealt round-robin into per-worker
+// queues; a worker drains its own queue from the back and, once empty, steals from the front of the
+// others, so long jobs landing on one worker do not leave the rest idle. Each worker builds its
+// emulator on its own (pinned) thread, so first-touch places instance memory on the local NUMA node.
+// ROM files are read and parsed once up front and shared by every job that names them; each worker
+// reloads one emulator in place per job and renders only the final frame.
+class BatchRunner {
+public:
+    explicit BatchRunner(const BatchOptions& options = BatchOptions());
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs); // results in job order
+    const BatchStats& stats() const noexcept { return stats_; }
+    unsigned workers() const noexcept { return workers_; }
+
+private:
+    BatchOptions options_;
+    unsigned workers_;
+    std::vector<int> cpu_order_;
+    BatchStats stats_;
+};
+
+std::vector<int> numa_cpu_order(); // online CPUs grouped by NUMA node, from /sys; flat order if unavailable
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace nes {
+constexpr size_t cow_page_size = 0x400; // 1 KB: one nametable, one CHR bank
+
+// Byte region split into pages that forked instances share until one side writes.
+// Reads go through a flat page-pointer table; a write to a page that may still be shared copies it
+// first. Fresh regions point every page at one static zero page, so untouched memory (e.g. CHR-RAM
+// on a CHR-ROM cart) costs nothing. Page lifetimes ride on shared_ptr's atomic count, which makes
+// instances that share pages safe to run on separate threads; forking itself must happen on the
+// thread that owns the source.
+template <size_t Size, size_t PageSize = cow_page_size>
+class CowMemory {
+    static_assert(Size % PageSize == 0, "region must be a whole number of pages");
+
+public:
+    static constexpr size_t page_count = Size / PageSize;
+
+    CowMemory() noexcept { fill_shared(zero_page()); }
+    CowMemory(const CowMemory& other) noexcept { share_from(other); }
+    CowMemory& operator=(const CowMemory& other) noexcept { if (this != &other) share_from(other); return *this; }
+
+    static constexpr size_t size() noexcept { return Size; }
+    uint8_t read(size_t addr) const noexcept { return data_[addr / PageSize][addr % PageSize]; }
+    void write(size_t addr, uint8_t value) { writable_page(addr / PageSize)[addr % PageSize] = value; }
+
+    const uint8_t* page(size_t index) const noexcept { return data_[index]; }
+    uint8_t* writable_page(size_t index) {
+        if (!owned_[index]) make_private(index);
+        return data_[index];
+    }
+
+    void copy_to(uint8_t* dst) const noexcept {
+        for (size_t i = 0; i < page_count; ++i) std::memcpy(dst + i * PageSize, data_[i], PageSize);
+    }
+    void copy_from(const uint8_t* src) {
+        // Unchanged pages stay shared, so restoring a snapshot into a fork does not unshare it
+        for (size_t i = 0; i < page_count; ++i) {
+            const uint8_t* page_src = src + i * PageSize;
+            if (std::memcmp(data_[i], page_src, PageSize) != 0) std::memcpy(writable_page(i), page_src, PageSize);
+        }
+    }
+    // Become equal to `other` by sharing its pages; pages both sides already share are skipped (a write
+    // on either side would have given it a private copy, so equal pointers mean equal bytes). Returns
+    // the pages re-pointed.
+    size_t sync_from(const CowMemory& other) noexcept {
+        size_t changed = 0;
+        for (size_t i = 0; i < page_count; ++i) {
+            if (data_[i] == other.data_[i]) continue;
+            pages_[i] = other.pages_[i];
+            data_[i] = other.data_[i];
+            owned_[i] = other.owned_[i] = false;
+            ++changed;
+        }
+        return changed;
+    }
+    void clear() noexcept { fill_shared(zero_page()); }
+    size_t private_pages() const noexcept { // pages that hold their own copy rather than the zero page
+        size_t count = 0;
+        for (size_t i = 0; i < page_count; ++i) count += data_[i] != zero_page()->bytes;
+        return count;
+    }
+
+private:
+    struct Page { alignas(64) uint8_t bytes[PageSize]; };
+
+    std::array<std::shared_ptr<Page>, page_count> pages_;
+    std::array<uint8_t*, page_count> data_;
+    mutable std::array<bool, page_count> owned_; // known sole owner; forking clears it on both sides
+
+    static const std::shared_ptr<Page>& zero_page() {
+        static const std::shared_ptr<Page> zero = std::make_shared<Page>(); // value-initialized
+        return zero;
+    }
+
+    void fill_shared(const std::shared_ptr<Page>& page) noexcept {
+        for (size_t i = 0; i < page_count; ++i) { pages_[i] = page; data_[i] = page->bytes; owned_[i] = false; }
+    }
+
+    void share_from(const CowMemory& other) noexcept {
+        pages_ = other.pages_;
+        data_ = other.data_;
+        owned_.fill(false);
+        other.owned_.fill(false);
+    }
+
+    void make_private(size_t index) {
+        if (pages_[index].use_count() == 1) {
+            // Every other holder has already copied away; pair with their release of the page
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } else {
+            auto copy = std::make_shared<Page>();
+            std::memcpy(copy->bytes, data_[index], PageSize);
+            pages_[index] = std::move(copy);
+            data_[index] = pages_[index]->bytes;
+        }
+        owned_[index] = true;
+    }
+};
+
+// Same interface as CowMemory over a plain inline array, for regions small and hot enough that copying
+// them on a fork is cheaper than a page-table hop on every access (the 2 KB of internal RAM).
+template <size_t Size>
+class InlineMemory {
+public:
+    static constexpr size_t page_count = Size / cow_page_size;
+
+    static constexpr size_t size() noexcept { return Size; }
+    uint8_t read(size_t addr) const noexcept { return bytes_[addr]; }
+    void write(size_t addr, uint8_t value) noexcept { bytes_[addr] = value; }
+
+    const uint8_t* page(size_t index) const noexcept { return bytes_.data() + index * cow_page_size; }
+    uint8_t* writable_page(size_t index) noexcept { return bytes_.data() + index * cow_page_size; }
+
+    void copy_to(uint8_t* dst) const noexcept { std::memcpy(dst, bytes_.data(), Size); }
+    void copy_from(const uint8_t* src) noexcept { std::memcpy(bytes_.data(), src, Size); }
+    size_t sync_from(const InlineMemory& other) noexcept {
+        size_t changed = 0;
+        for (size_t i = 0; i < page_count; ++i) {
+            if (std::memcmp(page(i), other.page(i), cow_page_size) == 0) continue;
+            std::memcpy(writable_page(i), other.page(i), cow_page_size);
+            ++changed;
+        }
+        return changed;
+    }
+    void clear() noexcept { bytes_.fill(0); }
+    size_t private_pages() const noexcept { return 0; } // nothing on the heap; counted with the owner
+
+private:
+    alignas(64) std::array<uint8_t, Size> bytes_{};
+};
+}
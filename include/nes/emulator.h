@@ -4,28 +4,184 @@
 #include "nes/cpu.h"
 #include "nes/ppu.h"
 #include "nes/apu.h"
+#include "nes/nsf.h"
+#include "nes/scheduler.h"
+#include "nes/input.h"
+#include "nes/trace.h"
+#include "nes/metrics.h"
+#include "nes/frame_pacer.h"
+#include <chrono>
 #include <memory>
 #include <vector>
+#include <array>
+#include <string>
 
 namespace nes {
 
+// Result of a batch run; the run entry points report problems here instead of throwing
+struct RunStatus {
+    uint64_t cycles = 0;          // CPU cycles actually run
+    bool frame_completed = false;
+    bool breakpoint_hit = false;  // stopped before executing an instruction at a breakpoint
+    bool error = false;           // nothing loaded
+    bool frame_skipped = false;   // paced runs: emulated without rendering (catching up, or turbo)
+};
+
+struct RunAheadStats {
+    uint64_t frames = 0;
+    double last_overhead_us = 0;     // snapshot + speculative frames + restore, per host frame
+    double average_overhead_us = 0;
+};
+
 class Emulator {
 public:
+    static constexpr uint32_t audio_sample_rate = 44100;
+
     Emulator();
+    ~Emulator();
+    Emulator(const Emulator&) = delete; // components hold pointers into scheduler_; use clone()
+    Emulator& operator=(const Emulator&) = delete;
+
+    // Cheap fork for tree search and parallel exploration: the ROM and NSF image are shared, VRAM,
+    // CHR-RAM and PRG-RAM are shared page by page until either side writes, everything else (including
+    // the 2 KB of internal RAM) is copied.
+    // Forks may run on separate threads; clone() itself must not race with this instance running.
+    std::unique_ptr<Emulator> clone() const;
     void load_rom_bytes(const std::vector<uint8_t>& data);
+    void load_rom(std::shared_ptr<const ROM> rom); // share one parsed ROM; reloading reuses the core block in place (unloaded if that throws)
+    void load_nsf_bytes(const std::vector<uint8_t>& data); // implies audio-only mode
     void reset();
-    int step();
+    int step(); // one CPU instruction, then any events that fell due
+    void advance_clock(uint64_t cycles); // CPU cycles run outside this instance (lockstep lanes), then due events
+    RunStatus run_frame() noexcept;               // up to and including the next frame end
+    RunStatus run_cycles(uint64_t cycles) noexcept;
+
+    static constexpr size_t max_breakpoints = 8;
+    bool add_breakpoint(uint16_t pc) noexcept;   // false when all slots are taken
+    void clear_breakpoints() noexcept { breakpoint_count_ = 0; }
     CPU6502& cpu() { return *cpu_; }
+    Memory& memory() { return *mem_; }
     PPU& ppu() { return *ppu_; }
     APU& apu() { return *apu_; }
+    const Scheduler& scheduler() const noexcept { return scheduler_; }
+    uint64_t frame_count() const noexcept { return frame_count_; }
+    bool loaded() const noexcept { return cpu_ != nullptr; } // a ROM or NSF image is in
+
+    // Controllers: the provider (not owned, may be null) is polled at the start of every frame and
+    // latched into both pads; set_buttons() overrides a pad until the next poll
+    void set_input_provider(InputProvider* provider) noexcept { input_ = provider; }
+    InputProvider* input_provider() const noexcept { return input_; }
+    void set_buttons(int port, uint8_t buttons) noexcept;
+
+    // Execution trace: every instruction run while a buffer is attached (not owned, not carried over by
+    // clone()) is recorded before it executes. Detached, the run loop pays one branch per batch.
+    void set_trace(TraceBuffer* buffer) noexcept { trace_ = buffer; }
+    TraceBuffer* trace() const noexcept { return trace_; }
+
+    // Profiler hooks in the CPU and memory map (not owned; survives reloads, not carried over by clone()).
+    // The counters only run in builds with NES_ENABLE_PROFILER.
+    void set_profiler(Profiler* profiler) noexcept;
+
+    // Runtime counters, published once per run call; safe to read from any thread while this one runs.
+    // Not carried over by clone() or reset by reloads.
+    MetricsSnapshot metrics() const noexcept { return metrics_.snapshot(); }
+    void clear_metrics() noexcept { metrics_.clear(); }
+
+    // Headless instances (rendering off) never allocate a frame buffer; the PPU still keeps timing and flags
+    void set_rendering(bool enabled) noexcept;
+    bool rendering() const noexcept { return rendering_; }
+    size_t memory_footprint() const noexcept; // bytes this instance holds, pages shared with clones counted in full
+
+    // Save states: a versioned binary snapshot written into a caller-provided buffer without allocating.
+    // save_state returns the bytes written (0 if the buffer is smaller than state_size());
+    // load_state leaves the emulator untouched and returns false on any version, shape or game mismatch,
+    // or on mapper state that points outside the PRG image or VRAM.
+    size_t state_size() const noexcept;
+    size_t save_state(uint8_t* buffer, size_t size) const noexcept;
+    bool load_state(const uint8_t* data, size_t size) noexcept;
+    void save_state_file(const std::string& path) const; // through a memory-mapped file
+    void load_state_file(const std::string& path);
+
+    // Run-ahead: each host frame runs the real frame headless, then emulates `frames` more ahead and
+    // presents the last of them. Single-instance mode snapshots and restores around the speculative
+    // frames; shadow mode syncs a second instance from this one instead, so nothing is restored here.
+    // The sync copies the POD state and re-shares only the memory pages either side wrote since the
+    // last one. A failed restore throws std::runtime_error.
+    void set_run_ahead(int frames, bool use_shadow = false);
+    RunStatus run_frame_ahead();
+    PPU& presented_ppu() { return (run_ahead_shadow_ && shadow_) ? shadow_->ppu() : *ppu_; }
+    const RunAheadStats& run_ahead_stats() const noexcept { return run_ahead_stats_; }
+
+    // Frame pacing: run_frame_paced() runs one frame (with run-ahead, if set) and then waits for its
+    // deadline. Frames the pacer chooses not to present are emulated with rendering off.
+    void set_pacing(const PacingOptions& options);
+    FramePacer* pacer() noexcept { return pacer_.get(); } // null until set_pacing()
+    RunStatus run_frame_paced();
+
+    // APU output for the emulated time since the previous call, about 735 samples per NTSC frame
+    void generate_frame_audio(std::vector<int16_t>& samples);
+
+    // Audio-only mode: the PPU is never caught up; the frame events only raise vblank/NMI
+    void set_audio_only(bool enabled) noexcept;
+    bool audio_only() const noexcept { return audio_only_; }
+
+    // NSF playback: init selects a 0-based song, each play frame runs PLAY and renders one period of audio
+    const NsfLoader* nsf() const noexcept { return nsf_.get(); }
+    void nsf_init(int song);
+    void nsf_play_frame(std::vector<int16_t>& samples);
 
 private:
-    std::unique_ptr<ROM> rom_;
-    std::unique_ptr<Memory> mem_;
-    std::unique_ptr<CPU6502> cpu_;
-    std::unique_ptr<PPU> ppu_;
-    std::unique_ptr<APU> apu_;
+    // All component state in one cache-aligned block; the pointers below point into it (ppu_ is null for NSF)
+    struct Core;
+    std::unique_ptr<Core> core_;
+    std::shared_ptr<const ROM> rom_;
+    Memory* mem_ = nullptr;
+    CPU6502* cpu_ = nullptr;
+    PPU* ppu_ = nullptr;
+    APU* apu_ = nullptr;
+    std::shared_ptr<const NsfLoader> nsf_;
+
+    Scheduler scheduler_;
+    uint64_t frame_start_dot_ = 0;
+    uint64_t frame_count_ = 0;
+    uint64_t rom_hash_ = 0;         // Memory::prg_hash() of the loaded image, stamped into save states
+    bool audio_only_ = false;
+    bool rendering_ = true;
+    InputProvider* input_ = nullptr;
+    TraceBuffer* trace_ = nullptr;
+    Profiler* profiler_ = nullptr;
+    Metrics metrics_;
+    Metrics::Delta pending_metrics_; // step()/advance_clock() work, published with the next run call
+    uint64_t counted_ppu_dot_ = 0;   // PPU::dot() at the last publish; re-based whenever the timeline is replaced
+    std::array<uint16_t, max_breakpoints> breakpoints_{};
+    size_t breakpoint_count_ = 0;
+    bool stopped_at_breakpoint_ = false; // the last run ended on a breakpoint at breakpoint_pc_
+    uint16_t breakpoint_pc_ = 0;
+    uint64_t nsf_sample_carry_ = 0; // fractional samples, in units of 1/1000000
+    uint64_t audio_samples_ = 0;    // generate_frame_audio() position, in samples since cycle 0
+
+    int run_ahead_frames_ = 0;
+    bool run_ahead_shadow_ = false;
+    std::unique_ptr<Emulator> shadow_;
+    std::vector<uint8_t> run_ahead_state_;
+    RunAheadStats run_ahead_stats_;
+    std::unique_ptr<FramePacer> pacer_;
+
+    bool sync_from(const Emulator& source) noexcept; // shadow run-ahead; false if the games differ
+    // `host_time` is read at entry as the run's start and left holding its end, so callers timing the
+    // run themselves share the reads
+    RunStatus run_until(uint64_t cycle, bool stop_at_frame_end, std::chrono::steady_clock::time_point& host_time) noexcept;
+    bool run_checked(uint64_t limit, bool& skip_check, uint64_t& instructions) noexcept;
+    void publish_metrics(Metrics::Delta& delta) noexcept;
+    void rebuild_core(const ROM* rom);
+    void bind_core() noexcept;
+    void unbind_core() noexcept;
+    void start_timeline();
+    void dispatch_events();
+    void schedule_frame_events();
+    void poll_input();
+    void trace_instruction() noexcept;
+    bool nsf_call(uint16_t address, uint8_t a, uint8_t x);
 };
 
 }
-
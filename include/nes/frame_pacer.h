@@ -0,0 +1,75 @@
+#pragma once
+#include "nes/metrics.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace nes {
+constexpr double ntsc_refresh_hz = 60.0988; // 1789773 Hz CPU / 29780.67 cycles per frame
+constexpr double pal_refresh_hz = 50.0070;
+
+enum class PacingMode {
+    Free,     // no waiting, every frame presented
+    RealTime, // locked to refresh_hz; presentation is skipped while catching up
+    Turbo,    // no waiting; only every turbo_render_interval-th frame is rendered
+};
+
+struct PacingOptions {
+    PacingMode mode = PacingMode::RealTime;
+    double refresh_hz = ntsc_refresh_hz;
+    uint64_t max_spin_us = 500;      // upper bound on the busy-wait before a deadline
+    int max_skipped_frames = 4;      // in a row; further behind than this, the schedule is reset
+    int turbo_render_interval = 4;
+    int turbo_audio_stride = 4;      // decimate_audio() keeps one averaged sample per stride
+};
+
+struct PacingStats {
+    uint64_t frames = 0;
+    uint64_t presented = 0;
+    uint64_t skipped = 0;            // emulated without rendering to catch up, or turbo frame-skip
+    uint64_t resyncs = 0;            // fell too far behind and dropped the backlog
+    uint64_t spin_us = 0;            // current busy-wait window
+};
+
+// Real-time frame pacing against absolute deadlines: frame n is due at start + n periods, so sleep
+// error never accumulates. The thread sleeps until shortly before a deadline and spins the rest; the
+// spin window tracks how late recent sleeps woke up, so a quiet system spins for tens of microseconds
+// rather than a full core. Frame-to-frame intervals and deadline misses go into histograms.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FramePacer(const PacingOptions& options = PacingOptions());
+    void set_options(const PacingOptions& options);
+    const PacingOptions& options() const noexcept { return options_; }
+    void restart() noexcept; // next frame starts a fresh schedule, e.g. after a pause
+
+    bool begin_frame() noexcept; // whether the frame about to run should be rendered and presented
+    void end_frame() noexcept;   // waits for the frame's deadline in real-time mode
+
+    // Turbo mode audio: averages each turbo_audio_stride samples into one, in place
+    void decimate_audio(std::vector<int16_t>& samples) const;
+
+    PacingStats stats() const noexcept;
+    const LatencyHistogram& frame_intervals() const noexcept { return intervals_; } // ns between end_frame() returns
+    const LatencyHistogram& deadline_error() const noexcept { return lateness_; }   // ns past each deadline on wake-up
+
+private:
+    PacingOptions options_;
+    Clock::duration period_{};
+    Clock::time_point origin_{};
+    Clock::time_point last_end_{};
+    uint64_t frame_index_ = 0;     // frames since origin_
+    bool started_ = false;
+    bool presenting_ = true;
+    int skipped_in_row_ = 0;
+    Clock::duration spin_{};
+    Clock::duration oversleep_{};  // decaying maximum of recent sleep overshoot
+    PacingStats stats_;
+    LatencyHistogram intervals_;
+    LatencyHistogram lateness_;
+
+    Clock::time_point deadline() const noexcept;
+    void wait_until(Clock::time_point deadline) noexcept;
+};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace nes {
+enum Button : uint8_t { ButtonA = 0x01, ButtonB = 0x02, ButtonSelect = 0x04, ButtonStart = 0x08, ButtonUp = 0x10, ButtonDown = 0x20, ButtonLeft = 0x40, ButtonRight = 0x80 };
+
+// Standard pad behind $4016/$4017. While strobe is high the shift register keeps reloading; once it
+// drops, each read returns the next button (A, B, Select, Start, Up, Down, Left, Right), then 1s.
+// Trivially copyable so it rides along in Memory's save-state block. A read is a const bus access that
+// still shifts the register, so the shift register alone is mutable.
+class Controller {
+public:
+    void set_buttons(uint8_t buttons) noexcept { buttons_ = buttons; if (strobe_) shift_ = buttons_; }
+    uint8_t buttons() const noexcept { return buttons_; }
+    void write_strobe(uint8_t value) noexcept { strobe_ = (value & 1) != 0; if (strobe_) shift_ = buttons_; }
+    uint8_t read() const noexcept {
+        if (strobe_) return buttons_ & 1;
+        uint8_t bit = shift_ & 1;
+        shift_ = static_cast<uint8_t>((shift_ >> 1) | 0x80);
+        return bit;
+    }
+
+private:
+    uint8_t buttons_ = 0;
+    mutable uint8_t shift_ = 0;
+    bool strobe_ = false;
+};
+
+// Source of button state, polled by the emulator once at the start of every frame (frame 0 on load),
+// so playback depends only on the frame number, never on host timing. poll() runs inside the
+// emulator's noexcept run loop and must not throw.
+class InputProvider {
+public:
+    virtual ~InputProvider() = default;
+    virtual void poll(uint64_t frame, std::array<uint8_t, 2>& pads) = 0;
+};
+
+// For input produced on another thread: both pads live in one lock-free word, so a frame never sees
+// half of an update.
+class AtomicInputProvider : public InputProvider {
+public:
+    void set(int port, uint8_t buttons) noexcept;
+    void set_all(uint8_t pad1, uint8_t pad2) noexcept { pads_.store(static_cast<uint16_t>(pad1 | (pad2 << 8)), std::memory_order_release); }
+    void poll(uint64_t frame, std::array<uint8_t, 2>& pads) override;
+
+private:
+    std::atomic<uint16_t> pads_{ 0 };
+};
+
+// Movie file: "NMOV", u16 version, u8 port count, u8 reserved, u32 frame count, then one button byte
+// per port per frame. Fields are little-endian.
+struct Movie {
+    uint8_t ports = 1;
+    std::vector<uint8_t> frames; // ports bytes per frame
+
+    size_t frame_count() const noexcept { return ports ? frames.size() / ports : 0; }
+    uint8_t buttons(uint64_t frame, int port) const noexcept; // 0 past the end or for a missing port
+    void save(const std::string& path) const;
+    static Movie load(const std::string& path);
+};
+
+class MoviePlayer : public InputProvider {
+public:
+    explicit MoviePlayer(const Movie& movie) : movie_(movie) {}
+    void poll(uint64_t frame, std::array<uint8_t, 2>& pads) override;
+    bool finished(uint64_t frame) const noexcept { return frame >= movie_.frame_count(); }
+
+private:
+    const Movie& movie_;
+};
+
+// Passes another provider through and records what it returned. Polling frame N drops anything
+// recorded past it, so the movie always ends at the last frame the emulator reached. Room for
+// `reserve_frames` is allocated up front; past that poll() grows the buffer itself and, if that
+// fails, stops recording and reports truncated() rather than throwing into the run loop. `ports` must
+// be 1 or 2 (std::invalid_argument otherwise).
+class MovieRecorder : public InputProvider {
+public:
+    explicit MovieRecorder(InputProvider& source, uint8_t ports = 2, size_t reserve_frames = 60 * 60 * 60); // an hour at 60 Hz
+    void poll(uint64_t frame, std::array<uint8_t, 2>& pads) override;
+    const Movie& movie() const noexcept { return movie_; }
+    bool truncated() const noexcept { return truncated_; }
+
+private:
+    InputProvider& source_;
+    Movie movie_;
+    bool truncated_ = false;
+};
+}
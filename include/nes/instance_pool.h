@@ -0,0 +1,36 @@
+#pragma once
+#include "nes/emulator.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nes {
+// Recycles Emulator instances for one game. All instances share the parsed ROM; a released instance
+// keeps its core block and is reloaded in place on the next acquire, so steady-state acquire/release
+// only allocates the RAM pages a run dirties. Instances come out headless unless rendering is asked
+// for. Thread-safe; the pool must outlive its handles.
+class InstancePool {
+public:
+    struct Returner {
+        InstancePool* pool;
+        void operator()(Emulator* emu) const noexcept;
+    };
+    using Handle = std::unique_ptr<Emulator, Returner>;
+
+    explicit InstancePool(std::shared_ptr<const ROM> rom, bool rendering = false);
+    explicit InstancePool(const std::vector<uint8_t>& rom_bytes, bool rendering = false);
+    Handle acquire();          // freshly loaded and reset
+    void reserve(size_t count); // pre-build idle instances
+    size_t idle() const;
+    const std::shared_ptr<const ROM>& rom() const noexcept { return rom_; }
+
+private:
+    std::shared_ptr<const ROM> rom_;
+    bool rendering_;
+    mutable std::mutex lock_;
+    std::vector<std::unique_ptr<Emulator>> idle_;
+
+    void release(Emulator* emu) noexcept;
+};
+}
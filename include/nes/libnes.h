@@ -0,0 +1,75 @@
+#pragma once
+/* C ABI for embedding the emulator (libnes). Nothing here throws or exposes C++ types, so it can be
+ * loaded from Python (ctypes/cffi), Go (cgo) and anything else with a C FFI. Functions returning int
+ * return NES_OK or a negative nes_status; nes_last_error() describes the most recent failure.
+ * An instance must not be used from two threads at once; separate instances are independent. */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifdef NES_BUILDING_LIBRARY
+#    define NES_API __declspec(dllexport)
+#  else
+#    define NES_API __declspec(dllimport)
+#  endif
+#else
+#  define NES_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NES_ABI_VERSION 1 /* bumped on any incompatible change to this header */
+#define NES_FRAME_WIDTH 256
+#define NES_FRAME_HEIGHT 240
+#define NES_FRAME_BYTES (NES_FRAME_WIDTH * NES_FRAME_HEIGHT * 3) /* RGB24, row-major */
+#define NES_AUDIO_SAMPLE_RATE 44100                                /* mono int16 */
+
+enum nes_status {
+    NES_OK = 0,
+    NES_ERROR_ARGUMENT = -1,   /* null instance or buffer */
+    NES_ERROR_NOT_LOADED = -2, /* no ROM loaded */
+    NES_ERROR_ROM = -3,        /* the ROM image was rejected */
+    NES_ERROR_STATE = -4,      /* save state too small, or from another version or game */
+    NES_ERROR_INTERNAL = -5
+};
+
+typedef struct nes_instance nes_instance;
+
+NES_API uint32_t nes_abi_version(void);
+
+NES_API nes_instance* nes_create(void); /* NULL if out of memory */
+NES_API void nes_destroy(nes_instance* nes);
+NES_API const char* nes_last_error(const nes_instance* nes); /* "" when the last call succeeded */
+
+/* iNES image; the bytes are copied, so the caller may free them straight away */
+NES_API int nes_load_rom(nes_instance* nes, const uint8_t* data, size_t size);
+NES_API int nes_reset(nes_instance* nes);
+/* Off: no pixels are drawn (timing, flags and sprite 0 still run); the frame keeps its last image */
+NES_API int nes_set_rendering(nes_instance* nes, int enabled);
+
+/* Runs `frames` frames. `inputs` holds two button bytes (pad 1, pad 2) per frame, bit 0 = A through
+ * bit 7 = Right, latched before each frame; NULL keeps the current buttons. */
+NES_API int nes_run_frames(nes_instance* nes, uint32_t frames, const uint8_t* inputs);
+NES_API uint64_t nes_frame_count(const nes_instance* nes);
+
+/* Zero-copy views into instance-owned buffers. The frame pointer stays valid, and its contents
+ * update in place, until the next nes_load_rom() or nes_destroy(). The audio pointer holds the samples
+ * generated by the last nes_run_frames() and is valid until the next call that runs frames. */
+NES_API const uint8_t* nes_get_frame_ptr(nes_instance* nes);
+NES_API const int16_t* nes_get_audio_ptr(const nes_instance* nes, size_t* samples);
+
+/* Save states: nes_save_state returns the bytes written, 0 if `size` is below nes_state_size() */
+NES_API size_t nes_state_size(const nes_instance* nes);
+NES_API size_t nes_save_state(const nes_instance* nes, uint8_t* buffer, size_t size);
+NES_API int nes_load_state(nes_instance* nes, const uint8_t* data, size_t size);
+
+/* nes_run_frames over `count` instances in one call. `inputs` (or NULL) holds `frames` * 2 bytes per
+ * instance, instance after instance; `statuses` (or NULL) receives each instance's result. Returns
+ * NES_OK, or the first failure; the remaining instances still run. */
+NES_API int nes_step_many(nes_instance* const* instances, size_t count, uint32_t frames, const uint8_t* inputs, int* statuses);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include "nes/emulator.h"
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace nes {
+// Experimental: runs up to 16 instances of the same game in lockstep, with CPU registers and internal
+// RAM laid out struct-of-arrays. Each issue picks the lane furthest behind and executes its opcode
+// once for every lane parked on the same PC: the opcode and addressing mode are dispatched once per
+// issue, outside the lane loops, so each loop body is straight-line code behind the lane's issue-mask
+// test. Whether the compiler turns those into SIMD depends on -march and the op; don't count on it.
+// RAM is stored address-major, so a zero-page or absolute access is one contiguous row across lanes.
+//
+// Only code that stays inside internal RAM and PRG-ROM runs in lockstep. A lane peels off to its scalar
+// Emulator on I/O, PRG-RAM, BRK/RTI or unofficial opcodes, on a pending or held interrupt, and whenever its next
+// scheduler event falls due. It then runs scalar_run instructions on its own before being gathered
+// again. A gather or scatter copies 2 KB per lane, so this only pays off on long stretches of pure
+// game logic; raster waits and polling loops mostly run scalar.
+class LockstepGroup {
+public:
+    static constexpr size_t max_lanes = 16;
+
+    struct Stats {
+        uint64_t issued = 0;             // lockstep instruction issues
+        uint64_t lane_instructions = 0;  // instructions retired across all lanes by those issues
+        uint64_t peels = 0;
+        uint64_t gathers = 0;
+        double convergence() const noexcept { return issued ? static_cast<double>(lane_instructions) / static_cast<double>(issued) : 0; }
+    };
+
+    // Lanes must have the same ROM loaded and stay alive for the group's lifetime
+    explicit LockstepGroup(const std::vector<Emulator*>& lanes, uint32_t scalar_run = 64);
+    void run_frame(); // advances every lane by one frame
+    size_t lanes() const noexcept { return lanes_.size(); }
+    const Stats& stats() const noexcept { return stats_; }
+
+private:
+    struct Lanes {
+        alignas(64) std::array<uint8_t, max_lanes> a, x, y, sp, p;
+        alignas(64) std::array<uint16_t, max_lanes> pc;
+        alignas(64) std::array<uint32_t, max_lanes> cycles;   // run since the last gather
+        alignas(64) std::array<uint32_t, max_lanes> budget;   // cycles until the lane's next event
+        alignas(64) std::array<std::array<uint8_t, max_lanes>, 0x800> ram;
+    };
+
+    std::vector<Emulator*> lanes_;
+    std::unique_ptr<Lanes> soa_;
+    uint32_t scalar_run_;
+    std::array<uint32_t, max_lanes> scalar_left_;
+    Stats stats_;
+
+    uint32_t gather(uint32_t candidates);
+    void scatter(size_t lane);
+    void run_group(uint32_t group);
+    uint32_t execute(uint8_t opcode, uint32_t mask); // returns the lanes that must peel before executing
+};
+}
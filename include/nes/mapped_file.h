@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace nes {
+// Mapping of a whole file (POSIX mmap): shared read/write, or read-only for loading.
+class MappedFile {
+public:
+    static MappedFile create(const std::string& path, size_t size); // creates or resizes the file
+    static MappedFile open(const std::string& path);
+    static MappedFile open_read_only(const std::string& path); // PROT_READ: data() must not be written through
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    uint8_t* data() noexcept { return data_; }
+    const uint8_t* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    MappedFile(uint8_t* data, size_t size) noexcept : data_(data), size_(size) {}
+    uint8_t* data_;
+    size_t size_;
+};
+}
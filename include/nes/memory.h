@@ -2,6 +2,12 @@
 #include "nes/rom.h"     // Ensure this file exists and defines ROM
 #include "nes/visual.h"  // Includes PPU class
 #include "nes/audio.h"   // Includes APU class
+#include "nes/nsf.h"
+#include "nes/cow_memory.h"
+#include "nes/input.h"
+#include "nes/metrics.h"
+#include "nes/profiler.h"
+#include "nes/scheduler.h"
 #include <cstdint>
 #include <array>
 
@@ -9,14 +15,56 @@ namespace nes {
 class Memory {
 public:
     Memory(const ROM* rom, PPU* ppu, APU* apu);
+    Memory(const Memory& other, PPU* ppu, APU* apu); // fork: PRG-RAM pages shared copy-on-write, internal RAM copied, mapping rebound
     uint8_t read(uint16_t addr) const;
     void write(uint16_t addr, uint8_t value);
-    void oam_dma(uint8_t page);
+    bool irq_asserted() const noexcept; // the APU's frame/DMC IRQ line
+    void oam_dma(uint8_t page); // $4014; with a scheduler attached, stalls the CPU via a DmaComplete event
+    void attach_scheduler(Scheduler* scheduler) noexcept { scheduler_ = scheduler; }
+    void map_nsf(const NsfLoader* nsf); // route $8000-$FFFF through NSF banks, $5FF8-$5FFF selects them
+    void clear_work_ram();
+
+    // Mapper and pad state; PRG windows are stored as offsets so the block stays position-independent
+    struct State {
+        std::array<uint32_t, 8> prg_offsets_;      // 4 KB windows over $8000-$FFFF
+        std::array<Controller, 2> controllers_;    // $4016, $4017
+    };
+    const State& state() const noexcept { return state_; }
+    void set_state(const State& state) noexcept;                // assumes valid_state(state)
+    void sync_from(const Memory& other) noexcept;               // same game: state and internal RAM copied, PRG-RAM pages shared
+    bool valid_state(const State& state) const noexcept;        // every window 4 KB-aligned inside the PRG image
+    uint64_t prg_hash() const noexcept;                         // identifies the game in save states
+    const Controller& controller(int port) const noexcept { return state_.controllers_[port & 1]; }
+    void set_buttons(int port, uint8_t buttons) noexcept { state_.controllers_[port & 1].set_buttons(buttons); } // the game sees them from its next strobe
+    void set_profiler(Profiler* profiler) noexcept { profiler_ = profiler; } // register access counts
+
+    // Bus accesses per 8 KB slot since the last call, which resets them; always zero unless built with
+    // NES_ENABLE_BUS_COUNTERS (see metrics.h)
+    using AccessCounts = std::array<uint64_t, 8>;
+    void take_access_counts(AccessCounts& reads, AccessCounts& writes) noexcept;
+
+    using InternalRam = InlineMemory<0x0800>;     // every zero-page and stack access: no page hop
+    using PrgRam = CowMemory<0x2000>;              // $6000-$7FFF
+    InternalRam& internal_ram() noexcept { return internal_ram_; }
+    const InternalRam& internal_ram() const noexcept { return internal_ram_; }
+    PrgRam& prg_ram() noexcept { return prg_ram_; }
+    const PrgRam& prg_ram() const noexcept { return prg_ram_; }
 
 private:
-    std::array<uint8_t, 0x0800> ram_;
+    State state_;
+    InternalRam internal_ram_;
+    PrgRam prg_ram_;
+    std::array<const uint8_t*, 8> prg_pages_;      // prg_base_ + prg_offsets_, what fetch() reads through
+    const uint8_t* prg_base_;
+    size_t prg_size_;                              // bytes from prg_base_ that windows may map
     const ROM* rom_;
+    const NsfLoader* nsf_;
     PPU* ppu_;
     APU* apu_;
+    Profiler* profiler_ = nullptr;
+    Scheduler* scheduler_ = nullptr;
+    mutable AccessCounts reads_{};                 // mutable: fetch() is const
+    AccessCounts writes_{};
+    void map_prg_page(int slot, uint32_t offset) noexcept;
 };
-}
\ No newline at end of file
+}
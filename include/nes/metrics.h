@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Build with NES_ENABLE_BUS_COUNTERS=1 to count CPU bus reads and writes per region. The counters sit on
+// the memory map's fetch/store path, so without it they are compiled out and the region counts stay zero.
+#ifndef NES_ENABLE_BUS_COUNTERS
+#define NES_ENABLE_BUS_COUNTERS 0
+#endif
+
+namespace nes {
+// CPU address space by the top three address bits: $0000 RAM, $2000 PPU, $4000 APU/I/O and
+// expansion, $6000 cartridge RAM, $8000-$FFFF ROM (four slots, reported together)
+enum class MemoryRegion { Ram, Ppu, ApuIo, CartRam, Rom, Count };
+const char* memory_region_name(MemoryRegion region) noexcept;
+
+// Log-linear latency histogram in the style of HdrHistogram: exact below 32, then 16 sub-buckets per
+// power of two (about 6% resolution). Bucket counters are atomic, so readers never block the writer.
+class LatencyHistogram {
+public:
+    static constexpr size_t bucket_count = 32 + 59 * 16;
+    void record(uint64_t value) noexcept;
+    uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+    uint64_t sum() const noexcept { return sum_.load(std::memory_order_relaxed); }
+    uint64_t percentile(double p) const noexcept; // upper edge of the bucket holding the p-th percentile
+    void clear() noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_{};
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> max_{ 0 };
+    std::atomic<uint64_t> sum_{ 0 };
+};
+
+struct MetricsSnapshot {
+    uint64_t cpu_cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t ppu_dots = 0;
+    uint64_t frames = 0;
+    uint64_t apu_samples = 0;
+    uint64_t dma_stall_cycles = 0;
+    std::array<uint64_t, static_cast<size_t>(MemoryRegion::Count)> memory_reads{}, memory_writes{};
+    double cpu_seconds = 0;        // wall time in the instruction loop (run time minus event_seconds)
+    double event_seconds = 0;      // wall time dispatching events: PPU catch-up, APU sequencer, IRQs; sampled
+    uint64_t frame_time_count = 0;
+    double frame_time_seconds = 0; // sum over all recorded frames
+    double frame_time_p50_us = 0, frame_time_p99_us = 0, frame_time_p999_us = 0, frame_time_max_us = 0;
+
+    MetricsSnapshot& operator+=(const MetricsSnapshot& other) noexcept; // sums counters, keeps the worst percentiles
+};
+
+// Per-instance counters. Only the thread running the emulator writes them, once per run call; the hot
+// loop and the memory map count in plain locals and members in between, so no atomic is touched per
+// instruction. Any thread may take a snapshot at any time. Each group sits on its own cache line,
+// away from the emulator's hot state.
+class Metrics {
+public:
+    struct Delta {
+        uint64_t cpu_cycles = 0, instructions = 0, ppu_dots = 0, frames = 0, apu_samples = 0, dma_stall_cycles = 0;
+        std::array<uint64_t, static_cast<size_t>(MemoryRegion::Count)> memory_reads{}, memory_writes{};
+        uint64_t cpu_ns = 0, event_ns = 0;
+    };
+    void publish(const Delta& delta) noexcept;
+    void record_frame_time(uint64_t ns) noexcept { frame_times_.record(ns); }
+    MetricsSnapshot snapshot() const noexcept;
+    void clear() noexcept;
+
+private:
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> cpu_cycles{ 0 }, instructions{ 0 }, ppu_dots{ 0 }, frames{ 0 }, apu_samples{ 0 }, dma_stall_cycles{ 0 };
+        std::atomic<uint64_t> cpu_ns{ 0 }, event_ns{ 0 };
+    };
+    struct alignas(64) MemoryCounters {
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(MemoryRegion::Count)> reads{}, writes{};
+    };
+    Counters counters_;
+    MemoryCounters memory_;
+    alignas(64) LatencyHistogram frame_times_; // nanoseconds per completed run_frame()
+};
+
+std::string metrics_json(const MetricsSnapshot& snapshot);
+// Prometheus text exposition format; `labels` is inserted verbatim, e.g. instance="3"
+std::string metrics_prometheus(const MetricsSnapshot& snapshot, const std::string& labels = "");
+// For the node exporter's textfile collector: written beside `path` and renamed into place
+void write_metrics_file(const std::string& path, const std::string& text);
+}
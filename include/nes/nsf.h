@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <string>
+#include <stdexcept>
+
+namespace nes {
+struct NsfHeader {
+    uint8_t version;
+    uint8_t total_songs;
+    uint8_t starting_song;   // 1-based, as stored in the file
+    uint16_t load_address;
+    uint16_t init_address;
+    uint16_t play_address;
+    std::string name, artist, copyright;
+    uint16_t ntsc_speed;     // play period in microseconds
+    uint16_t pal_speed;
+    std::array<uint8_t, 8> bank_init;
+    uint8_t region_flags;    // bit0: PAL, bit1: dual
+    uint8_t extra_chips;
+};
+
+// Parses an NSF file and lays the tune out as 4 KB banks for the $8000-$FFFF window.
+// Non-bankswitched tunes become a flat 32 KB image whose initial banks are simply 0..7.
+class NsfLoader {
+public:
+    explicit NsfLoader(const std::vector<uint8_t>& data);
+    const NsfHeader& get_header() const noexcept { return header_; }
+    bool is_bankswitched() const noexcept { return bankswitched_; }
+    bool is_pal() const noexcept { return (header_.region_flags & 0x03) == 0x01; }
+    uint8_t initial_bank(int slot) const noexcept { return initial_banks_[slot & 7]; }
+    const uint8_t* get_bank(uint8_t bank) const noexcept { return image_.data() + (static_cast<size_t>(bank) % bank_count_) * 0x1000; }
+    uint32_t play_period_us() const noexcept;
+    size_t image_size() const noexcept { return image_.size(); } // bank_count * 4 KB
+
+private:
+    NsfHeader header_;
+    bool bankswitched_;
+    std::array<uint8_t, 8> initial_banks_;
+    size_t bank_count_;
+    std::vector<uint8_t> image_;
+};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+// Build with NES_ENABLE_PROFILER=1 to compile the counting hooks into the CPU and memory map. Without it
+// the hooks are gone entirely and an attached profiler simply stays empty.
+#ifndef NES_ENABLE_PROFILER
+#define NES_ENABLE_PROFILER 0
+#endif
+
+namespace nes {
+// Counting profiler: executions and cycles per PC and per opcode, backward jumps as loops, JSR/RTS and
+// interrupts as an approximate call graph, and accesses to the $2000-$401F registers. Counters are
+// flat arrays indexed by address or opcode; only call-graph edges go through a map, once per JSR.
+class Profiler {
+public:
+    static constexpr bool enabled = NES_ENABLE_PROFILER != 0;
+
+    Profiler();
+    void reset();
+
+    // Called after each instruction with its address and the PC it left behind
+    void count_instruction(uint16_t pc, uint8_t opcode, int cycles, uint16_t next_pc) {
+        pc_counts_[pc]++;
+        pc_cycles_[pc] += static_cast<uint64_t>(cycles);
+        opcode_counts_[opcode]++;
+        opcode_cycles_[opcode] += static_cast<uint64_t>(cycles);
+        total_cycles_ += static_cast<uint64_t>(cycles);
+        if (next_pc <= pc && ((opcode & 0x1F) == 0x10 || opcode == 0x4C)) { // taken branch or JMP backwards
+            loop_counts_[next_pc]++;
+            if (pc > loop_ends_[next_pc]) loop_ends_[next_pc] = pc;
+        }
+        if (opcode == 0x20) enter(next_pc, false);
+        else if (opcode == 0x00) enter(next_pc, true); // BRK
+        else if (opcode == 0x60 || opcode == 0x40) leave();
+    }
+    void count_interrupt(uint16_t handler) { enter(handler, true); }
+    void count_io(uint16_t address, bool write) noexcept {
+        size_t reg = address < 0x4000 ? (address & 0x07) : 8 + (address & 0x1F);
+        (write ? io_writes_ : io_reads_)[reg]++;
+    }
+
+    uint64_t instructions() const noexcept;
+    uint64_t cycles() const noexcept { return total_cycles_; }
+    void report(std::ostream& out, size_t top = 20) const;
+
+private:
+    static constexpr size_t max_depth = 64;            // deeper calls are counted but not timed
+    struct Frame { uint16_t entry; uint64_t start_cycles; };
+
+    std::vector<uint64_t> pc_counts_, pc_cycles_;
+    std::array<uint64_t, 256> opcode_counts_{}, opcode_cycles_{};
+    std::vector<uint64_t> loop_counts_;
+    std::vector<uint16_t> loop_ends_;
+    std::vector<uint64_t> call_counts_, call_cycles_; // inclusive cycles, per entry point
+    std::unordered_map<uint64_t, uint64_t> call_edges_; // caller << 16 | callee, caller is an entry or one of below
+    static constexpr uint64_t top_level = 0x10000, interrupted = 0x10001;
+    std::array<Frame, max_depth> stack_{};
+    size_t depth_ = 0;
+    std::array<uint64_t, 8 + 32> io_reads_{}, io_writes_{}; // $2000-$2007 (mirrors folded), then $4000-$401F
+    uint64_t total_cycles_ = 0;
+
+    void enter(uint16_t entry, bool interrupt);
+    void leave() noexcept;
+};
+}
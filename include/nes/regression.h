@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nes {
+// XXH64, bit-compatible with the reference implementation (xxhsum -H1). Four independent lanes
+// over 32-byte stripes, so a frame hashes at several GB/s without dedicated SIMD code.
+uint64_t xxh64(const void* data, size_t size, uint64_t seed = 0) noexcept;
+
+struct FrameHashes {
+    uint64_t video = 0; // RGB frame as published
+    uint64_t audio = 0; // samples generated with the frame
+    bool operator==(const FrameHashes& other) const noexcept { return video == other.video && audio == other.audio; }
+    bool operator!=(const FrameHashes& other) const noexcept { return !(*this == other); }
+};
+
+// Per-frame hash log, 16 bytes a frame. File format: "NHSH", u16 version, u16 reserved, u32 frame
+// count, then the frames; all little-endian.
+struct HashLog {
+    static constexpr uint16_t version = 1;
+    std::vector<FrameHashes> frames;
+
+    void save(const std::string& path) const;
+    static HashLog load(const std::string& path);
+};
+
+// First frame at which `actual` differs from `golden`, a log ending early included; -1 if they match
+int64_t first_divergence(const HashLog& actual, const HashLog& golden) noexcept;
+
+void save_ppm(const std::string& path, const std::vector<uint8_t>& rgb, int width = 256, int height = 240);
+}
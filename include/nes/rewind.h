@@ -0,0 +1,51 @@
+#pragma once
+#include "nes/emulator.h"
+#include <cstdint>
+#include <vector>
+#include <deque>
+
+namespace nes {
+struct RewindConfig {
+    size_t memory_budget = 4 * 1024 * 1024; // bytes of encoded history
+    uint32_t keyframe_interval = 60;        // frames per segment, a full snapshot starts each one
+};
+
+// Per-frame rewind history on top of Emulator save states.
+// Every frame is stored as the XOR of its snapshot with the previous one, run-length encoded, so the
+// mostly unchanged RAM/VRAM/OAM collapses to a few zero runs. Stepping back inside a segment applies
+// one delta to the current snapshot (XOR is its own inverse); stepping across a keyframe restores
+// the previous keyframe and replays that segment's deltas forward. The oldest whole segment is
+// dropped when the budget runs out, so history always starts at a keyframe.
+class RewindBuffer {
+public:
+    explicit RewindBuffer(const RewindConfig& config = RewindConfig());
+    void push(const Emulator& emu);   // once per emulated frame
+    bool step_back(Emulator& emu);    // restores the previous frame, false when history is exhausted
+    void clear() noexcept;
+
+    size_t frames() const noexcept { return entries_.size(); }
+    size_t memory_used() const noexcept { return used_; }
+    const RewindConfig& config() const noexcept { return config_; }
+
+private:
+    struct Entry {
+        size_t offset;   // into arena_
+        uint32_t size;
+        bool keyframe;
+    };
+
+    RewindConfig config_;
+    std::vector<uint8_t> arena_;      // ring of encoded entries, sized to the budget
+    std::deque<Entry> entries_;       // oldest first
+    size_t head_;                     // next write position in arena_
+    size_t used_;
+    uint32_t since_keyframe_;
+    std::vector<uint8_t> current_;    // snapshot of the newest frame
+    std::vector<uint8_t> scratch_;
+    std::vector<uint8_t> encoded_;
+
+    size_t reserve(size_t length) noexcept;
+    void drop_oldest_segment() noexcept;
+    void decode_into(const Entry& entry, std::vector<uint8_t>& target) const;
+};
+}
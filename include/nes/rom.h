@@ -10,6 +10,7 @@ struct RomHeader {
     uint8_t control_flags;
     uint8_t mapper_id;
     uint8_t mirror_type; // 0=horizontal, 1=vertical
+    bool four_screen;    // extra 2 KB of VRAM on the cart; overrides mirror_type
 };
 
 class RomLoader {
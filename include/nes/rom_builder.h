@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nes {
+enum class AddrMode { Implied, Accumulator, Immediate, ZeroPage, ZeroPageX, ZeroPageY, Absolute, AbsoluteX, AbsoluteY, Indirect, IndirectX, IndirectY, Relative };
+
+// Small 6502 assembler for synthetic ROMs: official opcodes only, one pass with label fixups.
+// Operands are plain values; for Relative they are the branch target address, like a label would be.
+// Malformed instructions throw std::invalid_argument, unresolved labels or out-of-range branches
+// throw std::runtime_error from finish().
+class Assembler {
+public:
+    explicit Assembler(uint16_t origin = 0xC000) : origin_(origin) {}
+    Assembler& op(const std::string& mnemonic, AddrMode mode = AddrMode::Implied, uint16_t operand = 0);
+    Assembler& op(const std::string& mnemonic, AddrMode mode, const std::string& target); // resolved by finish()
+    Assembler& label(const std::string& name);
+    Assembler& byte(uint8_t value);
+    Assembler& data(const std::vector<uint8_t>& bytes);
+    uint16_t origin() const noexcept { return origin_; }
+    uint16_t here() const noexcept { return static_cast<uint16_t>(origin_ + code_.size()); }
+    uint16_t address_of(const std::string& name) const;
+    std::vector<uint8_t> finish() const; // code with every label reference patched
+
+private:
+    struct Label { std::string name; uint16_t address; };
+    struct Fixup { size_t offset; std::string target; bool relative; };
+    uint16_t origin_;
+    std::vector<uint8_t> code_;
+    std::vector<Label> labels_;
+    std::vector<Fixup> fixups_;
+    size_t emit_opcode(const std::string& mnemonic, AddrMode mode);
+};
+
+// Reverse lookup for disassemblers: false for opcodes outside the official set
+bool decode_opcode(uint8_t code, const char*& mnemonic, AddrMode& mode) noexcept;
+int operand_size(AddrMode mode) noexcept; // bytes after the opcode
+
+struct RomSpec {
+    uint8_t prg_banks = 1;            // 16 KB units
+    uint8_t chr_banks = 1;            // 8 KB units; 0 for CHR-RAM
+    uint8_t mapper = 0;
+    bool vertical_mirroring = false;
+    bool battery = false;
+};
+
+// Builds an iNES image. CPU addresses map the way NROM does: a single 16 KB bank appears at both
+// $8000 and $C000, otherwise $8000-$FFFF is the last 32 KB of PRG (fixed-last-bank mappers agree).
+class RomBuilder {
+public:
+    explicit RomBuilder(const RomSpec& spec = RomSpec());
+    RomBuilder& place(uint16_t address, const std::vector<uint8_t>& bytes);
+    RomBuilder& place(const Assembler& code) { return place(code.origin(), code.finish()); }
+    RomBuilder& place_prg(size_t offset, const std::vector<uint8_t>& bytes);
+    RomBuilder& place_chr(size_t offset, const std::vector<uint8_t>& bytes);
+    RomBuilder& vectors(uint16_t nmi, uint16_t reset, uint16_t irq);
+    std::vector<uint8_t> build() const;
+
+private:
+    RomSpec spec_;
+    std::vector<uint8_t> prg_;
+    std::vector<uint8_t> chr_;
+};
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+namespace nes {
+// Save-state layout: a header, then blocks in a fixed order, each a tag/size pair followed by a raw
+// copy of a component's POD state or memory region. Blocks are host-endian; any change to a block's
+// struct layout must bump save_state_version.
+constexpr uint32_t save_state_magic = 0x5453534E; // "NSST"
+constexpr uint32_t save_state_version = 6;
+
+enum class StateBlock : uint32_t { Cpu = 1, Memory, Ppu, ChrRam, Apu, Scheduler, Timeline, InternalRam, PrgRam, Vram };
+
+struct SaveStateHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;   // header included
+    uint32_t block_count;
+    uint64_t rom_hash;     // XXH64 of the PRG image; states only load into the game that wrote them
+};
+
+struct SaveStateBlock {
+    uint32_t tag;
+    uint32_t size;
+};
+}
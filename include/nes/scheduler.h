@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <limits>
+
+namespace nes {
+enum class EventType : uint8_t { VBlank, FrameEnd, SpriteZero, ApuFrame, Irq, DmaComplete, Count };
+
+struct Event {
+    uint64_t time; // CPU cycle on the master clock
+    EventType type;
+};
+
+// Master clock shared by all components, measured in CPU cycles (PPU dots are 3x).
+// Pending events live in a fixed-capacity min-heap holding at most one event per type,
+// so scheduling never allocates and the hot loop only compares against next_time().
+class Scheduler {
+public:
+    Scheduler() noexcept { reset(); }
+    void reset() noexcept;
+
+    uint64_t now() const noexcept { return now_; }
+    void advance_to(uint64_t time) noexcept { now_ = time; }
+    uint64_t next_time() const noexcept { return size_ ? heap_[0].time : std::numeric_limits<uint64_t>::max(); }
+
+    void schedule(EventType type, uint64_t time) noexcept; // replaces a pending event of the same type
+    void cancel(EventType type) noexcept;
+    bool pending(EventType type) const noexcept { return slot_[static_cast<size_t>(type)] >= 0; }
+    bool pop_due(Event& out) noexcept; // earliest event with time <= now()
+    // For a scheduler copied in from a save state: the heap and the per-type slots index each other,
+    // so both must be in range and agree before anything sifts through them
+    bool valid_state() const noexcept;
+
+private:
+    static constexpr size_t capacity_ = static_cast<size_t>(EventType::Count);
+    std::array<Event, capacity_> heap_;
+    std::array<int8_t, capacity_> slot_; // heap index per event type, -1 when not pending
+    uint8_t size_;
+    uint64_t now_;
+
+    void place(size_t index, const Event& ev) noexcept;
+    void sift_up(size_t index) noexcept;
+    void sift_down(size_t index) noexcept;
+    void remove_at(size_t index) noexcept;
+};
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nes {
+class PPU;
+
+// Shared-memory frame/audio ring for consumers in other processes (POSIX shm + futex). The publisher
+// owns the segment; each slot holds one RGB frame and the audio generated with it, guarded by a
+// per-slot sequence number (odd while being written). Readers never block the publisher: a reader
+// that falls more than a ring behind skips ahead and is told how many frames it missed. Readers
+// sleep on a futex word in the header and are only woken, one syscall per frame, while one waits.
+struct ShmLayout {
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t frame_bytes = 256 * 240 * 3;
+
+    struct Header {
+        char magic[8];                       // "NESSHM\0\0"
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t audio_capacity;             // samples per slot
+        uint32_t sample_rate;
+        uint64_t slot_stride;                // bytes, a multiple of 64
+        alignas(64) std::atomic<uint64_t> published; // frames published so far
+        std::atomic<uint32_t> wake_word;     // futex: bumped on every publish and on close
+        std::atomic<uint32_t> waiters;
+        std::atomic<uint32_t> closed;        // publisher has gone away
+    };
+    struct Slot {
+        std::atomic<uint64_t> sequence;      // 2n+1 while frame n is written, 2n+2 once complete
+        uint64_t frame_number;               // emulator frame count
+        uint64_t timestamp_ns;               // steady clock (CLOCK_MONOTONIC) at publish
+        uint32_t audio_samples;
+        uint32_t reserved;
+        // followed by frame_bytes of RGB24, then audio_capacity int16 samples, padded to 64 bytes
+    };
+    static constexpr size_t slot_header_bytes = 64;
+    static constexpr size_t header_bytes = (sizeof(Header) + 63) & ~size_t(63);
+    static size_t stride(uint32_t audio_capacity) noexcept {
+        return (slot_header_bytes + frame_bytes + audio_capacity * sizeof(int16_t) + 63) & ~size_t(63);
+    }
+};
+
+struct ShmOptions {
+    std::string name = "/nes-frames"; // shm_open name
+    uint32_t slots = 8;
+    uint32_t audio_capacity = 2048;   // larger audio blocks are truncated
+    uint32_t sample_rate = 44100;
+    bool force = false;               // replace an existing segment of that name (e.g. left by a crashed run)
+};
+
+class ShmPublisher {
+public:
+    explicit ShmPublisher(const ShmOptions& options = ShmOptions()); // throws if the name is taken, unless `force`
+    ~ShmPublisher();                                                 // marks the ring closed and unlinks it
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    // The PPU's frame buffer goes straight into the slot, no intermediate vector, and only the tiles
+    // changed since that slot was last written from this PPU
+    void publish(const PPU& ppu, uint64_t frame_number, const int16_t* audio = nullptr, size_t samples = 0) noexcept;
+    void publish(const uint8_t* rgb, uint64_t frame_number, const int16_t* audio = nullptr, size_t samples = 0) noexcept;
+    uint64_t published() const noexcept;
+
+private:
+    std::string name_;
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    std::vector<uint64_t> slot_seen_; // per slot, the PPU generation its frame is up to date with (0: none)
+
+    ShmLayout::Header& header() const noexcept { return *reinterpret_cast<ShmLayout::Header*>(base_); }
+    ShmLayout::Slot& begin_slot(uint64_t index) noexcept;
+    void finish_slot(ShmLayout::Slot& slot, uint64_t index, uint64_t frame_number, const int16_t* audio, size_t samples) noexcept;
+};
+
+struct ShmFrame {
+    uint64_t index = 0;                  // publish order, from 0
+    uint64_t frame_number = 0;
+    uint64_t timestamp_ns = 0;
+    uint64_t missed = 0;                 // frames overwritten before this reader got to them
+    std::vector<uint8_t> rgb;
+    std::vector<int16_t> audio;
+};
+
+class ShmReader {
+public:
+    enum class Result { Frame, Timeout, Closed };
+
+    explicit ShmReader(const std::string& name = "/nes-frames");
+    ~ShmReader();
+    ShmReader(const ShmReader&) = delete;
+    ShmReader& operator=(const ShmReader&) = delete;
+
+    // The next frame in publish order, waiting up to timeout_ms (negative: forever)
+    Result next(ShmFrame& frame, int timeout_ms = -1);
+    void skip_to_latest() noexcept;      // for viewers that only want the newest frame
+    uint32_t sample_rate() const noexcept { return header().sample_rate; }
+
+private:
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t next_index_ = 0;
+
+    ShmLayout::Header& header() const noexcept { return *reinterpret_cast<ShmLayout::Header*>(base_); } // mapped writable for `waiters`
+    bool try_read(uint64_t index, ShmFrame& frame) const;
+};
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nes {
+// One executed instruction, captured before it runs. Fixed size so the ring is a flat array and the
+// trace file is the records verbatim.
+struct TraceRecord {
+    uint64_t cycle;           // CPU cycle the instruction starts on
+    uint16_t pc;
+    int16_t scanline;         // -1 is the pre-render line
+    uint16_t dot;
+    uint8_t opcode, operand1, operand2;
+    uint8_t a, x, y, p, sp;
+    uint8_t reserved[2];
+};
+static_assert(sizeof(TraceRecord) == 24, "trace files store records verbatim");
+
+// Preallocated ring of the most recent records; push never allocates and never fails.
+// Trace file: "NTRC", u32 version, u64 record count, records oldest first, all in host byte order.
+class TraceBuffer {
+public:
+    explicit TraceBuffer(size_t capacity = size_t(1) << 20); // rounded up to a power of two
+    void push(const TraceRecord& record) noexcept { records_[head_++ & mask_] = record; }
+    size_t capacity() const noexcept { return records_.size(); }
+    size_t size() const noexcept { return head_ < records_.size() ? static_cast<size_t>(head_) : records_.size(); }
+    uint64_t total() const noexcept { return head_; } // including records already overwritten
+    void clear() noexcept { head_ = 0; }
+    std::vector<TraceRecord> records() const; // oldest first
+    void save(const std::string& path) const;
+    static std::vector<TraceRecord> load(const std::string& path);
+
+private:
+    std::vector<TraceRecord> records_;
+    uint64_t head_ = 0;
+    uint64_t mask_;
+};
+}
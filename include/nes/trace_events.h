@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nes {
+enum class TraceCategory : uint8_t { Emulator, Cpu, Ppu, Apu, Io, Output };
+
+// One timeline entry. Names are string literals, so recording never copies or allocates.
+struct TraceEvent {
+    uint64_t start_ns = 0;         // steady clock
+    uint64_t duration_ns = 0;      // complete events only
+    const char* name = nullptr;
+    const char* arg_name = nullptr; // null: no argument
+    uint64_t arg = 0;
+    TraceCategory category = TraceCategory::Emulator;
+    char phase = 'X';              // 'X' complete, 'i' instant
+};
+
+struct TraceEventOptions {
+    size_t events_per_thread = 1 << 16; // per-thread ring; events beyond an unflushed full ring are dropped
+    uint64_t window_ms = 2000;          // how much history capture() keeps
+    unsigned flush_interval_ms = 50;
+    bool io_writes = false;             // one instant event per $2000-$401F write; busy, so off by default
+};
+
+// Frame-phase timeline in Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev). While a recorder
+// is started, instrumented code on any thread appends to its own ring buffer with no locks or
+// allocation after the thread's first event; a background thread drains the rings into a bounded
+// window that capture() writes out on demand. With no recorder started each probe is one atomic load.
+// A started recorder must be stopped before it is destroyed, and no instrumented thread may still be
+// recording into it at that point.
+class TraceEventRecorder {
+public:
+    explicit TraceEventRecorder(const TraceEventOptions& options = TraceEventOptions());
+    ~TraceEventRecorder();
+    TraceEventRecorder(const TraceEventRecorder&) = delete;
+    TraceEventRecorder& operator=(const TraceEventRecorder&) = delete;
+
+    void start(); // becomes the process-wide recorder; throws if another one is active
+    void stop();  // flushes what is left; the window stays available to capture()
+    static TraceEventRecorder* active() noexcept { return active_.load(std::memory_order_acquire); }
+    static uint64_t now_ns() noexcept;
+
+    void complete(const char* name, TraceCategory category, uint64_t start_ns, uint64_t duration_ns,
+                  const char* arg_name = nullptr, uint64_t arg = 0) noexcept;
+    void instant(const char* name, TraceCategory category, const char* arg_name = nullptr, uint64_t arg = 0) noexcept;
+    void name_thread(const std::string& name); // label for the calling thread's track
+    bool io_writes() const noexcept { return options_.io_writes; }
+
+    std::string capture_json();                // the retained window as a JSON document
+    void capture(const std::string& path);     // same, written to a file
+    uint64_t dropped() const noexcept;         // events lost to full rings
+
+private:
+    struct alignas(64) ThreadBuffer {
+        explicit ThreadBuffer(size_t capacity, uint32_t id) : events(capacity), tid(id) {}
+        std::vector<TraceEvent> events;        // power-of-two ring
+        uint32_t tid;
+        std::string name;
+        alignas(64) std::atomic<uint64_t> head{ 0 }; // written by the owning thread
+        alignas(64) std::atomic<uint64_t> tail{ 0 }; // written by the flusher
+        std::atomic<uint64_t> dropped{ 0 };
+    };
+    struct WindowEvent { TraceEvent event; uint32_t tid; };
+
+    static std::atomic<TraceEventRecorder*> active_;
+    TraceEventOptions options_;
+    const uint64_t id_;                        // tells thread-local caches apart across recorders
+    mutable std::mutex buffers_lock_;          // taken once per thread, and by the flusher
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::mutex window_lock_;
+    std::deque<WindowEvent> window_;
+    std::mutex flusher_lock_;
+    std::condition_variable flusher_wake_;
+    bool running_ = false;
+    std::thread flusher_;
+
+    ThreadBuffer& local();
+    void push(const TraceEvent& event) noexcept;
+    void flush();
+    void flusher_loop();
+};
+
+// Records a complete event covering its own lifetime, if a recorder is active at construction
+class TraceScope {
+public:
+    TraceScope(const char* name, TraceCategory category, const char* arg_name = nullptr, uint64_t arg = 0) noexcept
+        : recorder_(TraceEventRecorder::active()), name_(name), arg_name_(arg_name), arg_(arg), category_(category) {
+        if (recorder_) start_ns_ = TraceEventRecorder::now_ns();
+    }
+    ~TraceScope() {
+        if (recorder_) recorder_->complete(name_, category_, start_ns_, TraceEventRecorder::now_ns() - start_ns_, arg_name_, arg_);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceEventRecorder* recorder_;
+    const char* name_;
+    const char* arg_name_;
+    uint64_t arg_;
+    uint64_t start_ns_ = 0;
+    TraceCategory category_;
+};
+
+inline void trace_instant(const char* name, TraceCategory category, const char* arg_name = nullptr, uint64_t arg = 0) noexcept {
+    if (TraceEventRecorder* recorder = TraceEventRecorder::active()) recorder->instant(name, category, arg_name, arg);
+}
+}
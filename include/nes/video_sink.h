@@ -0,0 +1,95 @@
+#pragma once
+#include "nes/frame_pacer.h"
+#include "nes/wav.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nes {
+enum class VideoFormat {
+    Y4m,    // YUV4MPEG2, 4:2:0 full range, 8:7 pixel aspect; ffmpeg and mpv read it directly
+    RawRgb, // bare 256x240 RGB24 frames
+};
+
+struct VideoSinkOptions {
+    std::string path = "out.y4m";  // "-" writes to stdout, for piping into an encoder
+    VideoFormat format = VideoFormat::Y4m;
+    unsigned frame_interval = 1;   // record every Nth frame; audio is kept for all of them
+    size_t queue_frames = 16;      // frames in flight before the sink starts dropping
+    double refresh_hz = ntsc_refresh_hz;
+    std::string audio_path;        // optional WAV written alongside, sample-aligned with the video
+    uint32_t audio_sample_rate = 44100;
+};
+
+// Streams emulated frames to disk on its own writer thread. push_frame() copies into a preallocated
+// slot of a bounded single-producer/single-consumer ring and returns; it never waits for the writer.
+// When the ring is full the frame is dropped and the writer repeats the previous one in its place,
+// as it does for frames the caller never drew, so the video keeps its length and stays in step with
+// the audio. YUV conversion (SSE2 where
+// available) happens on the writer thread.
+class VideoSink {
+public:
+    static constexpr int width = 256;
+    static constexpr int height = 240;
+
+    explicit VideoSink(const VideoSinkOptions& options);
+    ~VideoSink();                  // closes, ignoring errors
+    VideoSink(const VideoSink&) = delete;
+    VideoSink& operator=(const VideoSink&) = delete;
+
+    // One emulated frame (RGB24, as PPU::render_frame() produces) and the audio generated with it.
+    // Returns false if the frame had to be dropped. Call from one thread only.
+    bool push_frame(const std::vector<uint8_t>& rgb, const int16_t* audio = nullptr, size_t samples = 0);
+    bool wants_frame() const noexcept { return frames_seen_ % options_.frame_interval == 0; } // render the next one?
+    // A frame that was emulated but not drawn (the pacer skipped it): recorded, if it falls on the
+    // frame interval, as a repeat of the previous image, with its audio
+    void push_repeat(const int16_t* audio = nullptr, size_t samples = 0);
+    void close();                  // drains the queue and finalises the files; throws on write errors
+
+    uint64_t frames_written() const noexcept { return frames_written_.load(std::memory_order_relaxed); }
+    uint64_t frames_dropped() const noexcept { return frames_dropped_; }
+
+private:
+    struct Slot {
+        std::vector<uint8_t> rgb;
+        std::vector<int16_t> audio;
+        uint32_t repeat_before = 0; // dropped frames to fill with the previous image first
+    };
+
+    VideoSinkOptions options_;
+    FILE* out_ = nullptr;
+    std::unique_ptr<WavWriter> wav_;
+    std::vector<Slot> slots_;      // power-of-two ring
+    alignas(64) std::atomic<uint64_t> head_{ 0 }; // producer
+    alignas(64) std::atomic<uint64_t> tail_{ 0 }; // writer
+    alignas(64) std::atomic<bool> stopping_{ false };
+    std::atomic<uint64_t> frames_written_{ 0 };
+    std::mutex wake_lock_;         // only the writer ever waits on it
+    std::condition_variable wake_;
+    std::thread writer_;
+    std::string error_;            // first write error, set by the writer
+
+    // Producer-side state
+    uint64_t frames_seen_ = 0;
+    uint64_t frames_dropped_ = 0;
+    uint32_t pending_repeats_ = 0;
+    std::vector<int16_t> pending_audio_; // audio of unrecorded, repeated or dropped frames, sent with the next slot
+
+    // Writer-side state
+    std::vector<uint8_t> frame_;   // last encoded frame, as written
+    bool have_frame_ = false;
+
+    void open_outputs();
+    void discard_outputs() noexcept; // constructor failure: close and delete whatever was created
+    void writer_loop();
+    void write_slot(Slot& slot);
+    void write_frame(bool repeat);
+    void write_audio(const int16_t* samples, size_t count);
+};
+}
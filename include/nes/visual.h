@@ -1,5 +1,6 @@
 #pragma once
 #include "nes/rom.h"
+#include "nes/cow_memory.h"
 #include <cstdint>
 #include <vector>
 #include <array>
@@ -7,27 +8,56 @@
 
 namespace nes {
 class CPU6502;
+class Scheduler;
+
+struct DirtyRect { uint16_t x, y, width, height; }; // pixels, multiples of 8
+
+// Nametable layouts: which 1 KB VRAM page each of $2000/$2400/$2800/$2C00 shows
+enum class Mirroring : uint8_t { Horizontal, Vertical, SingleScreenA, SingleScreenB, FourScreen };
 
 class PPU {
 public:
     explicit PPU(const ROM* rom, CPU6502* cpu);
+    PPU(const PPU& other, CPU6502* cpu); // fork: VRAM/CHR-RAM pages shared copy-on-write, frame buffer not copied
     uint8_t read_register(uint8_t reg);
     void write_register(uint8_t reg, uint8_t value);
     void step();
-    bool nmi_triggered() const { return nmi_pending_; }
+    void run_dots(uint64_t dots);  // batch advance, stays inside this translation unit
+    void catch_up();               // lazily run up to the scheduler's master clock (3 dots per CPU cycle)
+    void attach_scheduler(Scheduler* scheduler) noexcept { scheduler_ = scheduler; }
+    uint64_t dot() const noexcept { return state_.dot_; }
+    bool nmi_triggered() const { return state_.nmi_pending_; }
+    void acknowledge_nmi() noexcept { state_.nmi_pending_ = false; }
+    int sprite_zero_line() const noexcept { return state_.oam_[0] + 1; } // first line sprite 0 can hit
+    void set_vblank(bool active); // timing stub entry for audio-only runs
+    void set_render_enabled(bool enabled) noexcept { render_enabled_ = enabled; } // off: timing and flags only, no pixels
     void render_frame(std::vector<uint8_t>& rgb_pixels) const;
+    // Incremental publish for one consumer: `rgb_pixels` holds the frame that consumer last took, and
+    // `seen` the generation it was given then (0 for nothing yet, e.g. a fresh buffer). Only the 8x8
+    // tiles changed since are copied in, `dirty` receives them merged into rectangles, and `seen` is
+    // advanced. Any number of consumers can follow the same PPU, each with its own `seen`.
+    void render_frame(std::vector<uint8_t>& rgb_pixels, std::vector<DirtyRect>& dirty, uint64_t& seen) const;
+    void copy_frame(uint8_t* rgb_pixels) const; // 256x240x3 bytes into caller memory
+    void copy_frame(uint8_t* rgb_pixels, uint64_t& seen, std::vector<DirtyRect>* dirty = nullptr) const; // incremental, as above
+    const uint8_t* frame_data() const; // the live 256x240x3 buffer (allocated black on first use); stable until the PPU is rebuilt
+    size_t frame_buffer_bytes() const noexcept { return frame_buffer_.capacity(); }
     void render_scanline();
-    void oam_dma(uint8_t page);
+    void oam_dma(const uint8_t* page); // 256 bytes into OAM from OAMADDR on, wrapping; OAMADDR ends where it began
     std::string debug_info() const;
 
     // Read CHR memory (0x0000 - 0x1FFF)
     uint8_t read_chr(uint16_t addr) const;
     void write_chr(uint16_t addr, uint8_t value); // only for CHR-RAM
 
-    // VRAM (nametables 0x000-0x7FF)
-    uint8_t read_vram(uint16_t addr) const;
+    // Nametable space $2000-$2FFF (only the low 12 bits are used), through the page table below
+    uint8_t read_vram(uint16_t addr) const noexcept { return vram_.page(state_.nametable_pages_[(addr >> 10) & 3])[addr & 0x03FF]; }
     void write_vram(uint16_t addr, uint8_t value);
 
+    // Nametable mapping, starting from the iNES header; mappers may switch it at any time
+    void set_mirroring(Mirroring mode) noexcept;
+    void map_nametable(int slot, uint8_t page) noexcept; // slot 0-3 ($2000 + slot * $400) shows VRAM page 0-3
+    Mirroring mirroring() const noexcept { return static_cast<Mirroring>(state_.mirroring_); }
+
     // Palette RAM (32 bytes)
     uint8_t read_palette(uint16_t addr) const;
     void write_palette(uint16_t addr, uint8_t value);
@@ -37,51 +67,80 @@ public:
 
     size_t chr_size() const noexcept;
 
+    // Everything a save state needs except VRAM and CHR-RAM, kept POD so it copies in one go
+    struct State {
+        // PPU internal memory
+        std::array<uint8_t, 0x20> palette_;   // 32 bytes palette RAM
+        std::array<uint8_t, 0x100> oam_;      // sprite OAM
+        uint8_t mirroring_;                 // Mirroring, as last set; map_nametable() may since have changed a slot
+        std::array<uint8_t, 4> nametable_pages_; // VRAM page per nametable slot
+
+        // Registers
+        uint8_t ppuctrl_, ppumask_, ppustatus_, oamaddr_, ppuscroll_, ppuaddr_, ppudata_;
+        uint16_t vram_addr_, temp_addr_;
+        uint8_t fine_x_;
+        bool write_toggle_;
+
+        // Scrolling and rendering state
+        int scanline_, cycle_;
+        uint8_t scroll_x_, scroll_y_;
+        uint16_t nametable_base_;
+        bool nmi_pending_;
+        uint16_t coarse_x_, coarse_y_, fine_y_;
+        bool sprite_overflow_, sprite_zero_hit_;
+        std::array<uint8_t, 256> scanline_pixels_; // For scanline rendering
+        std::array<uint8_t, 256> scanline_palettes_;
+
+        // Sprite evaluation
+        std::array<uint8_t, 0x100> secondary_oam_; // 32 sprites * 4 bytes
+        int sprite_count_;
+        uint8_t oam_addr_secondary_;
+
+        // Masking
+        bool show_bg_, show_sprites_, bg_left_clip_, sprite_left_clip_;
+
+        // Timeline
+        uint64_t dot_;
+    };
+    const State& state() const noexcept { return state_; }
+    void set_state(const State& state) noexcept { state_ = state; }       // assumes valid_state(state)
+    static bool valid_state(const State& state) noexcept; // every field used as an index (nametable pages, beam, sprites) in range
+    void sync_from(const PPU& other) noexcept; // same game: state copied, VRAM/CHR-RAM pages shared, frame buffer kept
+
+    using Vram = CowMemory<0x1000>;    // four 1 KB nametables; pages 2-3 stay on the shared zero page unless four-screen
+    using ChrRam = CowMemory<0x2000>;
+    Vram& vram() noexcept { return vram_; }
+    const Vram& vram() const noexcept { return vram_; }
+    bool has_chr_ram() const noexcept { return !has_chr_rom_; }
+    ChrRam& chr_ram() noexcept { return chr_ram_; }
+    const ChrRam& chr_ram() const noexcept { return chr_ram_; }
+
 private:
     const ROM* rom_;                 // not owned
     CPU6502* cpu_;
-    std::vector<uint8_t> chr_ram_;   // used if ROM has no CHR ROM
+    ChrRam chr_ram_;                 // used if ROM has no CHR ROM; stays on the shared zero pages otherwise
     bool has_chr_rom_;
 
-    // PPU internal memory
-    std::array<uint8_t, 0x800> vram_;     // nametables + attribute table area
-    std::array<uint8_t, 0x20> palette_;   // 32 bytes palette RAM
-    std::array<uint8_t, 0x100> oam_;      // sprite OAM
-    uint8_t mirroring_;                 // 0=horizontal, 1=vertical
-
-    // Registers
-    uint8_t ppuctrl_, ppumask_, ppustatus_, oamaddr_, ppuscroll_, ppuaddr_, ppudata_;
-    uint16_t vram_addr_, temp_addr_;
-    uint8_t fine_x_;
-    bool write_toggle_;
-
-    // Scrolling and rendering state
-    int scanline_, cycle_;
-    uint8_t scroll_x_, scroll_y_;
-    uint16_t nametable_base_;
-    bool nmi_pending_;
-    uint16_t coarse_x_, coarse_y_, fine_y_;
-    bool sprite_overflow_, sprite_zero_hit_;
-    std::array<uint8_t, 256> scanline_pixels_; // For scanline rendering
-    std::array<uint8_t, 256> scanline_palettes_;
-    std::vector<std::array<uint8_t, 4>> sprite_buffer_; // Up to 8 sprites per scanline
-
-    // Sprite evaluation
-    std::array<uint8_t, 0x100> secondary_oam_; // 32 sprites * 4 bytes
-    int sprite_count_;
-    uint8_t oam_addr_secondary_;
-
-    // Masking
-    bool show_bg_, show_sprites_, bg_left_clip_, sprite_left_clip_;
+    State state_;
+    Vram vram_;
 
     // Performance
-    mutable std::vector<uint8_t> frame_buffer_;  // Mutable for const render_frame
+    mutable std::vector<uint8_t> frame_buffer_;  // Mutable for const render_frame; allocated at the first rendered line
+    // Change tracking: a pixel change stamps its tile and tile row with the current generation, which
+    // moves on at every incremental publish. Generations come from one process-wide counter, so a
+    // consumer moving on to a newer PPU (a rebuilt core, a fork) finds all of its tiles changed.
+    mutable uint64_t generation_;
+    mutable std::array<uint64_t, 30> row_generation_{}; // mutable like the buffer they describe
+    mutable std::array<uint64_t, 30 * 32> tile_generation_{};
+
+    Scheduler* scheduler_;
+    bool render_enabled_;
 
     static const std::array<std::array<uint8_t,3>, 64> nes_palette_;
-    uint16_t mirror_vram_addr(uint16_t addr) const;
     void evaluate_sprites();
     void fetch_background();
     void render_pixel(int x);
+    void allocate_frame_buffer() const;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+namespace nes {
+// Streaming 16-bit PCM WAV writer; chunk sizes are patched in on close.
+class WavWriter {
+public:
+    WavWriter(const std::string& path, uint32_t sample_rate, uint16_t channels = 1);
+    ~WavWriter();
+    void write(const int16_t* samples, size_t count);
+    void close();
+    uint64_t samples_written() const noexcept { return samples_written_; }
+
+private:
+    std::ofstream out_;
+    uint32_t sample_rate_;
+    uint16_t channels_;
+    uint64_t samples_written_;
+    void write_header(uint32_t data_bytes);
+};
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "nes/rom_builder.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace nes {
+// Generated NROM test programs, each stressing one part of the machine. They loop forever and are
+// fully deterministic, so any frame count gives a reproducible workload.
+enum class Workload {
+    Alu,            // register arithmetic, shifts and logic in a tight loop
+    MemoryBound,    // indexed and indirect sweeps over the whole of internal RAM
+    PpuRegisters,   // $2002/$2005/$2006/$2007/$2003/$2004 traffic with rendering off
+    Sprites,        // 64 moving sprites, OAM DMA every NMI
+    Scrolling,      // filled nametable, scroll registers rewritten every NMI
+    ApuMusic,       // NMI-driven driver stepping all four tone channels through a note table
+};
+
+constexpr std::array<Workload, 6> all_workloads = {
+    Workload::Alu, Workload::MemoryBound, Workload::PpuRegisters, Workload::Sprites, Workload::Scrolling, Workload::ApuMusic
+};
+
+const char* workload_name(Workload workload) noexcept;
+std::vector<uint8_t> build_workload(Workload workload); // iNES image
+}
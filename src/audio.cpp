@@ -1,4 +1,6 @@
 #include "nes/apu.h"
+#include "nes/scheduler.h"
+#include "nes/trace_events.h"
 #include <cmath>
 #include <algorithm>
 
@@ -17,24 +19,30 @@ const std::array<uint16_t, 16> APU::dmc_period_table_ = {
     428,380,340,320,286,254,226,214,190,160,142,128,106,84,72,54
 };
 
+// NTSC frame sequencer: CPU cycles from each step to the next (4-step and 5-step modes)
+static const std::array<int, 4> four_step_delays = { 7456, 7458, 7458, 7458 };
+static const std::array<int, 5> five_step_delays = { 7456, 7458, 7458, 7452, 7458 };
+static constexpr int first_frame_step_delay = 7457;
+
 APU::APU() { reset(); }
 
 void APU::reset() {
-    frame_counter_ = 0; frame_mode_ = 0; frame_step_ = 0; frame_irq_ = false;
-    pulse1_ = {}; pulse2_ = {}; triangle_ = {}; noise_ = {}; dmc_ = {};
+    state_.frame_counter_ = 0; state_.frame_mode_ = 0; state_.frame_step_ = 0; state_.frame_irq_ = false; state_.irq_inhibit_ = false;
+    if (scheduler_) scheduler_->schedule(EventType::ApuFrame, scheduler_->now() + first_frame_step_delay);
+    state_.pulse1_ = {}; state_.pulse2_ = {}; state_.triangle_ = {}; state_.noise_ = {}; state_.dmc_ = {};
 }
 
 uint8_t APU::read_register(uint16_t addr) {
     switch (addr) {
         case 0x4015: {
-            uint8_t status = (pulse1_.length_counter_ > 0 ? 1 : 0) |
-                             (pulse2_.length_counter_ > 0 ? 2 : 0) |
-                             (triangle_.length_counter_ > 0 ? 4 : 0) |
-                             (noise_.length_counter_ > 0 ? 8 : 0) |
-                             (dmc_.length_ > 0 ? 16 : 0) |
-                             (frame_irq_ ? 64 : 0) |
-                             (dmc_.irq_ ? 128 : 0);
-            frame_irq_ = false;
+            uint8_t status = (state_.pulse1_.length_counter_ > 0 ? 1 : 0) |
+                             (state_.pulse2_.length_counter_ > 0 ? 2 : 0) |
+                             (state_.triangle_.length_counter_ > 0 ? 4 : 0) |
+                             (state_.noise_.length_counter_ > 0 ? 8 : 0) |
+                             (state_.dmc_.length_ > 0 ? 16 : 0) |
+                             (state_.frame_irq_ ? 64 : 0) |
+                             (state_.dmc_.irq_ ? 128 : 0);
+            state_.frame_irq_ = false;
             return status;
         }
         default: return 0;
@@ -43,61 +51,83 @@ uint8_t APU::read_register(uint16_t addr) {
 
 void APU::write_register(uint16_t addr, uint8_t value) {
     switch (addr) {
-        case 0x4000: pulse1_.duty_ = (value >> 6) & 3; pulse1_.length_ = value & 0x20; pulse1_.envelope_ = value & 0x0F; break;
-        case 0x4001: pulse1_.sweep_ = value; pulse1_.sweep_reload_ = true; break;
-        case 0x4002: pulse1_.timer_ = (pulse1_.timer_ & 0xFF00) | value; break;
-        case 0x4003: pulse1_.timer_ = (pulse1_.timer_ & 0x00FF) | ((value & 7) << 8); pulse1_.length_counter_ = length_table_[value >> 3]; pulse1_.envelope_start_ = true; break;
-        case 0x4004: pulse2_.duty_ = (value >> 6) & 3; pulse2_.length_ = value & 0x20; pulse2_.envelope_ = value & 0x0F; break;
-        case 0x4005: pulse2_.sweep_ = value; pulse2_.sweep_reload_ = true; break;
-        case 0x4006: pulse2_.timer_ = (pulse2_.timer_ & 0xFF00) | value; break;
-        case 0x4007: pulse2_.timer_ = (pulse2_.timer_ & 0x00FF) | ((value & 7) << 8); pulse2_.length_counter_ = length_table_[value >> 3]; pulse2_.envelope_start_ = true; break;
-        case 0x4008: triangle_.linear_ = value & 0x7F; triangle_.length_ = value & 0x80; break;
-        case 0x400A: triangle_.timer_ = (triangle_.timer_ & 0xFF00) | value; break;
-        case 0x400B: triangle_.timer_ = (triangle_.timer_ & 0x00FF) | ((value & 7) << 8); triangle_.length_counter_ = length_table_[value >> 3]; triangle_.linear_reload_ = true; break;
-        case 0x400C: noise_.length_ = value & 0x20; noise_.envelope_ = value & 0x0F; break;
-        case 0x400E: noise_.timer_ = noise_period_table_[value & 0x0F]; noise_.mode_ = (value >> 7) & 1; break;
-        case 0x400F: noise_.length_counter_ = length_table_[value >> 3]; noise_.envelope_start_ = true; break;
-        case 0x4010: dmc_.irq_enable_ = (value >> 7) & 1; dmc_.loop_ = (value >> 6) & 1; dmc_.timer_ = dmc_period_table_[value & 0x0F]; break;
-        case 0x4011: dmc_.direct_load_ = value & 0x7F; break;
-        case 0x4012: dmc_.sample_address_ = value; break;
-        case 0x4013: dmc_.sample_length_ = value; break;
+        case 0x4000: state_.pulse1_.duty_ = (value >> 6) & 3; state_.pulse1_.length_ = value & 0x20; state_.pulse1_.envelope_ = value & 0x0F; break;
+        case 0x4001: state_.pulse1_.sweep_ = value; state_.pulse1_.sweep_reload_ = true; break;
+        case 0x4002: state_.pulse1_.timer_ = (state_.pulse1_.timer_ & 0xFF00) | value; break;
+        case 0x4003: state_.pulse1_.timer_ = (state_.pulse1_.timer_ & 0x00FF) | ((value & 7) << 8); state_.pulse1_.length_counter_ = length_table_[value >> 3]; state_.pulse1_.envelope_start_ = true; break;
+        case 0x4004: state_.pulse2_.duty_ = (value >> 6) & 3; state_.pulse2_.length_ = value & 0x20; state_.pulse2_.envelope_ = value & 0x0F; break;
+        case 0x4005: state_.pulse2_.sweep_ = value; state_.pulse2_.sweep_reload_ = true; break;
+        case 0x4006: state_.pulse2_.timer_ = (state_.pulse2_.timer_ & 0xFF00) | value; break;
+        case 0x4007: state_.pulse2_.timer_ = (state_.pulse2_.timer_ & 0x00FF) | ((value & 7) << 8); state_.pulse2_.length_counter_ = length_table_[value >> 3]; state_.pulse2_.envelope_start_ = true; break;
+        case 0x4008: state_.triangle_.linear_ = value & 0x7F; state_.triangle_.length_ = value & 0x80; break;
+        case 0x400A: state_.triangle_.timer_ = (state_.triangle_.timer_ & 0xFF00) | value; break;
+        case 0x400B: state_.triangle_.timer_ = (state_.triangle_.timer_ & 0x00FF) | ((value & 7) << 8); state_.triangle_.length_counter_ = length_table_[value >> 3]; state_.triangle_.linear_reload_ = true; break;
+        case 0x400C: state_.noise_.length_ = value & 0x20; state_.noise_.envelope_ = value & 0x0F; break;
+        case 0x400E: state_.noise_.timer_ = noise_period_table_[value & 0x0F]; state_.noise_.mode_ = (value >> 7) & 1; break;
+        case 0x400F: state_.noise_.length_counter_ = length_table_[value >> 3]; state_.noise_.envelope_start_ = true; break;
+        case 0x4010: state_.dmc_.irq_enable_ = (value >> 7) & 1; state_.dmc_.loop_ = (value >> 6) & 1; state_.dmc_.timer_ = dmc_period_table_[value & 0x0F]; break;
+        case 0x4011: state_.dmc_.direct_load_ = value & 0x7F; break;
+        case 0x4012: state_.dmc_.sample_address_ = value; break;
+        case 0x4013: state_.dmc_.sample_length_ = value; break;
         case 0x4015: {
-            pulse1_.enabled_ = value & 1; pulse2_.enabled_ = (value >> 1) & 1; triangle_.enabled_ = (value >> 2) & 1; noise_.enabled_ = (value >> 3) & 1; dmc_.enabled_ = (value >> 4) & 1;
-            if (!pulse1_.enabled_) pulse1_.length_counter_ = 0; if (!pulse2_.enabled_) pulse2_.length_counter_ = 0; if (!triangle_.enabled_) triangle_.length_counter_ = 0; if (!noise_.enabled_) noise_.length_counter_ = 0; if (!dmc_.enabled_) dmc_.length_ = 0;
-            dmc_.irq_ = false;
+            state_.pulse1_.enabled_ = value & 1; state_.pulse2_.enabled_ = (value >> 1) & 1; state_.triangle_.enabled_ = (value >> 2) & 1; state_.noise_.enabled_ = (value >> 3) & 1; state_.dmc_.enabled_ = (value >> 4) & 1;
+            if (!state_.pulse1_.enabled_) state_.pulse1_.length_counter_ = 0; if (!state_.pulse2_.enabled_) state_.pulse2_.length_counter_ = 0; if (!state_.triangle_.enabled_) state_.triangle_.length_counter_ = 0; if (!state_.noise_.enabled_) state_.noise_.length_counter_ = 0; if (!state_.dmc_.enabled_) state_.dmc_.length_ = 0;
+            state_.dmc_.irq_ = false;
             break;
         }
-        case 0x4017: frame_mode_ = (value >> 7) & 1; frame_counter_ = 0; frame_step_ = 0; if (frame_mode_) step(); break;
+        case 0x4017:
+            state_.frame_mode_ = (value >> 7) & 1; state_.irq_inhibit_ = (value >> 6) & 1; state_.frame_step_ = 0;
+            if (state_.irq_inhibit_) state_.frame_irq_ = false;
+            if (state_.frame_mode_) { quarter_frame(); half_frame(); }
+            if (scheduler_) scheduler_->schedule(EventType::ApuFrame, scheduler_->now() + first_frame_step_delay);
+            break;
     }
 }
 
 void APU::step() {
-    frame_counter_++;
-    if (frame_counter_ % 2 == 0) {
-        pulse1_.step_timer(); pulse2_.step_timer(); noise_.step_timer(); dmc_.step_timer();
+    state_.frame_counter_++;
+    if (state_.frame_counter_ % 2 == 0) {
+        state_.pulse1_.step_timer(); state_.pulse2_.step_timer(); state_.noise_.step_timer(); state_.dmc_.step_timer();
     }
-    if (frame_counter_ % 4 == 0) {
-        triangle_.step_timer();
+    if (state_.frame_counter_ % 4 == 0) {
+        state_.triangle_.step_timer();
+    }
+    state_.pulse1_.step_sweep(); state_.pulse2_.step_sweep();
+}
+
+void APU::quarter_frame() { state_.pulse1_.step_envelope(); state_.pulse2_.step_envelope(); state_.triangle_.step_linear(); state_.noise_.step_envelope(); }
+void APU::half_frame() { state_.pulse1_.step_length(); state_.pulse2_.step_length(); state_.triangle_.step_length(); state_.noise_.step_length(); }
+
+bool APU::valid_state(const State& state) noexcept {
+    const int steps = state.frame_mode_ == 0 ? static_cast<int>(four_step_delays.size()) : static_cast<int>(five_step_delays.size());
+    if (state.frame_step_ < 0 || state.frame_step_ >= steps) return false;
+    for (const Pulse* pulse : { &state.pulse1_, &state.pulse2_ }) {
+        if (pulse->duty_ > 3 || pulse->sequencer_ > 7) return false; // the sequencer is a shift count into the duty byte
     }
-    if (frame_mode_ == 0) {
-        if (frame_counter_ == 3728) { pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); }
-        if (frame_counter_ == 7456) { pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); pulse1_.step_length(); pulse2_.step_length(); triangle_.step_length(); noise_.step_length(); }
-        if (frame_counter_ == 11185) { pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); }
-        if (frame_counter_ == 14914) { frame_counter_ = 0; pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); pulse1_.step_length(); pulse2_.step_length(); triangle_.step_length(); noise_.step_length(); if (!frame_mode_) frame_irq_ = true; }
-    } else {
-        if (frame_counter_ == 3728) { pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); }
-        if (frame_counter_ == 7456) { pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); pulse1_.step_length(); pulse2_.step_length(); triangle_.step_length(); noise_.step_length(); }
-        if (frame_counter_ == 11185) { pulse1_.step_envelope(); pulse2_.step_envelope(); triangle_.step_linear(); noise_.step_envelope(); }
-        if (frame_counter_ == 18640) { frame_counter_ = 0; }
+    return state.triangle_.sequencer_ <= 31;
+}
+
+int APU::clock_frame_sequencer() {
+    int step = state_.frame_step_;
+    if (state_.frame_mode_ == 0) {
+        quarter_frame();
+        if (step == 1 || step == 3) half_frame();
+        if (step == 3 && !state_.irq_inhibit_) state_.frame_irq_ = true;
+        state_.frame_step_ = (step + 1) % 4;
+        return four_step_delays[step];
     }
-    pulse1_.step_sweep(); pulse2_.step_sweep();
+    if (step != 3) quarter_frame();
+    if (step == 1 || step == 4) half_frame();
+    state_.frame_step_ = (step + 1) % 5;
+    return five_step_delays[step];
 }
 
 void APU::generate_audio(int samples, std::vector<int16_t>& buffer) {
+    TraceScope scope("audio_block", TraceCategory::Apu, "samples", static_cast<uint64_t>(samples));
     buffer.resize(samples);
     for (int i = 0; i < samples; ++i) {
         step();
-        float p1 = pulse1_.output(), p2 = pulse2_.output(), t = triangle_.output(), n = noise_.output(), d = dmc_.output();
+        float p1 = state_.pulse1_.output(), p2 = state_.pulse2_.output(), t = state_.triangle_.output(), n = state_.noise_.output(), d = state_.dmc_.output();
         float pulse_out = mix_pulse(p1, p2);
         float tnd_out = mix_tnd(t, n, d);
         float mixed = pulse_out + tnd_out;
@@ -0,0 +1,226 @@
+#include "nes/batch.h"
+#include "nes/emulator.h"
+#include "nes/trace_events.h"
+#include "nes/video_sink.h"
+#include "nes/regression.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace nes;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct WorkQueue {
+    std::mutex lock;
+    std::deque<size_t> jobs;
+};
+
+struct CachedRom {
+    std::shared_ptr<const ROM> rom;
+    std::string error;
+};
+using RomCache = std::map<std::string, CachedRom>;
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string range = text.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        } catch (const std::exception&) {} // trailing newline or junk
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+void pin_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set); // best effort; an unpinned worker still runs
+#else
+    (void)cpu;
+#endif
+}
+
+// The worker's emulator is reloaded in place for every job; only the last frame is rendered unless the
+// job records video or per-frame hashes
+void run_job(const BatchJob& job, const RomCache& roms, Emulator& emu, std::vector<uint8_t>& frame, BatchResult& result) {
+    const CachedRom& rom = roms.at(job.rom_path);
+    if (!rom.rom) { result.error = rom.error; return; }
+    Movie movie;
+    movie.frames = job.inputs;
+    MoviePlayer input(movie);
+    try {
+        auto start = Clock::now();
+        emu.set_rendering(false);
+        emu.set_input_provider(&input); // before loading, so frame 0 is polled too
+        emu.load_rom(rom.rom);
+        emu.reset();
+        result.load_ms = ms_since(start);
+
+        std::unique_ptr<VideoSink> video;
+        std::vector<int16_t> audio;
+        HashLog golden, hashes;
+        const bool hashing = !job.hash_log_path.empty() || !job.golden_path.empty();
+        if (!job.golden_path.empty()) golden = HashLog::load(job.golden_path);
+        if (hashing) hashes.frames.reserve(static_cast<size_t>(job.frames));
+        if (!job.video_path.empty()) {
+            VideoSinkOptions video_options;
+            video_options.path = job.video_path;
+            video_options.audio_path = job.video_path + ".wav";
+            video_options.audio_sample_rate = Emulator::audio_sample_rate;
+            video = std::make_unique<VideoSink>(video_options);
+        }
+        if (video || hashing) {
+            emu.set_rendering(true);
+            emu.generate_frame_audio(audio); // start the audio at the first frame
+        }
+
+        start = Clock::now();
+        for (uint64_t i = 0; i < job.frames; ++i) {
+            if (i + 1 == job.frames) emu.set_rendering(true);
+            RunStatus status = emu.run_frame();
+            if (status.error || !status.frame_completed) { result.error = "Run stopped before the frame budget"; break; }
+            result.frames++;
+            if (!video && !hashing) continue;
+            emu.generate_frame_audio(audio);
+            emu.ppu().render_frame(frame);
+            if (video) video->push_frame(frame, audio.data(), audio.size());
+            if (hashing) {
+                hashes.frames.push_back(FrameHashes{ xxh64(frame.data(), frame.size()), xxh64(audio.data(), audio.size() * sizeof(int16_t)) });
+                const size_t n = hashes.frames.size() - 1;
+                if (!job.golden_path.empty() && result.divergent_frame < 0 && (n >= golden.frames.size() || golden.frames[n] != hashes.frames[n])) {
+                    result.divergent_frame = static_cast<int64_t>(n);
+                    if (!job.hash_log_path.empty()) save_ppm(job.hash_log_path + ".frame" + std::to_string(n) + ".ppm", frame);
+                }
+            }
+        }
+        result.run_ms = ms_since(start);
+        if (!job.hash_log_path.empty()) hashes.save(job.hash_log_path);
+        if (!job.golden_path.empty() && result.divergent_frame < 0) result.divergent_frame = first_divergence(hashes, golden); // golden runs longer
+        if (video) {
+            video->close();
+            result.video_frames_dropped = video->frames_dropped();
+        }
+
+        emu.ppu().render_frame(frame);
+        result.frame_hash = xxh64(frame.data(), frame.size());
+        result.ram.resize(Memory::InternalRam::size());
+        emu.memory().internal_ram().copy_to(result.ram.data());
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    emu.set_input_provider(nullptr);
+}
+}
+
+std::vector<int> nes::numa_cpu_order() {
+    std::vector<int> order;
+    for (int node = 0;; ++node) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!in) break;
+        std::string text;
+        std::getline(in, text);
+        for (int cpu : parse_cpu_list(text)) order.push_back(cpu);
+    }
+    if (order.empty()) {
+        unsigned count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < count; ++cpu) order.push_back(static_cast<int>(cpu));
+    }
+#ifdef __linux__
+    // Respect cgroup/taskset restrictions on this process
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        order.erase(std::remove_if(order.begin(), order.end(), [&](int cpu) { return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed); }), order.end());
+    }
+#endif
+    return order;
+}
+
+BatchRunner::BatchRunner(const BatchOptions& options) : options_(options), workers_(options.workers), cpu_order_(numa_cpu_order()) {
+    if (workers_ == 0) workers_ = static_cast<unsigned>(std::max<size_t>(1, cpu_order_.size()));
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs) {
+    std::vector<BatchResult> results(jobs.size());
+    stats_ = BatchStats();
+    auto start = Clock::now();
+
+    RomCache roms;
+    for (const auto& job : jobs) {
+        if (roms.count(job.rom_path)) continue;
+        CachedRom& entry = roms[job.rom_path];
+        std::ifstream ifs(job.rom_path, std::ios::binary);
+        if (!ifs) { entry.error = "Failed to open ROM"; continue; }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        try { entry.rom = std::make_shared<const ROM>(data); } catch (const std::exception& e) { entry.error = e.what(); }
+    }
+
+    const unsigned worker_count = static_cast<unsigned>(std::min<size_t>(workers_, std::max<size_t>(1, jobs.size())));
+    std::vector<WorkQueue> queues(worker_count);
+    for (size_t i = 0; i < jobs.size(); ++i) queues[i % worker_count].jobs.push_back(i);
+    std::atomic<uint64_t> steals(0);
+    std::vector<MetricsSnapshot> worker_metrics(worker_count);
+
+    auto worker = [&](unsigned id) {
+        if (options_.pin_threads && !cpu_order_.empty()) pin_to_cpu(cpu_order_[id % cpu_order_.size()]);
+        if (TraceEventRecorder* events = TraceEventRecorder::active()) events->name_thread("batch worker " + std::to_string(id));
+        std::vector<uint8_t> frame;
+        Emulator emu;
+        for (;;) {
+            size_t job = 0;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> guard(queues[id].lock);
+                if (!queues[id].jobs.empty()) { job = queues[id].jobs.back(); queues[id].jobs.pop_back(); found = true; }
+            }
+            for (unsigned k = 1; !found && k < worker_count; ++k) {
+                WorkQueue& victim = queues[(id + k) % worker_count];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.jobs.empty()) { job = victim.jobs.front(); victim.jobs.pop_front(); found = true; steals++; }
+            }
+            if (!found) { // no job ever enqueues another, so empty everywhere means done
+                worker_metrics[id] = emu.metrics();
+                return;
+            }
+            results[job].worker = static_cast<int>(id);
+            run_job(jobs[job], roms, emu, frame, results[job]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count);
+    for (unsigned id = 0; id < worker_count; ++id) threads.emplace_back(worker, id);
+    for (auto& t : threads) t.join();
+
+    for (const auto& r : results) stats_.frames += r.frames;
+    stats_.wall_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats_.frames_per_second = stats_.wall_seconds > 0 ? static_cast<double>(stats_.frames) / stats_.wall_seconds : 0;
+    stats_.steals = steals.load();
+    for (const auto& m : worker_metrics) stats_.metrics += m;
+    return results;
+}
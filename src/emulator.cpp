@@ -1,22 +1,711 @@
 #include "nes/emulator.h"
+#include "nes/save_state.h"
+#include "nes/mapped_file.h"
+#include "nes/trace_events.h"
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <type_traits>
+#include <chrono>
+#include <new>
+#include <optional>
+#include <stdexcept>
 
 using namespace nes;
 
+static constexpr uint64_t dots_per_frame = 262 * 341;       // NTSC, pre-render line included
+static constexpr uint64_t vblank_dot = 242 * 341 + 1;       // scanline 241, dot 1 (frames start at line -1)
+static constexpr uint64_t cpu_clock_hz = 1789773;
+
+static uint64_t dot_to_cycle(uint64_t dot) { return (dot + 2) / 3; } // first CPU cycle at or after the dot
+
+namespace {
+struct TimelineState {
+    uint64_t frame_start_dot;
+    uint64_t frame_count;
+    uint64_t nsf_sample_carry;
+};
+
+static_assert(std::is_trivially_copyable<CPU6502::Registers>::value, "save-state blocks must be POD");
+static_assert(std::is_trivially_copyable<Memory::State>::value, "save-state blocks must be POD");
+static_assert(std::is_trivially_copyable<PPU::State>::value, "save-state blocks must be POD");
+static_assert(std::is_trivially_copyable<APU::State>::value, "save-state blocks must be POD");
+static_assert(std::is_trivially_copyable<Scheduler>::value, "save-state blocks must be POD");
+
+// Callers size the buffer up front, so neither side bounds-checks per block
+class StateWriter {
+public:
+    explicit StateWriter(uint8_t* data) noexcept : data_(data), pos_(sizeof(SaveStateHeader)), blocks_(0) {}
+    uint8_t* reserve(StateBlock tag, size_t size) noexcept {
+        SaveStateBlock hdr{ static_cast<uint32_t>(tag), static_cast<uint32_t>(size) };
+        std::memcpy(data_ + pos_, &hdr, sizeof(hdr));
+        uint8_t* payload = data_ + pos_ + sizeof(hdr);
+        pos_ += sizeof(hdr) + size;
+        blocks_++;
+        return payload;
+    }
+    void block(StateBlock tag, const void* src, size_t size) noexcept {
+        uint8_t* payload = reserve(tag, size);
+        if (size) std::memcpy(payload, src, size);
+    }
+    size_t finish(uint64_t rom_hash) noexcept {
+        SaveStateHeader header{ save_state_magic, save_state_version, static_cast<uint32_t>(pos_), blocks_, rom_hash };
+        std::memcpy(data_, &header, sizeof(header));
+        return pos_;
+    }
+
+private:
+    uint8_t* data_;
+    size_t pos_;
+    uint32_t blocks_;
+};
+
+class StateReader {
+public:
+    StateReader(const uint8_t* data, size_t size) noexcept : data_(data), size_(size), pos_(sizeof(SaveStateHeader)) {}
+    const uint8_t* block(StateBlock tag, size_t size) noexcept {
+        if (pos_ + sizeof(SaveStateBlock) + size > size_) return nullptr;
+        SaveStateBlock hdr;
+        std::memcpy(&hdr, data_ + pos_, sizeof(hdr));
+        if (hdr.tag != static_cast<uint32_t>(tag) || hdr.size != size) return nullptr;
+        const uint8_t* payload = data_ + pos_ + sizeof(hdr);
+        pos_ += sizeof(hdr) + size;
+        return payload;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+};
+}
+
+static size_t chr_ram_size(const PPU& ppu) noexcept { return ppu.has_chr_ram() ? PPU::ChrRam::size() : 0; }
+
+// Components are members, not separate heap objects, so an instance's state is one allocation
+struct alignas(64) Emulator::Core {
+    APU apu;
+    std::optional<PPU> ppu;
+    Memory mem;
+    CPU6502 cpu;
+
+    explicit Core(const ROM* rom) // null for NSF: no PPU
+        : apu(), ppu(rom ? std::optional<PPU>(std::in_place, rom, nullptr) : std::nullopt),
+          mem(rom, ppu ? &*ppu : nullptr, &apu), cpu(&mem) {}
+    Core(const Core& other)
+        : apu(other.apu), ppu(other.ppu ? std::optional<PPU>(std::in_place, *other.ppu, nullptr) : std::nullopt),
+          mem(other.mem, ppu ? &*ppu : nullptr, &apu), cpu(&mem) {
+        cpu.set_registers(other.cpu.registers());
+    }
+};
+
 Emulator::Emulator() = default;
+Emulator::~Emulator() = default;
+
+// Reuses the block in place. The old components are gone before the new ones are built, so if a
+// constructor throws the instance is left unloaded (no core, no image, null component pointers).
+void Emulator::rebuild_core(const ROM* rom) {
+    unbind_core();
+    try {
+        if (!core_) {
+            core_.reset(new Core(rom));
+        } else {
+            Core* block = core_.release();
+            block->~Core();
+            try { new (block) Core(rom); }
+            catch (...) { ::operator delete(block, std::align_val_t(alignof(Core))); throw; }
+            core_.reset(block);
+        }
+    } catch (...) {
+        rom_.reset();
+        nsf_.reset();
+        rom_hash_ = 0;
+        throw;
+    }
+    bind_core();
+}
+
+void Emulator::unbind_core() noexcept {
+    mem_ = nullptr;
+    cpu_ = nullptr;
+    ppu_ = nullptr;
+    apu_ = nullptr;
+}
+
+void Emulator::bind_core() noexcept {
+    mem_ = &core_->mem;
+    cpu_ = &core_->cpu;
+    ppu_ = core_->ppu ? &*core_->ppu : nullptr;
+    apu_ = &core_->apu;
+    mem_->set_profiler(profiler_);
+    cpu_->set_profiler(profiler_);
+}
+
+void Emulator::set_profiler(Profiler* profiler) noexcept {
+    profiler_ = profiler;
+    if (cpu_) bind_core();
+}
+
+void Emulator::start_timeline() {
+    scheduler_.reset();
+    frame_start_dot_ = 0;
+    frame_count_ = 0;
+    audio_samples_ = 0;
+    stopped_at_breakpoint_ = false;
+    counted_ppu_dot_ = ppu_ ? ppu_->dot() : 0;
+    if (ppu_) {
+        ppu_->attach_scheduler(audio_only_ ? nullptr : &scheduler_);
+        ppu_->set_render_enabled(rendering_);
+    }
+    apu_->attach_scheduler(&scheduler_);
+    mem_->attach_scheduler(&scheduler_);
+    apu_->reset();
+    schedule_frame_events();
+    poll_input();
+}
+
+std::unique_ptr<Emulator> Emulator::clone() const {
+    auto copy = std::make_unique<Emulator>();
+    if (!cpu_) return copy;
+    copy->rom_ = rom_;
+    copy->nsf_ = nsf_;
+    copy->core_.reset(new Core(*core_));
+    copy->bind_core();
+    copy->scheduler_ = scheduler_;
+    copy->frame_start_dot_ = frame_start_dot_;
+    copy->counted_ppu_dot_ = copy->ppu_ ? copy->ppu_->dot() : 0;
+    copy->frame_count_ = frame_count_;
+    copy->audio_only_ = audio_only_;
+    copy->rendering_ = rendering_;
+    copy->input_ = input_;
+    copy->breakpoints_ = breakpoints_;
+    copy->breakpoint_count_ = breakpoint_count_;
+    copy->nsf_sample_carry_ = nsf_sample_carry_;
+    copy->rom_hash_ = rom_hash_;
+    if (copy->ppu_) copy->ppu_->attach_scheduler(audio_only_ ? nullptr : &copy->scheduler_);
+    copy->apu_->attach_scheduler(&copy->scheduler_);
+    copy->mem_->attach_scheduler(&copy->scheduler_);
+    return copy;
+}
 
 void Emulator::load_rom_bytes(const std::vector<uint8_t>& data) {
-    rom_ = std::make_unique<ROM>(data);
-    apu_ = std::make_unique<APU>();
-    ppu_ = std::make_unique<PPU>(rom_.get(), cpu_.get()); // Pass CPU
-    mem_ = std::make_unique<Memory>(rom_.get(), ppu_.get(), apu_.get());
-    cpu_ = std::make_unique<CPU6502>(mem_.get());
+    load_rom(std::make_shared<const ROM>(data));
+}
+
+void Emulator::load_rom(std::shared_ptr<const ROM> rom) {
+    if (!rom) throw std::invalid_argument("No ROM given");
+    nsf_.reset();
+    shadow_.reset();
+    rom_ = std::move(rom);
+    rebuild_core(rom_.get());
+    rom_hash_ = mem_->prg_hash();
+    start_timeline();
+}
+
+void Emulator::load_nsf_bytes(const std::vector<uint8_t>& data) {
+    auto nsf = std::make_shared<const NsfLoader>(data);
+    shadow_.reset();
+    nsf_ = std::move(nsf);
+    rom_.reset();
+    rebuild_core(nullptr);
+    mem_->map_nsf(nsf_.get());
+    rom_hash_ = mem_->prg_hash();
+    audio_only_ = true;
+    start_timeline();
+}
+
+void Emulator::set_buttons(int port, uint8_t buttons) noexcept {
+    if (mem_) mem_->set_buttons(port, buttons);
+}
+
+void Emulator::poll_input() {
+    if (!input_ || !mem_) return;
+    std::array<uint8_t, 2> pads{};
+    input_->poll(frame_count_, pads);
+    mem_->set_buttons(0, pads[0]);
+    mem_->set_buttons(1, pads[1]);
+}
+
+void Emulator::set_rendering(bool enabled) noexcept {
+    rendering_ = enabled;
+    if (ppu_) ppu_->set_render_enabled(enabled);
+}
+
+size_t Emulator::memory_footprint() const noexcept {
+    size_t bytes = sizeof(Emulator) + run_ahead_state_.capacity();
+    if (!core_) return bytes;
+    bytes += sizeof(Core) + (mem_->internal_ram().private_pages() + mem_->prg_ram().private_pages()) * cow_page_size;
+    if (ppu_) bytes += (ppu_->vram().private_pages() + ppu_->chr_ram().private_pages()) * cow_page_size + ppu_->frame_buffer_bytes();
+    if (shadow_) bytes += shadow_->memory_footprint();
+    return bytes;
+}
+
+size_t Emulator::state_size() const noexcept {
+    if (!cpu_) return 0;
+    size_t blocks = 7 + (ppu_ ? 3 : 0);
+    size_t size = sizeof(SaveStateHeader) + blocks * sizeof(SaveStateBlock)
+        + sizeof(CPU6502::Registers) + sizeof(Memory::State) + Memory::InternalRam::size() + Memory::PrgRam::size()
+        + sizeof(APU::State) + sizeof(Scheduler) + sizeof(TimelineState);
+    if (ppu_) size += sizeof(PPU::State) + PPU::Vram::size() + chr_ram_size(*ppu_);
+    return size;
+}
+
+size_t Emulator::save_state(uint8_t* buffer, size_t size) const noexcept {
+    size_t needed = state_size();
+    if (needed == 0 || size < needed) return 0;
+    StateWriter out(buffer);
+    out.block(StateBlock::Cpu, &cpu_->registers(), sizeof(CPU6502::Registers));
+    out.block(StateBlock::Memory, &mem_->state(), sizeof(Memory::State));
+    mem_->internal_ram().copy_to(out.reserve(StateBlock::InternalRam, Memory::InternalRam::size()));
+    mem_->prg_ram().copy_to(out.reserve(StateBlock::PrgRam, Memory::PrgRam::size()));
+    if (ppu_) {
+        out.block(StateBlock::Ppu, &ppu_->state(), sizeof(PPU::State));
+        ppu_->vram().copy_to(out.reserve(StateBlock::Vram, PPU::Vram::size()));
+        uint8_t* chr = out.reserve(StateBlock::ChrRam, chr_ram_size(*ppu_));
+        if (ppu_->has_chr_ram()) ppu_->chr_ram().copy_to(chr);
+    }
+    out.block(StateBlock::Apu, &apu_->state(), sizeof(APU::State));
+    out.block(StateBlock::Scheduler, &scheduler_, sizeof(Scheduler));
+    TimelineState timeline{ frame_start_dot_, frame_count_, nsf_sample_carry_ };
+    out.block(StateBlock::Timeline, &timeline, sizeof(timeline));
+    return out.finish(rom_hash_);
+}
+
+bool Emulator::load_state(const uint8_t* data, size_t size) noexcept {
+    if (!cpu_ || size < sizeof(SaveStateHeader)) return false;
+    SaveStateHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != save_state_magic || header.version != save_state_version) return false;
+    if (header.total_size != state_size() || header.total_size > size || header.rom_hash != rom_hash_) return false;
+
+    // Validate every block before touching any component
+    StateReader in(data, header.total_size);
+    const uint8_t* cpu = in.block(StateBlock::Cpu, sizeof(CPU6502::Registers));
+    const uint8_t* mem = in.block(StateBlock::Memory, sizeof(Memory::State));
+    const uint8_t* ram = in.block(StateBlock::InternalRam, Memory::InternalRam::size());
+    const uint8_t* prg_ram = in.block(StateBlock::PrgRam, Memory::PrgRam::size());
+    const uint8_t* ppu = ppu_ ? in.block(StateBlock::Ppu, sizeof(PPU::State)) : nullptr;
+    const uint8_t* vram = ppu_ ? in.block(StateBlock::Vram, PPU::Vram::size()) : nullptr;
+    const uint8_t* chr = ppu_ ? in.block(StateBlock::ChrRam, chr_ram_size(*ppu_)) : nullptr;
+    const uint8_t* apu = in.block(StateBlock::Apu, sizeof(APU::State));
+    const uint8_t* sched = in.block(StateBlock::Scheduler, sizeof(Scheduler));
+    const uint8_t* timeline = in.block(StateBlock::Timeline, sizeof(TimelineState));
+    if (!cpu || !mem || !ram || !prg_ram || !apu || !sched || !timeline || (ppu_ && (!ppu || !vram || !chr))) return false;
+
+    // Mapper offsets, nametable pages, APU sequencer steps and the scheduler heap all index arrays, so a
+    // corrupt or crafted state must never reach set_state()
+    Memory::State mem_state;
+    std::memcpy(&mem_state, mem, sizeof(mem_state));
+    if (!mem_->valid_state(mem_state)) return false;
+    PPU::State ppu_state;
+    if (ppu_) {
+        std::memcpy(&ppu_state, ppu, sizeof(ppu_state));
+        if (!PPU::valid_state(ppu_state)) return false;
+    }
+    APU::State apu_state;
+    std::memcpy(&apu_state, apu, sizeof(apu_state));
+    if (!APU::valid_state(apu_state)) return false;
+    Scheduler scheduler;
+    std::memcpy(static_cast<void*>(&scheduler), sched, sizeof(Scheduler));
+    if (!scheduler.valid_state()) return false;
+
+    CPU6502::Registers regs;
+    std::memcpy(&regs, cpu, sizeof(regs));
+    cpu_->set_registers(regs);
+    mem_->set_state(mem_state);
+    mem_->internal_ram().copy_from(ram);
+    mem_->prg_ram().copy_from(prg_ram);
+    if (ppu_) {
+        ppu_->set_state(ppu_state);
+        ppu_->vram().copy_from(vram);
+        if (ppu_->has_chr_ram()) ppu_->chr_ram().copy_from(chr);
+    }
+    apu_->set_state(apu_state);
+    scheduler_ = scheduler;
+    TimelineState t;
+    std::memcpy(&t, timeline, sizeof(t));
+    frame_start_dot_ = t.frame_start_dot;
+    frame_count_ = t.frame_count;
+    nsf_sample_carry_ = t.nsf_sample_carry;
+    stopped_at_breakpoint_ = false;
+    counted_ppu_dot_ = ppu_ ? ppu_->dot() : 0;
+    // Audio picks up at the restored time: loading a later state must not owe the whole gap as one block
+    audio_samples_ = scheduler_.now() * audio_sample_rate / cpu_clock_hz;
+    return true;
+}
+
+void Emulator::save_state_file(const std::string& path) const {
+    size_t size = state_size();
+    if (size == 0) throw std::runtime_error("No ROM loaded");
+    MappedFile file = MappedFile::create(path, size);
+    save_state(file.data(), file.size());
 }
 
-void Emulator::reset() { if (cpu_) cpu_->reset(); }
+void Emulator::load_state_file(const std::string& path) {
+    if (!cpu_) throw std::runtime_error("No ROM loaded");
+    const MappedFile file = MappedFile::open_read_only(path);
+    SaveStateHeader header{};
+    if (file.size() >= sizeof(header)) std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != save_state_magic) throw std::runtime_error("Not a save state: " + path);
+    if (header.version != save_state_version) throw std::runtime_error("Unsupported save state version " + std::to_string(header.version) + ": " + path);
+    if (header.total_size != file.size() || header.total_size != state_size()) throw std::runtime_error("Save state size does not match: " + path);
+    if (header.rom_hash != rom_hash_) throw std::runtime_error("Save state is from another game: " + path);
+    if (!load_state(file.data(), file.size())) throw std::runtime_error("Corrupt save state: " + path);
+}
+
+void Emulator::set_run_ahead(int frames, bool use_shadow) {
+    run_ahead_frames_ = std::max(frames, 0);
+    run_ahead_shadow_ = use_shadow;
+    if (!use_shadow) shadow_.reset();
+    run_ahead_stats_ = RunAheadStats();
+}
+
+RunStatus Emulator::run_frame_ahead() {
+    if (run_ahead_frames_ == 0 || !ppu_) return run_frame();
+    // The real frame is never shown, only its speculative successor
+    ppu_->set_render_enabled(false);
+    RunStatus status = run_frame();
+    ppu_->set_render_enabled(rendering_);
+    if (status.error || status.breakpoint_hit) return status;
+
+    auto start = std::chrono::steady_clock::now();
+    Emulator* target = this;
+    if (run_ahead_shadow_) {
+        if (!shadow_ || !shadow_->sync_from(*this)) shadow_ = clone();
+        target = shadow_.get();
+    } else {
+        if (run_ahead_state_.size() != state_size()) run_ahead_state_.assign(state_size(), 0);
+        if (!save_state(run_ahead_state_.data(), run_ahead_state_.size())) throw std::runtime_error("Run-ahead snapshot failed");
+    }
+    target->ppu_->set_render_enabled(false);
+    for (int i = 1; i < run_ahead_frames_; ++i) target->run_frame();
+    target->ppu_->set_render_enabled(rendering_);
+    target->run_frame();
+    if (!run_ahead_shadow_ && !load_state(run_ahead_state_.data(), run_ahead_state_.size())) throw std::runtime_error("Run-ahead restore failed");
+
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    run_ahead_stats_.frames++;
+    run_ahead_stats_.last_overhead_us = us;
+    run_ahead_stats_.average_overhead_us += (us - run_ahead_stats_.average_overhead_us) / static_cast<double>(run_ahead_stats_.frames);
+    return status;
+}
+
+bool Emulator::sync_from(const Emulator& source) noexcept {
+    if (!cpu_ || rom_ != source.rom_ || nsf_ != source.nsf_ || !ppu_ != !source.ppu_) return false;
+    cpu_->set_registers(source.cpu_->registers());
+    mem_->sync_from(*source.mem_);
+    if (ppu_) ppu_->sync_from(*source.ppu_);
+    apu_->set_state(source.apu_->state());
+    scheduler_ = source.scheduler_;
+    frame_start_dot_ = source.frame_start_dot_;
+    frame_count_ = source.frame_count_;
+    nsf_sample_carry_ = source.nsf_sample_carry_;
+    audio_samples_ = source.audio_samples_;
+    counted_ppu_dot_ = ppu_ ? ppu_->dot() : 0;
+    return true;
+}
+
+void Emulator::set_pacing(const PacingOptions& options) {
+    if (pacer_) pacer_->set_options(options);
+    else pacer_ = std::make_unique<FramePacer>(options);
+}
 
-void Emulator::step() {
+RunStatus Emulator::run_frame_paced() {
+    if (!pacer_) pacer_ = std::make_unique<FramePacer>();
+    const bool present = pacer_->begin_frame();
+    const bool was_rendering = rendering_;
+    if (!present) set_rendering(false);
+    // A skipped frame is never shown, so there is nothing to run ahead (or render in a shadow) for
+    RunStatus status = present ? run_frame_ahead() : run_frame();
+    if (!present) set_rendering(was_rendering);
+    status.frame_skipped = !present;
+    pacer_->end_frame();
+    return status;
+}
+
+void Emulator::generate_frame_audio(std::vector<int16_t>& samples) {
+    if (!apu_) throw std::runtime_error("No ROM loaded");
+    const uint64_t target = scheduler_.now() * audio_sample_rate / cpu_clock_hz;
+    const uint64_t count = target > audio_samples_ ? target - audio_samples_ : 0; // none after rewinding
+    audio_samples_ = target;
+    apu_->generate_audio(static_cast<int>(count), samples);
+    pending_metrics_.apu_samples += count;
+}
+
+void Emulator::set_audio_only(bool enabled) noexcept {
+    audio_only_ = enabled;
+    if (ppu_) ppu_->attach_scheduler(enabled ? nullptr : &scheduler_);
+}
+
+void Emulator::reset() {
+    stopped_at_breakpoint_ = false; // a breakpoint on the reset vector must fire
+    if (cpu_) cpu_->reset();
+    if (apu_) apu_->reset();
+}
+
+int Emulator::step() {
     if (!cpu_) throw std::runtime_error("No ROM loaded");
-    cpu_->step();
-    ppu_->step(); // Step PPU each CPU cycle (approx 3 PPU cycles per CPU)
-    if (ppu_->nmi_triggered()) cpu_->trigger_nmi();
-}
\ No newline at end of file
+    if (trace_) trace_instruction();
+    const uint64_t start = scheduler_.now();
+    int cycles = cpu_->execute_instruction();
+    pending_metrics_.instructions++;
+    scheduler_.advance_to(start + cycles);
+    if (scheduler_.now() >= scheduler_.next_time()) dispatch_events();
+    pending_metrics_.cpu_cycles += scheduler_.now() - start; // with any DMA stall the instruction set off
+    return cycles;
+}
+
+void Emulator::advance_clock(uint64_t cycles) {
+    const uint64_t start = scheduler_.now();
+    scheduler_.advance_to(start + cycles);
+    if (scheduler_.now() >= scheduler_.next_time()) dispatch_events();
+    pending_metrics_.cpu_cycles += scheduler_.now() - start;
+}
+
+RunStatus Emulator::run_frame() noexcept {
+    TraceScope scope("frame", TraceCategory::Emulator, "frame", frame_count_);
+    const auto start = std::chrono::steady_clock::now();
+    auto end = start;
+    RunStatus status = run_until(std::numeric_limits<uint64_t>::max(), true, end);
+    if (status.frame_completed) {
+        metrics_.record_frame_time(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+    }
+    return status;
+}
+
+RunStatus Emulator::run_cycles(uint64_t cycles) noexcept {
+    auto host_time = std::chrono::steady_clock::now();
+    return run_until(scheduler_.now() + cycles, false, host_time);
+}
+
+bool Emulator::add_breakpoint(uint16_t pc) noexcept {
+    if (breakpoint_count_ == breakpoints_.size()) return false;
+    breakpoints_[breakpoint_count_++] = pc;
+    return true;
+}
+
+// Hot loop: the CPU runs whole instructions up to the next event; everything else catches up in batches.
+// The host clock is read at the ends of the run and around one dispatch in event_time_sample; the
+// event share of the run's wall time is extrapolated from those, the rest is counted as CPU time.
+RunStatus Emulator::run_until(uint64_t cycle, bool stop_at_frame_end, std::chrono::steady_clock::time_point& host_time) noexcept {
+    using Clock = std::chrono::steady_clock;
+    constexpr uint64_t event_time_sample = 16;
+    auto ns_since = [](Clock::time_point from, Clock::time_point to) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    };
+    RunStatus status;
+    if (!cpu_) { status.error = true; return status; }
+    const uint64_t start = scheduler_.now();
+    const uint64_t start_frame = frame_count_;
+    Metrics::Delta delta;
+    uint64_t instructions = 0;
+    // Resuming from a breakpoint must not stop on it again; any other run checks its first instruction too
+    bool skip_check = stopped_at_breakpoint_ && cpu_->get_program_counter() == breakpoint_pc_;
+    stopped_at_breakpoint_ = false;
+    const Clock::time_point run_start = host_time;
+    uint64_t dispatches = 0, sampled = 0, sampled_ns = 0;
+    while (scheduler_.now() < cycle) {
+        uint64_t limit = std::min(cycle, scheduler_.next_time());
+        {
+            TraceScope cpu_scope("cpu", TraceCategory::Cpu, "until_cycle", limit);
+            if (breakpoint_count_ == 0 && !trace_) {
+                uint64_t now = scheduler_.now();
+                while (now < limit) {
+                    now += cpu_->execute_instruction();
+                    ++instructions;
+                    scheduler_.advance_to(now);
+                    limit = std::min(limit, scheduler_.next_time()); // the instruction may have scheduled an event ($4014)
+                }
+            } else if (run_checked(limit, skip_check, instructions)) {
+                status.breakpoint_hit = true;
+                stopped_at_breakpoint_ = true;
+                breakpoint_pc_ = cpu_->get_program_counter();
+                break;
+            }
+        }
+        if (dispatches++ % event_time_sample == 0) {
+            const Clock::time_point events_start = Clock::now();
+            { TraceScope events_scope("events", TraceCategory::Emulator); dispatch_events(); }
+            sampled_ns += ns_since(events_start, Clock::now());
+            ++sampled;
+        } else {
+            TraceScope events_scope("events", TraceCategory::Emulator);
+            dispatch_events();
+        }
+        if (stop_at_frame_end && frame_count_ != start_frame) break;
+    }
+    host_time = Clock::now();
+    const uint64_t run_ns = ns_since(run_start, host_time);
+    delta.event_ns = sampled ? std::min(run_ns, sampled_ns * dispatches / sampled) : 0;
+    delta.cpu_ns = run_ns - delta.event_ns;
+    status.cycles = scheduler_.now() - start;
+    status.frame_completed = frame_count_ != start_frame;
+    delta.cpu_cycles = status.cycles;
+    delta.instructions = instructions;
+    delta.frames = frame_count_ - start_frame;
+    publish_metrics(delta);
+    return status;
+}
+
+// Slow variant of the inner loop, only used while breakpoints are set or a trace is attached
+bool Emulator::run_checked(uint64_t limit, bool& skip_check, uint64_t& instructions) noexcept {
+    uint64_t now = scheduler_.now();
+    while (now < limit) {
+        uint16_t pc = cpu_->get_program_counter();
+        if (!skip_check) {
+            for (size_t i = 0; i < breakpoint_count_; ++i) if (breakpoints_[i] == pc) return true;
+        }
+        skip_check = false;
+        if (trace_) trace_instruction();
+        now += cpu_->execute_instruction();
+        ++instructions;
+        scheduler_.advance_to(now);
+        limit = std::min(limit, scheduler_.next_time());
+    }
+    return false;
+}
+
+// Folds in step()/advance_clock() work and the memory map's access counts, then publishes once
+void Emulator::publish_metrics(Metrics::Delta& delta) noexcept {
+    delta.cpu_cycles += pending_metrics_.cpu_cycles;
+    delta.instructions += pending_metrics_.instructions;
+    delta.apu_samples += pending_metrics_.apu_samples;
+    delta.dma_stall_cycles += pending_metrics_.dma_stall_cycles;
+    pending_metrics_ = Metrics::Delta{};
+    // Dots the PPU actually ran; it catches up lazily, so a run's lag is counted by the next publish
+    if (ppu_ && !audio_only_) {
+        const uint64_t dot = ppu_->dot();
+        delta.ppu_dots = dot - counted_ppu_dot_;
+        counted_ppu_dot_ = dot;
+    }
+    Memory::AccessCounts reads, writes;
+    mem_->take_access_counts(reads, writes);
+    for (size_t slot = 0; slot < reads.size(); ++slot) {
+        const size_t region = std::min(slot, static_cast<size_t>(MemoryRegion::Rom));
+        delta.memory_reads[region] += reads[slot];
+        delta.memory_writes[region] += writes[slot];
+    }
+    metrics_.publish(delta);
+}
+
+void Emulator::trace_instruction() noexcept {
+    const CPU6502::Registers& regs = cpu_->registers();
+    const uint16_t pc = regs.program_counter_;
+    // Code never runs from the register space, and reading it there would have side effects
+    auto peek = [this](uint16_t addr) -> uint8_t { return (addr < 0x2000 || addr >= 0x4020) ? mem_->read(addr) : 0; };
+    TraceRecord record{};
+    record.cycle = scheduler_.now();
+    record.pc = pc;
+    const uint64_t dot = record.cycle * 3 - frame_start_dot_;
+    record.scanline = static_cast<int16_t>(dot / 341) - 1;
+    record.dot = static_cast<uint16_t>(dot % 341);
+    record.opcode = peek(pc);
+    record.operand1 = peek(static_cast<uint16_t>(pc + 1));
+    record.operand2 = peek(static_cast<uint16_t>(pc + 2));
+    record.a = regs.accumulator_;
+    record.x = regs.index_x_;
+    record.y = regs.index_y_;
+    record.p = regs.status_flags_;
+    record.sp = regs.stack_pointer_;
+    trace_->push(record);
+}
+
+void Emulator::schedule_frame_events() {
+    scheduler_.schedule(EventType::VBlank, dot_to_cycle(frame_start_dot_ + vblank_dot));
+    scheduler_.schedule(EventType::FrameEnd, dot_to_cycle(frame_start_dot_ + dots_per_frame));
+    // Sync point so raster code polling $2002 sees the hit without per-dot polling here
+    if (ppu_ && !audio_only_ && ppu_->sprite_zero_line() < 240) {
+        scheduler_.schedule(EventType::SpriteZero, dot_to_cycle(frame_start_dot_ + (ppu_->sprite_zero_line() + 1) * 341));
+    }
+}
+
+void Emulator::dispatch_events() {
+    Event ev;
+    while (scheduler_.pop_due(ev)) {
+        switch (ev.type) {
+            case EventType::VBlank:
+                trace_instant("vblank", TraceCategory::Emulator, "frame", frame_count_);
+                if (!ppu_) break;
+                if (audio_only_) ppu_->set_vblank(true); else ppu_->catch_up();
+                if (ppu_->nmi_triggered()) { ppu_->acknowledge_nmi(); cpu_->trigger_nmi(); }
+                break;
+            case EventType::FrameEnd:
+                if (ppu_) { if (audio_only_) ppu_->set_vblank(false); else ppu_->catch_up(); }
+                frame_start_dot_ += dots_per_frame;
+                frame_count_++;
+                schedule_frame_events();
+                poll_input();
+                break;
+            case EventType::SpriteZero:
+                if (ppu_) ppu_->catch_up();
+                break;
+            case EventType::ApuFrame:
+                scheduler_.schedule(EventType::ApuFrame, ev.time + apu_->clock_frame_sequencer());
+                if (apu_->irq_pending()) scheduler_.schedule(EventType::Irq, scheduler_.now());
+                break;
+            case EventType::Irq:
+                // The CPU holds the line from here on and takes it once I is clear, so a masked IRQ
+                // costs no further scheduler stops
+                if (apu_->irq_pending()) cpu_->arm_irq();
+                break;
+            case EventType::DmaComplete: {
+                // Scheduled by the $4014 write; the CPU sits out 256 read/write pairs plus one alignment
+                // cycle, and one more when the transfer starts on an odd cycle. Events falling due inside
+                // the stall are dispatched by this same loop.
+                const uint64_t stall = 513 + (scheduler_.now() & 1);
+                scheduler_.advance_to(scheduler_.now() + stall);
+                pending_metrics_.dma_stall_cycles += stall;
+                break;
+            }
+            case EventType::Count:
+                break;
+        }
+    }
+}
+
+bool Emulator::nsf_call(uint16_t address, uint8_t a, uint8_t x) {
+    cpu_->call_subroutine(address, a, x);
+    // A routine gets at most one play period; tunes whose INIT never returns are cut off here
+    uint64_t deadline = scheduler_.now() + cpu_clock_hz * nsf_->play_period_us() / 1000000;
+    while (scheduler_.now() < deadline) {
+        if (cpu_->get_program_counter() == CPU6502::host_return_address) return true;
+        step();
+    }
+    return false;
+}
+
+void Emulator::nsf_init(int song) {
+    if (!nsf_) throw std::runtime_error("No NSF loaded");
+    if (song < 0 || song >= nsf_->get_header().total_songs) throw std::out_of_range("NSF song index out of range");
+    mem_->clear_work_ram();
+    mem_->map_nsf(nsf_.get());
+    apu_->reset();
+    for (uint16_t addr = 0x4000; addr <= 0x4013; ++addr) mem_->write(addr, 0x00);
+    mem_->write(0x4015, 0x0F);
+    mem_->write(0x4017, 0x40);
+    cpu_->reset();
+    nsf_sample_carry_ = 0;
+    nsf_call(nsf_->get_header().init_address, static_cast<uint8_t>(song), nsf_->is_pal() ? 1 : 0);
+}
+
+void Emulator::nsf_play_frame(std::vector<int16_t>& samples) {
+    if (!nsf_) throw std::runtime_error("No NSF loaded");
+    uint64_t period_end = scheduler_.now() + cpu_clock_hz * nsf_->play_period_us() / 1000000;
+    nsf_call(nsf_->get_header().play_address, 0, 0);
+    const uint64_t idle_start = scheduler_.now();
+    const uint64_t start_frame = frame_count_;
+    // The CPU idles after PLAY returns; only sequencer events fire for the rest of the period
+    while (scheduler_.next_time() <= period_end) {
+        scheduler_.advance_to(std::max(scheduler_.now(), scheduler_.next_time()));
+        dispatch_events();
+    }
+    scheduler_.advance_to(std::max(scheduler_.now(), period_end));
+    uint64_t total = nsf_sample_carry_ + static_cast<uint64_t>(audio_sample_rate) * nsf_->play_period_us();
+    nsf_sample_carry_ = total % 1000000;
+    apu_->generate_audio(static_cast<int>(total / 1000000), samples);
+    Metrics::Delta delta;
+    delta.cpu_cycles = scheduler_.now() - idle_start; // PLAY itself went through step()
+    delta.frames = frame_count_ - start_frame;
+    delta.apu_samples = total / 1000000;
+    publish_metrics(delta);
+}
@@ -0,0 +1,126 @@
+#include "nes/frame_pacer.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+using namespace nes;
+
+namespace {
+constexpr auto min_spin = std::chrono::microseconds(20);
+
+uint64_t to_ns(FramePacer::Clock::duration d) {
+    return static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+}
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+}
+
+FramePacer::FramePacer(const PacingOptions& options) {
+    set_options(options);
+}
+
+void FramePacer::set_options(const PacingOptions& options) {
+    if (!(options.refresh_hz > 0)) throw std::invalid_argument("Refresh rate must be positive");
+    if (options.turbo_render_interval < 1 || options.turbo_audio_stride < 1) throw std::invalid_argument("Turbo intervals must be at least 1");
+    options_ = options;
+    period_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options_.refresh_hz));
+    spin_ = std::chrono::microseconds(options_.max_spin_us);
+    restart();
+}
+
+void FramePacer::restart() noexcept {
+    started_ = false;
+    skipped_in_row_ = 0;
+}
+
+FramePacer::Clock::time_point FramePacer::deadline() const noexcept {
+    // Multiply rather than accumulate, so rounding in period_ never drifts
+    return origin_ + period_ * static_cast<int64_t>(frame_index_ + 1);
+}
+
+bool FramePacer::begin_frame() noexcept {
+    const auto now = Clock::now();
+    if (!started_) {
+        origin_ = now;
+        last_end_ = now;
+        frame_index_ = 0;
+        started_ = true;
+    }
+    switch (options_.mode) {
+        case PacingMode::Free:
+            presenting_ = true;
+            break;
+        case PacingMode::Turbo:
+            presenting_ = stats_.frames % static_cast<uint64_t>(options_.turbo_render_interval) == 0;
+            break;
+        case PacingMode::RealTime:
+            // A whole period behind: emulate without rendering until caught up, a few frames at most
+            presenting_ = !(now > deadline() && skipped_in_row_ < options_.max_skipped_frames);
+            break;
+    }
+    skipped_in_row_ = presenting_ ? 0 : skipped_in_row_ + 1;
+    return presenting_;
+}
+
+void FramePacer::end_frame() noexcept {
+    stats_.frames++;
+    if (presenting_) stats_.presented++; else stats_.skipped++;
+
+    if (options_.mode == PacingMode::RealTime) {
+        const auto due = deadline();
+        auto now = Clock::now();
+        if (now < due) {
+            wait_until(due);
+            now = Clock::now();
+        }
+        lateness_.record(to_ns(now - due));
+        frame_index_++;
+        // Hopelessly behind (a debugger pause, a stalled disk): drop the backlog instead of racing through it
+        if (now - due > period_ * (options_.max_skipped_frames + 1)) {
+            origin_ = now;
+            frame_index_ = 0;
+            stats_.resyncs++;
+        }
+    }
+    const auto end = Clock::now();
+    intervals_.record(to_ns(end - last_end_));
+    last_end_ = end;
+}
+
+void FramePacer::wait_until(Clock::time_point due) noexcept {
+    const auto wake = due - spin_;
+    if (Clock::now() < wake) {
+        std::this_thread::sleep_until(wake);
+        // Size the spin window from how late sleeps actually wake, decaying toward recent behaviour
+        const auto overshoot = std::max(Clock::now() - wake, Clock::duration::zero());
+        oversleep_ = std::max(overshoot, oversleep_ - oversleep_ / 8);
+        const auto limit = std::chrono::duration_cast<Clock::duration>(std::chrono::microseconds(options_.max_spin_us));
+        spin_ = std::min(std::max(oversleep_ * 2, std::chrono::duration_cast<Clock::duration>(min_spin)), limit);
+    }
+    while (Clock::now() < due) cpu_relax();
+}
+
+void FramePacer::decimate_audio(std::vector<int16_t>& samples) const {
+    const size_t stride = static_cast<size_t>(options_.turbo_audio_stride);
+    if (options_.mode != PacingMode::Turbo || stride == 1) return;
+    size_t out = 0;
+    for (size_t i = 0; i < samples.size(); i += stride) {
+        const size_t end = std::min(samples.size(), i + stride);
+        int32_t sum = 0;
+        for (size_t j = i; j < end; ++j) sum += samples[j];
+        samples[out++] = static_cast<int16_t>(sum / static_cast<int32_t>(end - i));
+    }
+    samples.resize(out);
+}
+
+PacingStats FramePacer::stats() const noexcept {
+    PacingStats s = stats_;
+    s.spin_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(spin_).count());
+    return s;
+}
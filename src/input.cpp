@@ -0,0 +1,94 @@
+#include "nes/input.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+using namespace nes;
+
+static constexpr char movie_magic[4] = { 'N', 'M', 'O', 'V' };
+static constexpr uint16_t movie_version = 1;
+
+void AtomicInputProvider::set(int port, uint8_t buttons) noexcept {
+    const int shift = (port & 1) * 8;
+    uint16_t current = pads_.load(std::memory_order_relaxed);
+    uint16_t next;
+    do {
+        next = static_cast<uint16_t>((current & ~(0xFF << shift)) | (buttons << shift));
+    } while (!pads_.compare_exchange_weak(current, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void AtomicInputProvider::poll(uint64_t, std::array<uint8_t, 2>& pads) {
+    uint16_t packed = pads_.load(std::memory_order_acquire);
+    pads[0] = static_cast<uint8_t>(packed & 0xFF);
+    pads[1] = static_cast<uint8_t>(packed >> 8);
+}
+
+uint8_t Movie::buttons(uint64_t frame, int port) const noexcept {
+    if (port < 0 || port >= ports || frame >= frame_count()) return 0;
+    return frames[static_cast<size_t>(frame) * ports + static_cast<size_t>(port)];
+}
+
+void Movie::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Failed to create movie: " + path);
+    uint32_t count = static_cast<uint32_t>(frame_count());
+    const uint8_t header[12] = {
+        'N', 'M', 'O', 'V',
+        static_cast<uint8_t>(movie_version & 0xFF), static_cast<uint8_t>(movie_version >> 8), ports, 0,
+        static_cast<uint8_t>(count), static_cast<uint8_t>(count >> 8), static_cast<uint8_t>(count >> 16), static_cast<uint8_t>(count >> 24)
+    };
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(frames.data()), static_cast<std::streamsize>(static_cast<size_t>(count) * ports));
+    if (!out) throw std::runtime_error("Failed to write movie: " + path);
+}
+
+Movie Movie::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open movie: " + path);
+    uint8_t header[12];
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) || !std::equal(movie_magic, movie_magic + 4, header)) {
+        throw std::runtime_error("Invalid movie format: " + path);
+    }
+    uint16_t version = static_cast<uint16_t>(header[4] | (header[5] << 8));
+    if (version != movie_version) throw std::runtime_error("Unsupported movie version: " + path);
+    Movie movie;
+    movie.ports = header[6];
+    if (movie.ports < 1 || movie.ports > 2) throw std::runtime_error("Invalid movie port count: " + path);
+    uint32_t count = static_cast<uint32_t>(header[8] | (header[9] << 8) | (header[10] << 16) | (static_cast<uint32_t>(header[11]) << 24));
+    // The count comes from the file: check it against what is there before allocating for it
+    const std::streampos body = in.tellg();
+    in.seekg(0, std::ios::end);
+    const uint64_t available = static_cast<uint64_t>(in.tellg() - body);
+    in.seekg(body);
+    if (count > available / movie.ports) throw std::runtime_error("Truncated movie: " + path);
+    movie.frames.resize(static_cast<size_t>(count) * movie.ports);
+    if (!in.read(reinterpret_cast<char*>(movie.frames.data()), static_cast<std::streamsize>(movie.frames.size()))) {
+        throw std::runtime_error("Truncated movie: " + path);
+    }
+    return movie;
+}
+
+void MoviePlayer::poll(uint64_t frame, std::array<uint8_t, 2>& pads) {
+    pads[0] = movie_.buttons(frame, 0);
+    pads[1] = movie_.buttons(frame, 1);
+}
+
+MovieRecorder::MovieRecorder(InputProvider& source, uint8_t ports, size_t reserve_frames) : source_(source) {
+    if (ports < 1 || ports > 2) throw std::invalid_argument("Movie port count must be 1 or 2");
+    movie_.ports = ports;
+    movie_.frames.reserve(reserve_frames * ports);
+}
+
+void MovieRecorder::poll(uint64_t frame, std::array<uint8_t, 2>& pads) {
+    source_.poll(frame, pads);
+    if (truncated_) return;
+    // Keyed by frame, so frames re-run after a state load or run-ahead rollback overwrite their entry
+    const size_t offset = static_cast<size_t>(frame) * movie_.ports;
+    const size_t needed = offset + movie_.ports;
+    if (needed > movie_.frames.capacity()) {
+        try { movie_.frames.reserve(std::max(needed, movie_.frames.capacity() * 2)); }
+        catch (...) { truncated_ = true; return; } // poll() runs in the noexcept run loop
+    }
+    movie_.frames.resize(needed); // within capacity: no allocation
+    for (int port = 0; port < movie_.ports; ++port) movie_.frames[offset + port] = pads[port];
+}
@@ -0,0 +1,54 @@
+#include "nes/instance_pool.h"
+#include <stdexcept>
+
+using namespace nes;
+
+InstancePool::InstancePool(std::shared_ptr<const ROM> rom, bool rendering) : rom_(std::move(rom)), rendering_(rendering) {
+    if (!rom_) throw std::invalid_argument("Instance pool needs a ROM");
+}
+
+InstancePool::InstancePool(const std::vector<uint8_t>& rom_bytes, bool rendering)
+    : InstancePool(std::make_shared<const ROM>(rom_bytes), rendering) {}
+
+InstancePool::Handle InstancePool::acquire() {
+    std::unique_ptr<Emulator> emu;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (!idle_.empty()) { emu = std::move(idle_.back()); idle_.pop_back(); }
+    }
+    if (!emu) emu = std::make_unique<Emulator>();
+    emu->set_rendering(rendering_);
+    emu->set_input_provider(nullptr); // the previous holder's provider may be gone
+    emu->load_rom(rom_); // in place when the instance has been loaded before
+    emu->reset();
+    return Handle(emu.release(), Returner{ this });
+}
+
+void InstancePool::reserve(size_t count) {
+    std::vector<std::unique_ptr<Emulator>> fresh;
+    for (size_t i = 0; i < count; ++i) {
+        auto emu = std::make_unique<Emulator>();
+        emu->set_rendering(rendering_);
+        emu->load_rom(rom_);
+        fresh.push_back(std::move(emu));
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    for (auto& emu : fresh) idle_.push_back(std::move(emu));
+}
+
+size_t InstancePool::idle() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    return idle_.size();
+}
+
+void InstancePool::release(Emulator* emu) noexcept {
+    std::unique_ptr<Emulator> owned(emu);
+    try {
+        std::lock_guard<std::mutex> guard(lock_);
+        idle_.push_back(std::move(owned));
+    } catch (...) {} // could not grow the idle list; the instance is simply freed
+}
+
+void InstancePool::Returner::operator()(Emulator* emu) const noexcept {
+    if (emu) pool->release(emu);
+}
@@ -0,0 +1,149 @@
+#include "nes/libnes.h"
+#include "nes/emulator.h"
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct nes_instance {
+    nes::Emulator emu;
+    std::vector<int16_t> audio; // samples from the last nes_run_frames(), exposed by pointer
+    std::vector<int16_t> frame_audio; // one frame's samples, appended to `audio`
+    std::string error;
+};
+
+namespace {
+int fail(nes_instance* nes, int status, const char* message) {
+    nes->error = message;
+    return status;
+}
+
+// Exceptions must not cross the C boundary
+template <typename F>
+int guarded(nes_instance* nes, int error_status, F&& body) noexcept {
+    if (!nes) return NES_ERROR_ARGUMENT;
+    try {
+        nes->error.clear();
+        return body();
+    } catch (const std::bad_alloc&) {
+        return fail(nes, NES_ERROR_INTERNAL, "Out of memory");
+    } catch (const std::exception& e) {
+        nes->error = e.what();
+        return error_status;
+    } catch (...) {
+        return fail(nes, NES_ERROR_INTERNAL, "Unknown error");
+    }
+}
+
+int run_frames(nes_instance* nes, uint32_t frames, const uint8_t* inputs) {
+    nes::Emulator& emu = nes->emu;
+    nes->audio.clear(); // keeps its capacity
+    for (uint32_t i = 0; i < frames; ++i) {
+        if (inputs) {
+            emu.set_buttons(0, inputs[2 * i]);
+            emu.set_buttons(1, inputs[2 * i + 1]);
+        }
+        if (emu.run_frame().error) return fail(nes, NES_ERROR_NOT_LOADED, "No ROM loaded");
+        // The APU runs frame by frame with the CPU, so register writes land in the right frame's audio
+        emu.generate_frame_audio(nes->frame_audio);
+        nes->audio.insert(nes->audio.end(), nes->frame_audio.begin(), nes->frame_audio.end());
+    }
+    return NES_OK;
+}
+}
+
+uint32_t nes_abi_version(void) {
+    return NES_ABI_VERSION;
+}
+
+nes_instance* nes_create(void) {
+    try {
+        return new nes_instance();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void nes_destroy(nes_instance* nes) {
+    delete nes;
+}
+
+const char* nes_last_error(const nes_instance* nes) {
+    return nes ? nes->error.c_str() : "No instance";
+}
+
+int nes_load_rom(nes_instance* nes, const uint8_t* data, size_t size) {
+    return guarded(nes, NES_ERROR_ROM, [&]() -> int {
+        if (!data) return fail(nes, NES_ERROR_ARGUMENT, "No ROM data");
+        nes->emu.load_rom_bytes(std::vector<uint8_t>(data, data + size));
+        nes->audio.clear();
+        return NES_OK;
+    });
+}
+
+int nes_reset(nes_instance* nes) {
+    return guarded(nes, NES_ERROR_INTERNAL, [&]() -> int {
+        if (!nes->emu.loaded()) return fail(nes, NES_ERROR_NOT_LOADED, "No ROM loaded");
+        nes->emu.reset();
+        return NES_OK;
+    });
+}
+
+int nes_set_rendering(nes_instance* nes, int enabled) {
+    return guarded(nes, NES_ERROR_INTERNAL, [&]() -> int {
+        nes->emu.set_rendering(enabled != 0);
+        return NES_OK;
+    });
+}
+
+int nes_run_frames(nes_instance* nes, uint32_t frames, const uint8_t* inputs) {
+    return guarded(nes, NES_ERROR_INTERNAL, [&]() -> int { return run_frames(nes, frames, inputs); });
+}
+
+uint64_t nes_frame_count(const nes_instance* nes) {
+    return nes ? nes->emu.frame_count() : 0;
+}
+
+const uint8_t* nes_get_frame_ptr(nes_instance* nes) {
+    if (!nes) return nullptr;
+    try {
+        return nes->emu.loaded() ? nes->emu.ppu().frame_data() : nullptr; // nes_load_rom only takes iNES, so there is a PPU
+    } catch (...) {
+        nes->error = "Out of memory";
+        return nullptr;
+    }
+}
+
+const int16_t* nes_get_audio_ptr(const nes_instance* nes, size_t* samples) {
+    if (samples) *samples = nes ? nes->audio.size() : 0;
+    return nes ? nes->audio.data() : nullptr;
+}
+
+size_t nes_state_size(const nes_instance* nes) {
+    return nes ? nes->emu.state_size() : 0;
+}
+
+size_t nes_save_state(const nes_instance* nes, uint8_t* buffer, size_t size) {
+    return (nes && buffer) ? nes->emu.save_state(buffer, size) : 0;
+}
+
+int nes_load_state(nes_instance* nes, const uint8_t* data, size_t size) {
+    return guarded(nes, NES_ERROR_STATE, [&]() -> int {
+        if (!data) return fail(nes, NES_ERROR_ARGUMENT, "No state data");
+        if (!nes->emu.load_state(data, size)) return fail(nes, NES_ERROR_STATE, "Save state does not match this version or game");
+        return NES_OK;
+    });
+}
+
+int nes_step_many(nes_instance* const* instances, size_t count, uint32_t frames, const uint8_t* inputs, int* statuses) {
+    if (!instances && count) return NES_ERROR_ARGUMENT;
+    int first_failure = NES_OK;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* own_inputs = inputs ? inputs + i * frames * 2 : nullptr;
+        const int status = guarded(instances[i], NES_ERROR_INTERNAL, [&]() -> int { return run_frames(instances[i], frames, own_inputs); });
+        if (statuses) statuses[i] = status;
+        if (status != NES_OK && first_failure == NES_OK) first_failure = status;
+    }
+    return first_failure;
+}
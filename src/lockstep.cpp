@@ -0,0 +1,432 @@
+#include "nes/lockstep.h"
+#include <algorithm>
+#include <bitset>
+#include <limits>
+#include <stdexcept>
+
+using namespace nes;
+
+namespace {
+enum class Op : uint8_t {
+    None, Lda, Ldx, Ldy, Sta, Stx, Sty, Tax, Tay, Txa, Tya, Tsx, Txs, Inx, Iny, Dex, Dey, Inc, Dec,
+    And, Ora, Eor, Adc, Sbc, Cmp, Cpx, Cpy, Bit, Asl, Lsr, Rol, Ror, Branch,
+    Clc, Sec, Cli, Sei, Cld, Sed, Clv, Nop, Jmp, JmpIndirect, Jsr, Rts, Pha, Php, Pla, Plp
+};
+enum class Mode : uint8_t { Implied, Accumulator, Immediate, ZeroPage, ZeroPageX, ZeroPageY, Absolute, AbsoluteX, AbsoluteY, IndirectX, IndirectY, Relative };
+
+struct Decoded {
+    Op op;
+    Mode mode;
+    uint8_t cycles;
+    bool page_penalty; // +1 when indexing crosses a page, as the scalar core charges read instructions
+};
+
+enum StatusBits : uint8_t { Carry = 1 << 0, Zero = 1 << 1, InterruptDisable = 1 << 2, Decimal = 1 << 3, Break = 1 << 4, Unused = 1 << 5, Overflow = 1 << 6, Negative = 1 << 7 };
+
+// Official opcodes minus BRK/RTI; everything else peels to the scalar core
+std::array<Decoded, 256> build_decode_table() {
+    std::array<Decoded, 256> table;
+    table.fill({ Op::None, Mode::Implied, 0, false });
+    auto set = [&](uint8_t opcode, Op op, Mode mode, uint8_t cycles, bool penalty = false) { table[opcode] = { op, mode, cycles, penalty }; };
+
+    // ORA AND EOR ADC STA LDA CMP SBC share one opcode layout
+    const Op group_one[8] = { Op::Ora, Op::And, Op::Eor, Op::Adc, Op::Sta, Op::Lda, Op::Cmp, Op::Sbc };
+    for (int g = 0; g < 8; ++g) {
+        uint8_t base = static_cast<uint8_t>(g << 5);
+        Op op = group_one[g];
+        bool store = op == Op::Sta;
+        if (!store) set(base | 0x09, op, Mode::Immediate, 2);
+        set(base | 0x05, op, Mode::ZeroPage, 3);
+        set(base | 0x15, op, Mode::ZeroPageX, 4);
+        set(base | 0x0D, op, Mode::Absolute, 4);
+        set(base | 0x1D, op, Mode::AbsoluteX, store ? 5 : 4, !store);
+        set(base | 0x19, op, Mode::AbsoluteY, store ? 5 : 4, !store);
+        set(base | 0x01, op, Mode::IndirectX, 6);
+        set(base | 0x11, op, Mode::IndirectY, store ? 6 : 5, !store);
+    }
+    // Read-modify-write: ASL ROL LSR ROR, then DEC INC (whose accumulator slots are DEX/NOP)
+    const Op group_two[8] = { Op::Asl, Op::Rol, Op::Lsr, Op::Ror, Op::None, Op::None, Op::Dec, Op::Inc };
+    for (int g = 0; g < 8; ++g) {
+        if (group_two[g] == Op::None) continue;
+        uint8_t base = static_cast<uint8_t>(g << 5);
+        if (g < 4) set(base | 0x0A, group_two[g], Mode::Accumulator, 2);
+        set(base | 0x06, group_two[g], Mode::ZeroPage, 5);
+        set(base | 0x16, group_two[g], Mode::ZeroPageX, 6);
+        set(base | 0x0E, group_two[g], Mode::Absolute, 6);
+        set(base | 0x1E, group_two[g], Mode::AbsoluteX, 7);
+    }
+    // BPL BMI BVC BVS BCC BCS BNE BEQ
+    for (int n = 0; n < 8; ++n) set(static_cast<uint8_t>(0x10 | (n << 5)), Op::Branch, Mode::Relative, 2);
+
+    set(0xA2, Op::Ldx, Mode::Immediate, 2); set(0xA6, Op::Ldx, Mode::ZeroPage, 3); set(0xB6, Op::Ldx, Mode::ZeroPageY, 4);
+    set(0xAE, Op::Ldx, Mode::Absolute, 4); set(0xBE, Op::Ldx, Mode::AbsoluteY, 4, true);
+    set(0xA0, Op::Ldy, Mode::Immediate, 2); set(0xA4, Op::Ldy, Mode::ZeroPage, 3); set(0xB4, Op::Ldy, Mode::ZeroPageX, 4);
+    set(0xAC, Op::Ldy, Mode::Absolute, 4); set(0xBC, Op::Ldy, Mode::AbsoluteX, 4, true);
+    set(0x86, Op::Stx, Mode::ZeroPage, 3); set(0x96, Op::Stx, Mode::ZeroPageY, 4); set(0x8E, Op::Stx, Mode::Absolute, 4);
+    set(0x84, Op::Sty, Mode::ZeroPage, 3); set(0x94, Op::Sty, Mode::ZeroPageX, 4); set(0x8C, Op::Sty, Mode::Absolute, 4);
+    set(0xE0, Op::Cpx, Mode::Immediate, 2); set(0xE4, Op::Cpx, Mode::ZeroPage, 3); set(0xEC, Op::Cpx, Mode::Absolute, 4);
+    set(0xC0, Op::Cpy, Mode::Immediate, 2); set(0xC4, Op::Cpy, Mode::ZeroPage, 3); set(0xCC, Op::Cpy, Mode::Absolute, 4);
+    set(0x24, Op::Bit, Mode::ZeroPage, 3); set(0x2C, Op::Bit, Mode::Absolute, 4);
+
+    set(0xAA, Op::Tax, Mode::Implied, 2); set(0xA8, Op::Tay, Mode::Implied, 2); set(0x8A, Op::Txa, Mode::Implied, 2);
+    set(0x98, Op::Tya, Mode::Implied, 2); set(0xBA, Op::Tsx, Mode::Implied, 2); set(0x9A, Op::Txs, Mode::Implied, 2);
+    set(0xE8, Op::Inx, Mode::Implied, 2); set(0xC8, Op::Iny, Mode::Implied, 2); set(0xCA, Op::Dex, Mode::Implied, 2);
+    set(0x88, Op::Dey, Mode::Implied, 2); set(0xEA, Op::Nop, Mode::Implied, 2);
+    set(0x18, Op::Clc, Mode::Implied, 2); set(0x38, Op::Sec, Mode::Implied, 2); set(0x58, Op::Cli, Mode::Implied, 2);
+    set(0x78, Op::Sei, Mode::Implied, 2); set(0xD8, Op::Cld, Mode::Implied, 2); set(0xF8, Op::Sed, Mode::Implied, 2);
+    set(0xB8, Op::Clv, Mode::Implied, 2);
+    set(0x4C, Op::Jmp, Mode::Absolute, 3); set(0x6C, Op::JmpIndirect, Mode::Absolute, 5); set(0x20, Op::Jsr, Mode::Absolute, 6);
+    set(0x60, Op::Rts, Mode::Implied, 6);
+    set(0x48, Op::Pha, Mode::Implied, 3); set(0x08, Op::Php, Mode::Implied, 3);
+    set(0x68, Op::Pla, Mode::Implied, 4); set(0x28, Op::Plp, Mode::Implied, 4);
+    return table;
+}
+
+const std::array<Decoded, 256> decode_table = build_decode_table();
+
+int instruction_length(Mode mode) {
+    switch (mode) {
+        case Mode::Implied: case Mode::Accumulator: return 1;
+        case Mode::Absolute: case Mode::AbsoluteX: case Mode::AbsoluteY: return 3;
+        default: return 2;
+    }
+}
+
+bool writes_memory(Op op) {
+    switch (op) {
+        case Op::Sta: case Op::Stx: case Op::Sty: case Op::Inc: case Op::Dec: case Op::Asl: case Op::Lsr: case Op::Rol: case Op::Ror: return true;
+        default: return false;
+    }
+}
+
+size_t lane_count(uint32_t mask) { return std::bitset<32>(mask).count(); }
+size_t first_lane(uint32_t mask) { size_t i = 0; while (!(mask >> i & 1)) ++i; return i; }
+}
+
+LockstepGroup::LockstepGroup(const std::vector<Emulator*>& lanes, uint32_t scalar_run)
+    : lanes_(lanes), soa_(new Lanes()), scalar_run_(std::max<uint32_t>(scalar_run, 1)), scalar_left_{}, stats_() {
+    if (lanes_.empty() || lanes_.size() > max_lanes) throw std::invalid_argument("Lockstep group needs 1 to 16 lanes");
+    for (Emulator* lane : lanes_) {
+        if (!lane || lane->state_size() == 0) throw std::invalid_argument("Lockstep lane has no ROM loaded");
+    }
+}
+
+void LockstepGroup::run_frame() {
+    std::array<uint64_t, max_lanes> target{};
+    uint32_t pending = 0;
+    for (size_t i = 0; i < lanes_.size(); ++i) { target[i] = lanes_[i]->frame_count() + 1; pending |= 1u << i; }
+
+    while (pending) {
+        uint32_t ready = 0;
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (!(pending >> i & 1)) continue;
+            Emulator& emu = *lanes_[i];
+            while (scalar_left_[i] > 0 && emu.frame_count() < target[i]) { emu.step(); scalar_left_[i]--; }
+            if (emu.frame_count() >= target[i]) pending &= ~(1u << i);
+            else ready |= 1u << i;
+        }
+        uint32_t group = gather(ready);
+        if (group) run_group(group);
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (lanes_[i]->frame_count() >= target[i]) pending &= ~(1u << i);
+        }
+    }
+}
+
+uint32_t LockstepGroup::gather(uint32_t candidates) {
+    Lanes& s = *soa_;
+    uint32_t group = 0;
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+        if (!(candidates >> i & 1)) continue;
+        Emulator& emu = *lanes_[i];
+        const CPU6502::Registers& r = emu.cpu().registers();
+        const Scheduler& sched = emu.scheduler();
+        // Interrupt entry cycles are still owed, an event is already due, or an IRQ is held while masked
+        // (a CLI or PLP must take it before the next instruction): let the scalar core handle it
+        if (r.cycle_count_ != 0 || r.irq_armed_ || sched.next_time() <= sched.now()) { scalar_left_[i] = 1; continue; }
+        s.a[i] = r.accumulator_;
+        s.x[i] = r.index_x_;
+        s.y[i] = r.index_y_;
+        s.sp[i] = r.stack_pointer_;
+        s.p[i] = r.status_flags_;
+        s.pc[i] = r.program_counter_;
+        s.cycles[i] = 0;
+        s.budget[i] = static_cast<uint32_t>(std::min<uint64_t>(sched.next_time() - sched.now(), std::numeric_limits<uint32_t>::max()));
+        const Memory::InternalRam& ram = emu.memory().internal_ram();
+        for (size_t page = 0; page < Memory::InternalRam::page_count; ++page) {
+            const uint8_t* src = ram.page(page);
+            for (size_t k = 0; k < cow_page_size; ++k) s.ram[page * cow_page_size + k][i] = src[k];
+        }
+        group |= 1u << i;
+    }
+    if (group) stats_.gathers++;
+    return group;
+}
+
+void LockstepGroup::scatter(size_t lane) {
+    Lanes& s = *soa_;
+    Emulator& emu = *lanes_[lane];
+    CPU6502::Registers r = emu.cpu().registers();
+    r.accumulator_ = s.a[lane];
+    r.index_x_ = s.x[lane];
+    r.index_y_ = s.y[lane];
+    r.stack_pointer_ = s.sp[lane];
+    r.status_flags_ = s.p[lane];
+    r.program_counter_ = s.pc[lane];
+    emu.cpu().set_registers(r);
+    std::array<uint8_t, 0x800> ram;
+    for (size_t addr = 0; addr < ram.size(); ++addr) ram[addr] = s.ram[addr][lane];
+    emu.memory().internal_ram().copy_from(ram.data());
+    emu.advance_clock(s.cycles[lane]);
+}
+
+void LockstepGroup::run_group(uint32_t group) {
+    Lanes& s = *soa_;
+    const Memory& prg = lanes_[0]->memory();
+    while (group) {
+        // Issue for the lane furthest behind; every lane parked on its PC comes along
+        size_t leader = 0;
+        uint32_t fewest = std::numeric_limits<uint32_t>::max();
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if ((group >> i & 1) && s.cycles[i] < fewest) { fewest = s.cycles[i]; leader = i; }
+        }
+        const uint16_t pc = s.pc[leader];
+        uint32_t mask = 0;
+        for (size_t i = 0; i < lanes_.size(); ++i) if ((group >> i & 1) && s.pc[i] == pc) mask |= 1u << i;
+
+        uint32_t leaving = mask; // code outside PRG-ROM differs per lane or has side effects
+        if (pc >= 0x8000) {
+            uint8_t opcode = prg.read(pc);
+            if (decode_table[opcode].op != Op::None) leaving = execute(opcode, mask);
+        }
+        uint32_t ran = mask & ~leaving;
+        if (ran) { stats_.issued++; stats_.lane_instructions += lane_count(ran); }
+        stats_.peels += lane_count(leaving);
+
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            uint32_t bit = 1u << i;
+            if (leaving & bit) { scalar_left_[i] = scalar_run_; scatter(i); group &= ~bit; }
+            else if ((ran & bit) && s.cycles[i] >= s.budget[i]) { scatter(i); group &= ~bit; } // event due
+        }
+    }
+}
+
+uint32_t LockstepGroup::execute(uint8_t opcode, uint32_t mask) {
+    Lanes& s = *soa_;
+    const Memory& prg = lanes_[0]->memory();
+    const Decoded& d = decode_table[opcode];
+    const size_t n = lanes_.size();
+    const uint16_t pc = s.pc[first_lane(mask)];
+    const int length = instruction_length(d.mode);
+    const uint8_t op1 = length > 1 ? prg.read(static_cast<uint16_t>(pc + 1)) : 0;
+    const uint8_t op2 = length > 2 ? prg.read(static_cast<uint16_t>(pc + 2)) : 0;
+    const uint16_t operand = static_cast<uint16_t>(op1 | (op2 << 8));
+
+    // Effective addresses; computed for every lane, only the masked ones are used
+    alignas(64) std::array<uint16_t, max_lanes> ea{};
+    alignas(64) std::array<uint8_t, max_lanes> crossed{};
+    switch (d.mode) {
+        case Mode::ZeroPage: ea.fill(op1); break;
+        case Mode::ZeroPageX: for (size_t i = 0; i < max_lanes; ++i) ea[i] = static_cast<uint8_t>(op1 + s.x[i]); break;
+        case Mode::ZeroPageY: for (size_t i = 0; i < max_lanes; ++i) ea[i] = static_cast<uint8_t>(op1 + s.y[i]); break;
+        case Mode::Absolute: ea.fill(operand); break;
+        case Mode::AbsoluteX:
+        case Mode::AbsoluteY: {
+            const std::array<uint8_t, max_lanes>& index = d.mode == Mode::AbsoluteX ? s.x : s.y;
+            for (size_t i = 0; i < max_lanes; ++i) {
+                ea[i] = static_cast<uint16_t>(operand + index[i]);
+                crossed[i] = (ea[i] & 0xFF00) != (operand & 0xFF00);
+            }
+            break;
+        }
+        case Mode::IndirectX:
+            for (size_t i = 0; i < max_lanes; ++i) {
+                uint8_t ptr = static_cast<uint8_t>(op1 + s.x[i]);
+                ea[i] = static_cast<uint16_t>(s.ram[ptr][i] | (s.ram[static_cast<uint8_t>(ptr + 1)][i] << 8));
+            }
+            break;
+        case Mode::IndirectY:
+            for (size_t i = 0; i < max_lanes; ++i) {
+                uint16_t base = static_cast<uint16_t>(s.ram[op1][i] | (s.ram[static_cast<uint8_t>(op1 + 1)][i] << 8));
+                ea[i] = static_cast<uint16_t>(base + s.y[i]);
+                crossed[i] = (ea[i] & 0xFF00) != (base & 0xFF00);
+            }
+            break;
+        default: break;
+    }
+
+    // Lanes whose access leaves RAM/PRG-ROM (or writes outside RAM) peel before anything changes
+    const bool accesses = d.mode != Mode::Implied && d.mode != Mode::Accumulator && d.mode != Mode::Immediate
+        && d.mode != Mode::Relative && d.op != Op::Jmp && d.op != Op::Jsr;
+    const bool writes = writes_memory(d.op) && d.mode != Mode::Accumulator;
+    uint32_t peel = 0;
+    if (accesses) {
+        for (size_t i = 0; i < n; ++i) {
+            uint16_t addr = d.op == Op::JmpIndirect ? operand : ea[i];
+            bool ok = writes ? addr < 0x2000 : (addr < 0x2000 || addr >= 0x8000);
+            if ((mask >> i & 1) && !ok) peel |= 1u << i;
+        }
+        mask &= ~peel;
+        if (!mask) return peel;
+    }
+
+    auto read = [&](size_t lane, uint16_t addr) -> uint8_t { return addr < 0x2000 ? s.ram[addr & 0x07FF][lane] : prg.read(addr); };
+    auto write = [&](size_t lane, uint16_t addr, uint8_t value) { s.ram[addr & 0x07FF][lane] = value; };
+    auto push = [&](size_t lane, uint8_t value) { s.ram[0x0100 + s.sp[lane]][lane] = value; s.sp[lane]--; };
+    auto pull = [&](size_t lane) -> uint8_t { s.sp[lane]++; return s.ram[0x0100 + s.sp[lane]][lane]; };
+    auto set_nz = [&](size_t lane, uint8_t value) {
+        s.p[lane] = static_cast<uint8_t>((s.p[lane] & ~(Zero | Negative)) | (value ? 0 : Zero) | (value & Negative));
+    };
+    auto set_flag = [&](size_t lane, uint8_t flag, bool on) { s.p[lane] = static_cast<uint8_t>(on ? (s.p[lane] | flag) : (s.p[lane] & ~flag)); };
+
+    // Operand values: a uniform RAM address is one contiguous row across all lanes
+    alignas(64) std::array<uint8_t, max_lanes> value{};
+    if (d.mode == Mode::Immediate) value.fill(op1);
+    else if (accesses && d.op != Op::JmpIndirect && !(d.op == Op::Sta || d.op == Op::Stx || d.op == Op::Sty)) {
+        if ((d.mode == Mode::ZeroPage || d.mode == Mode::Absolute) && operand < 0x2000) value = s.ram[ea[0] & 0x07FF];
+        else for (size_t i = 0; i < n; ++i) if (mask >> i & 1) value[i] = read(i, ea[i]);
+    }
+
+    // Every lane starts from the same next PC and cost; only branches and page crossings differ
+    alignas(64) std::array<uint16_t, max_lanes> next_pc;
+    alignas(64) std::array<uint32_t, max_lanes> cycles;
+    next_pc.fill(static_cast<uint16_t>(pc + length));
+    cycles.fill(d.cycles);
+    if (d.page_penalty) for (size_t i = 0; i < max_lanes; ++i) cycles[i] += crossed[i];
+
+    // The opcode is dispatched once; each case is its own loop over the issuing lanes
+    using Row = std::array<uint8_t, max_lanes>;
+    auto lanes = [&](auto&& body) { for (size_t i = 0; i < n; ++i) if (mask >> i & 1) body(i); };
+    auto load = [&](Row& reg) { lanes([&](size_t i) { reg[i] = value[i]; set_nz(i, reg[i]); }); };
+    auto store = [&](const Row& reg) { lanes([&](size_t i) { write(i, ea[i], reg[i]); }); };
+    auto transfer = [&](const Row& from, Row& to) { lanes([&](size_t i) { to[i] = from[i]; set_nz(i, to[i]); }); };
+    auto step = [&](Row& reg, uint8_t delta) { lanes([&](size_t i) { reg[i] = static_cast<uint8_t>(reg[i] + delta); set_nz(i, reg[i]); }); };
+    auto modify = [&](uint8_t delta) { lanes([&](size_t i) { uint8_t v = static_cast<uint8_t>(value[i] + delta); write(i, ea[i], v); set_nz(i, v); }); };
+    auto compare = [&](const Row& reg) { lanes([&](size_t i) { set_flag(i, Carry, reg[i] >= value[i]); set_nz(i, static_cast<uint8_t>(reg[i] - value[i])); }); };
+    auto flag = [&](uint8_t bit, bool on) { lanes([&](size_t i) { set_flag(i, bit, on); }); };
+    // ASL/LSR/ROL/ROR: `shift` maps (source, carry in) to the result; the carry out is bit 7 or bit 0
+    auto rmw_shift = [&](bool left, auto&& shift) {
+        const Row& src = d.mode == Mode::Accumulator ? s.a : value;
+        alignas(64) Row result{};
+        lanes([&](size_t i) {
+            result[i] = shift(src[i], static_cast<uint8_t>(s.p[i] & Carry));
+            set_flag(i, Carry, left ? (src[i] & 0x80) != 0 : (src[i] & 0x01) != 0);
+            set_nz(i, result[i]);
+        });
+        if (d.mode == Mode::Accumulator) lanes([&](size_t i) { s.a[i] = result[i]; });
+        else store(result);
+    };
+
+    switch (d.op) {
+        case Op::Lda: load(s.a); break;
+        case Op::Ldx: load(s.x); break;
+        case Op::Ldy: load(s.y); break;
+        case Op::Sta: store(s.a); break;
+        case Op::Stx: store(s.x); break;
+        case Op::Sty: store(s.y); break;
+        case Op::Tax: transfer(s.a, s.x); break;
+        case Op::Tay: transfer(s.a, s.y); break;
+        case Op::Txa: transfer(s.x, s.a); break;
+        case Op::Tya: transfer(s.y, s.a); break;
+        case Op::Tsx: transfer(s.sp, s.x); break;
+        case Op::Txs: lanes([&](size_t i) { s.sp[i] = s.x[i]; }); break;
+        case Op::Inx: step(s.x, 1); break;
+        case Op::Iny: step(s.y, 1); break;
+        case Op::Dex: step(s.x, 0xFF); break;
+        case Op::Dey: step(s.y, 0xFF); break;
+        case Op::Inc: modify(1); break;
+        case Op::Dec: modify(0xFF); break;
+        case Op::And: lanes([&](size_t i) { s.a[i] &= value[i]; set_nz(i, s.a[i]); }); break;
+        case Op::Ora: lanes([&](size_t i) { s.a[i] |= value[i]; set_nz(i, s.a[i]); }); break;
+        case Op::Eor: lanes([&](size_t i) { s.a[i] ^= value[i]; set_nz(i, s.a[i]); }); break;
+        case Op::Adc:
+            lanes([&](size_t i) {
+                const uint8_t v = value[i];
+                uint16_t sum = static_cast<uint16_t>(s.a[i] + v + (s.p[i] & Carry));
+                set_flag(i, Carry, sum > 0xFF);
+                set_flag(i, Overflow, (~(s.a[i] ^ v) & (s.a[i] ^ sum) & 0x80) != 0);
+                s.a[i] = static_cast<uint8_t>(sum);
+                set_nz(i, s.a[i]);
+            });
+            break;
+        case Op::Sbc:
+            lanes([&](size_t i) {
+                uint16_t inverted = static_cast<uint16_t>(value[i] ^ 0x00FF);
+                uint16_t diff = static_cast<uint16_t>(s.a[i] + inverted + (s.p[i] & Carry));
+                set_flag(i, Carry, (diff & 0xFF00) != 0);
+                set_flag(i, Overflow, ((diff ^ s.a[i]) & (diff ^ inverted) & 0x80) != 0);
+                s.a[i] = static_cast<uint8_t>(diff);
+                set_nz(i, s.a[i]);
+            });
+            break;
+        case Op::Cmp: compare(s.a); break;
+        case Op::Cpx: compare(s.x); break;
+        case Op::Cpy: compare(s.y); break;
+        case Op::Bit:
+            lanes([&](size_t i) {
+                const uint8_t v = value[i];
+                set_flag(i, Zero, (v & s.a[i]) == 0);
+                set_flag(i, Negative, (v & 0x80) != 0);
+                set_flag(i, Overflow, (v & 0x40) != 0);
+            });
+            break;
+        case Op::Asl: rmw_shift(true, [](uint8_t v, uint8_t) { return static_cast<uint8_t>(v << 1); }); break;
+        case Op::Rol: rmw_shift(true, [](uint8_t v, uint8_t carry) { return static_cast<uint8_t>((v << 1) | carry); }); break;
+        case Op::Lsr: rmw_shift(false, [](uint8_t v, uint8_t) { return static_cast<uint8_t>(v >> 1); }); break;
+        case Op::Ror: rmw_shift(false, [](uint8_t v, uint8_t carry) { return static_cast<uint8_t>((v >> 1) | (carry << 7)); }); break;
+        case Op::Branch: {
+            static const uint8_t flags[4] = { Negative, Overflow, Carry, Zero };
+            const uint8_t tested = flags[opcode >> 6];
+            const bool when_set = (opcode >> 5) & 1;
+            const uint16_t fallthrough = static_cast<uint16_t>(pc + length);
+            const uint16_t target = static_cast<uint16_t>(fallthrough + static_cast<int8_t>(op1));
+            const uint32_t taken_cycles = 1u + ((target & 0xFF00) != (fallthrough & 0xFF00));
+            lanes([&](size_t i) {
+                const bool taken = ((s.p[i] & tested) != 0) == when_set;
+                next_pc[i] = taken ? target : fallthrough;
+                cycles[i] += taken ? taken_cycles : 0;
+            });
+            break;
+        }
+        case Op::Clc: flag(Carry, false); break;
+        case Op::Sec: flag(Carry, true); break;
+        case Op::Cli: flag(InterruptDisable, false); break;
+        case Op::Sei: flag(InterruptDisable, true); break;
+        case Op::Cld: flag(Decimal, false); break;
+        case Op::Sed: flag(Decimal, true); break;
+        case Op::Clv: flag(Overflow, false); break;
+        case Op::Nop: break;
+        case Op::Jmp: next_pc.fill(operand); break;
+        case Op::JmpIndirect: // page-wrap bug included
+            lanes([&](size_t i) {
+                next_pc[i] = static_cast<uint16_t>(read(i, operand) | (read(i, static_cast<uint16_t>((operand & 0xFF00) | ((operand + 1) & 0x00FF))) << 8));
+            });
+            break;
+        case Op::Jsr: {
+            const uint16_t ret = static_cast<uint16_t>(pc + length - 1);
+            lanes([&](size_t i) {
+                push(i, static_cast<uint8_t>(ret >> 8));
+                push(i, static_cast<uint8_t>(ret & 0xFF));
+            });
+            next_pc.fill(operand);
+            break;
+        }
+        case Op::Rts:
+            lanes([&](size_t i) {
+                uint8_t low = pull(i);
+                uint8_t high = pull(i);
+                next_pc[i] = static_cast<uint16_t>(((high << 8) | low) + 1);
+            });
+            break;
+        case Op::Pha: lanes([&](size_t i) { push(i, s.a[i]); }); break;
+        case Op::Php: lanes([&](size_t i) { push(i, static_cast<uint8_t>(s.p[i] | Break | Unused)); set_flag(i, Break, false); }); break;
+        case Op::Pla: lanes([&](size_t i) { s.a[i] = pull(i); set_nz(i, s.a[i]); }); break;
+        case Op::Plp: lanes([&](size_t i) { s.p[i] = static_cast<uint8_t>(pull(i) | Unused); }); break;
+        case Op::None: break;
+    }
+    lanes([&](size_t i) {
+        s.pc[i] = next_pc[i];
+        s.cycles[i] += cycles[i];
+    });
+    return peel;
+}
@@ -2,38 +2,185 @@
 #include <fstream>
 #include <vector>
 #include <iomanip>
+#include <chrono>
+#include <cctype>
+#include <memory>
 #include "nes/emulator.h"
+#include "nes/wav.h"
+#include "nes/trace_events.h"
+#include "nes/video_sink.h"
+#include "nes/regression.h"
+#include "nes/shm_transport.h"
 // #include "nes/vulkan_renderer.h"  // Comment out if not using
 
+static bool has_extension(const std::string& path, const std::string& ext) {
+    if (path.size() < ext.size()) return false;
+    std::string tail = path.substr(path.size() - ext.size());
+    for (auto& c : tail) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return tail == ext;
+}
+
+// Audio-only path: render one NSF track straight to a streaming WAV
+static int render_nsf(const std::vector<uint8_t>& data, int argc, char** argv) {
+    int track = (argc > 2) ? std::stoi(argv[2]) : 0;
+    double seconds = (argc > 3) ? std::stod(argv[3]) : 120.0;
+    std::string out_path = (argc > 4) ? argv[4] : "out.wav";
+    nes::Emulator emu;
+    try { emu.load_nsf_bytes(data); emu.nsf_init(track); } catch (const std::exception& e) { std::cerr << "NSF error: " << e.what() << "\n"; return 3; }
+    const auto& header = emu.nsf()->get_header();
+    std::cout << "Rendering " << header.name << " - " << header.artist << ", track " << track + 1 << "/" << int(header.total_songs) << "\n";
+
+    nes::WavWriter wav(out_path, nes::Emulator::audio_sample_rate);
+    std::vector<int16_t> block;
+    const uint64_t target = static_cast<uint64_t>(seconds * nes::Emulator::audio_sample_rate);
+    auto start = std::chrono::steady_clock::now();
+    while (wav.samples_written() < target) {
+        emu.nsf_play_frame(block);
+        wav.write(block.data(), block.size());
+    }
+    wav.close();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << out_path << " (" << seconds << "s of audio in " << elapsed << "s)\n";
+    return 0;
+}
+
 int main(int argc, char** argv) {
-    if (argc < 2) { std::cout << "Usage: nesemu path/to/game.nes [steps]\n"; return 1; }
+    // --verbose (anywhere) prints CPU and PPU state after every frame; --force-shm replaces an existing
+    // shared-memory segment of the same name. The rest is positional.
+    bool verbose = false, force_shm = false;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--verbose") verbose = true;
+        else if (std::string(argv[i]) == "--force-shm") force_shm = true;
+        else argv[kept++] = argv[i];
+    }
+    argc = kept;
+    if (argc < 2) {
+        std::cout << "Usage: nesemu [--verbose] [--force-shm] path/to/game.nes [frames] [movie.nmv|-] [trace.bin|-] [events.json|-] [pace|pal|turbo|free] [video.y4m|-] [/shm-name]\n"
+                  << "       nesemu path/to/tune.nsf [track] [seconds] [out.wav]\n";
+        return 1;
+    }
     std::string path = argv[1];
-    int steps = (argc > 2) ? std::stoi(argv[2]) : 1000;
     std::ifstream ifs(path, std::ios::binary);
     if (!ifs) { std::cerr << "Failed to open ROM\n"; return 2; }
     std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (has_extension(path, ".nsf")) return render_nsf(data, argc, argv);
+    int frames = (argc > 2) ? std::stoi(argv[2]) : 60;
+    nes::Movie movie;
+    if (argc > 3 && std::string(argv[3]) != "-") {
+        try { movie = nes::Movie::load(argv[3]); } catch (const std::exception& e) { std::cerr << "Movie error: " << e.what() << "\n"; return 4; }
+    }
+    nes::MoviePlayer input(movie);
     nes::Emulator emu;
+    emu.set_input_provider(&input);
+    nes::Profiler profiler;
+    if (nes::Profiler::enabled) emu.set_profiler(&profiler);
+    std::unique_ptr<nes::TraceBuffer> trace;
+    if (argc > 4 && std::string(argv[4]) != "-") {
+        trace = std::make_unique<nes::TraceBuffer>(); // keeps the most recent instructions
+        emu.set_trace(trace.get());
+    }
     try { emu.load_rom_bytes(data); } catch (const std::exception& e) { std::cerr << "ROM error: " << e.what() << "\n"; return 3; }
     emu.reset();
-    std::cout << "Running " << steps << " steps...\n";
+    nes::TraceEventRecorder events; // keeps the last couple of seconds of frame phases
+    const bool record_events = argc > 5 && std::string(argv[5]) != "-";
+    if (record_events) {
+        events.start();
+        events.name_thread("emulator");
+    }
+    nes::PacingOptions pacing;
+    const std::string pace = (argc > 6) ? argv[6] : "pace";
+    if (pace == "pal") pacing.refresh_hz = nes::pal_refresh_hz;
+    else if (pace == "turbo") pacing.mode = nes::PacingMode::Turbo;
+    else if (pace == "free") pacing.mode = nes::PacingMode::Free;
+    else if (pace != "pace") { std::cerr << "Unknown pacing '" << pace << "' (expected pace, pal, turbo or free)\n"; return 1; }
+    emu.set_pacing(pacing);
+    const bool turbo = pacing.mode == nes::PacingMode::Turbo;
+    std::unique_ptr<nes::VideoSink> video; // every frame, with the audio in a matching WAV
+    std::vector<uint8_t> video_frame;
+    std::vector<int16_t> audio;
+    if (argc > 7 && std::string(argv[7]) != "-") {
+        nes::VideoSinkOptions video_options;
+        video_options.path = argv[7];
+        video_options.audio_path = std::string(argv[7]) + ".wav";
+        video_options.audio_sample_rate = nes::Emulator::audio_sample_rate;
+        video_options.refresh_hz = pacing.refresh_hz;
+        try { video = std::make_unique<nes::VideoSink>(video_options); } catch (const std::exception& e) { std::cerr << "Video error: " << e.what() << "\n"; return 5; }
+    }
+    std::unique_ptr<nes::ShmPublisher> shm; // frames and audio for consumers in other processes
+    if (argc > 8) {
+        nes::ShmOptions shm_options;
+        shm_options.name = argv[8];
+        shm_options.sample_rate = nes::Emulator::audio_sample_rate;
+        shm_options.force = force_shm;
+        try { shm = std::make_unique<nes::ShmPublisher>(shm_options); } catch (const std::exception& e) { std::cerr << "Shared memory error: " << e.what() << "\n"; return 6; }
+    }
+    if (video || shm) emu.generate_frame_audio(audio);
+    std::cout << "Running " << frames << " frames...\n";
 
     // VulkanRenderer renderer; renderer.init(256, 240);  // Comment out if not using
 
-    for (int i = 0; i < steps; ++i) {
-        try { emu.step(); } catch (const std::exception& e) { std::cout << "Stopped: " << e.what() << "\n"; break; }
-        if ((i % 100) == 0) {
-            std::cout << "Step " << i << " " << emu.cpu().state() << " | " << emu.ppu().debug_info() << "\n";
+    for (int i = 0; i < frames; ++i) {
+        nes::RunStatus status = emu.run_frame_paced();
+        if (status.error) { std::cout << "Stopped: no ROM loaded\n"; break; }
+        if (video || shm) {
+            emu.generate_frame_audio(audio);
+            if (turbo) emu.pacer()->decimate_audio(audio); // fast-forward: audio plays sped up like the video
+        }
+        if (video) {
+            // A frame the pacer skipped was never drawn: the sink repeats the last image for it. One the
+            // sink won't record doesn't need copying out of the PPU.
+            if (status.frame_skipped) video->push_repeat(audio.data(), audio.size());
+            else if (!video->wants_frame()) video->push_frame({}, audio.data(), audio.size());
+            else {
+                emu.ppu().render_frame(video_frame);
+                video->push_frame(video_frame, audio.data(), audio.size());
+            }
         }
+        if (shm) shm->publish(emu.ppu(), emu.frame_count(), audio.data(), audio.size());
+        if (verbose) std::cout << "Frame " << emu.frame_count() << " (" << status.cycles << " cycles) " << emu.cpu().state() << " | " << emu.ppu().debug_info() << "\n";
+    }
+
+    const nes::PacingStats pacing_stats = emu.pacer()->stats();
+    const nes::LatencyHistogram& intervals = emu.pacer()->frame_intervals();
+    std::cout << "Paced " << pacing_stats.frames << " frames: " << pacing_stats.presented << " presented, " << pacing_stats.skipped
+              << " skipped, " << pacing_stats.resyncs << " resyncs; frame interval p50 " << intervals.percentile(50) / 1000
+              << "us p99 " << intervals.percentile(99) / 1000 << "us, deadline error p99 " << emu.pacer()->deadline_error().percentile(99) / 1000 << "us\n";
+
+    if (video) {
+        try {
+            video->close();
+            std::cout << "Wrote " << video->frames_written() << " video frames to " << argv[7] << " (" << video->frames_dropped() << " dropped)\n";
+        } catch (const std::exception& e) { std::cerr << "Video error: " << e.what() << "\n"; }
     }
 
     // Export frame
     std::vector<uint8_t> frame;
     emu.ppu().render_frame(frame);
-    std::ofstream ofs("frame.ppm", std::ios::binary);
-    if (ofs) {
-        ofs << "P6\n256 240\n255\n";
-        ofs.write((char*)frame.data(), frame.size());
-        std::cout << "Exported frame.ppm\n";
+    try {
+        nes::save_ppm("frame.ppm", frame);
+        std::cout << "Exported frame.ppm (xxh64 " << std::hex << nes::xxh64(frame.data(), frame.size()) << std::dec << ")\n";
+    } catch (const std::exception& e) { std::cerr << e.what() << "\n"; }
+
+    if (nes::Profiler::enabled) {
+        std::ofstream report("profile.txt");
+        profiler.report(report);
+        std::cout << "Wrote profile.txt\n";
+    }
+
+    if (trace) {
+        try {
+            trace->save(argv[4]);
+            std::cout << "Wrote " << trace->size() << " of " << trace->total() << " traced instructions to " << argv[4] << "\n";
+        } catch (const std::exception& e) { std::cerr << "Trace error: " << e.what() << "\n"; }
+    }
+
+    if (record_events) {
+        events.stop();
+        try {
+            events.capture(argv[5]);
+            std::cout << "Wrote frame timeline to " << argv[5] << " (" << events.dropped() << " events dropped)\n";
+        } catch (const std::exception& e) { std::cerr << "Timeline error: " << e.what() << "\n"; }
     }
 
     // renderer.update_frame(frame); renderer.render();  // Comment out if not using
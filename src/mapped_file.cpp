@@ -0,0 +1,57 @@
+#include "nes/mapped_file.h"
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace nes;
+
+static uint8_t* map_fd(int fd, size_t size, const std::string& path, int protection = PROT_READ | PROT_WRITE) {
+    void* addr = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (addr == MAP_FAILED) throw std::runtime_error("Failed to map " + path);
+    return static_cast<uint8_t*>(addr);
+}
+
+MappedFile MappedFile::create(const std::string& path, size_t size) {
+    if (size == 0) throw std::invalid_argument("Cannot map an empty file");
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) throw std::runtime_error("Failed to create " + path);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) { ::close(fd); throw std::runtime_error("Failed to resize " + path); }
+    return MappedFile(map_fd(fd, size, path), size);
+}
+
+static size_t file_size(int fd, const std::string& path) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); throw std::runtime_error("Empty or unreadable file " + path); }
+    return static_cast<size_t>(st.st_size);
+}
+
+MappedFile MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) throw std::runtime_error("Failed to open " + path);
+    size_t size = file_size(fd, path);
+    return MappedFile(map_fd(fd, size, path), size);
+}
+
+MappedFile MappedFile::open_read_only(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open " + path);
+    size_t size = file_size(fd, path);
+    return MappedFile(map_fd(fd, size, path, PROT_READ), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (data_) munmap(data_, size_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() { if (data_) munmap(data_, size_); }
@@ -1,39 +1,147 @@
 #include "nes/memory.h"
+#include "nes/trace_events.h"
+#include "nes/regression.h"
 using namespace nes;
 
+static const std::array<uint8_t, 0x1000> unmapped_page{};
+
 MemoryMap::MemoryMap(const RomLoader* rom, VisualProcessor* visual, AudioProcessor* audio)
-    : internal_ram_{}, rom_(rom), visual_(visual), audio_(audio) {}
+    : state_{}, prg_pages_{}, prg_base_(unmapped_page.data()), prg_size_(unmapped_page.size()), rom_(rom), nsf_(nullptr), visual_(visual), audio_(audio) {
+    prg_pages_.fill(unmapped_page.data());
+    if (rom_ && !rom_->get_program().empty()) {
+        // 16 KB images mirror into $C000-$FFFF
+        const auto& prog = rom_->get_program();
+        prg_base_ = prog.data();
+        prg_size_ = prog.size();
+        for (int i = 0; i < 8; ++i) map_prg_page(i, static_cast<uint32_t>((i * 0x1000) % prog.size()));
+    }
+}
+
+MemoryMap::MemoryMap(const MemoryMap& other, VisualProcessor* visual, AudioProcessor* audio)
+    : state_(other.state_), internal_ram_(other.internal_ram_), prg_ram_(other.prg_ram_), prg_pages_(other.prg_pages_),
+      prg_base_(other.prg_base_), prg_size_(other.prg_size_), rom_(other.rom_), nsf_(other.nsf_), visual_(visual), audio_(audio) {}
+
+void MemoryMap::map_prg_page(int slot, uint32_t offset) noexcept {
+    state_.prg_offsets_[slot] = offset;
+    prg_pages_[slot] = prg_base_ + offset;
+}
+
+void MemoryMap::map_nsf(const NsfLoader* nsf) {
+    nsf_ = nsf;
+    prg_base_ = nsf_->get_bank(0);
+    prg_size_ = nsf_->image_size();
+    for (int i = 0; i < 8; ++i) map_prg_page(i, static_cast<uint32_t>(nsf_->get_bank(nsf_->initial_bank(i)) - prg_base_));
+}
+
+void MemoryMap::set_state(const State& state) noexcept {
+    state_ = state;
+    for (int i = 0; i < 8; ++i) prg_pages_[i] = prg_base_ + state_.prg_offsets_[i];
+}
+
+void MemoryMap::sync_from(const MemoryMap& other) noexcept {
+    set_state(other.state_);
+    internal_ram_.sync_from(other.internal_ram_);
+    prg_ram_.sync_from(other.prg_ram_);
+}
+
+bool MemoryMap::valid_state(const State& state) const noexcept {
+    for (uint32_t offset : state.prg_offsets_) {
+        if (offset % 0x1000 != 0 || offset > prg_size_ - 0x1000) return false;
+    }
+    return true;
+}
+
+uint64_t MemoryMap::prg_hash() const noexcept {
+    return xxh64(prg_base_, prg_size_);
+}
+
+void MemoryMap::take_access_counts(AccessCounts& reads, AccessCounts& writes) noexcept {
+    reads = reads_;
+    writes = writes_;
+    reads_.fill(0);
+    writes_.fill(0);
+}
+
+void MemoryMap::clear_work_ram() {
+    internal_ram_.clear();
+    prg_ram_.clear();
+}
 
 uint8_t MemoryMap::fetch(uint16_t address) const {
     address &= 0xFFFF;
-    if (address < 0x2000) return internal_ram_[address & 0x07FF];
-    if (address < 0x4000) return visual_->read_port((address - 0x2000) & 0x07);
+#if NES_ENABLE_BUS_COUNTERS
+    reads_[address >> 13]++;
+#endif
+    if (address < 0x2000) return internal_ram_.read(address & 0x07FF);
+#if NES_ENABLE_PROFILER
+    if (profiler_ && address < 0x4020) profiler_->count_io(address, false);
+#endif
+    if (address < 0x4000) return visual_ ? visual_->read_port((address - 0x2000) & 0x07) : 0;
     if (address < 0x4020) {
-        if (address == 0x4016 || address == 0x4017) return 0; // input stub
+        if (address == 0x4016 || address == 0x4017) return 0x40 | state_.controllers_[address & 1].read(); // bit 6 is open bus, usually $40
         return audio_->read_port(address);
     }
-    if (address >= 0x8000) {
-        const auto& prog = rom_->get_program();
-        if (prog.size() == 0x4000) return prog[address & 0x3FFF];
-        return prog[address - 0x8000];
-    }
+    if (address >= 0x8000) return prg_pages_[(address >> 12) & 0x07][address & 0x0FFF];
+    if (address >= 0x6000) return prg_ram_.read(address & 0x1FFF);
     return 0;
 }
 
 void MemoryMap::store(uint16_t address, uint8_t value) {
     address &= 0xFFFF;
     value &= 0xFF;
-    if (address < 0x2000) internal_ram_[address & 0x07FF] = value;
-    else if (address < 0x4000) visual_->write_port((address - 0x2000) & 0x07, value);
+#if NES_ENABLE_BUS_COUNTERS
+    writes_[address >> 13]++;
+#endif
+#if NES_ENABLE_PROFILER
+    if (profiler_ && address >= 0x2000 && address < 0x4020) profiler_->count_io(address, true);
+#endif
+    if (address >= 0x2000 && address < 0x4020) {
+        TraceEventRecorder* events = TraceEventRecorder::active();
+        if (events && events->io_writes()) events->instant("io_write", TraceCategory::Io, "addr_value", static_cast<uint64_t>(address) << 8 | value);
+    }
+    if (address < 0x2000) internal_ram_.write(address & 0x07FF, value);
+    else if (address < 0x4000) { if (visual_) visual_->write_port((address - 0x2000) & 0x07, value); }
+    else if (address == 0x4014) oam_dma(value);
     else if (address < 0x4020) {
-        if (address == 0x4016) {} // input latch stub
+        if (address == 0x4016) {
+            state_.controllers_[0].write_strobe(value);
+            state_.controllers_[1].write_strobe(value);
+        }
         else audio_->write_port(address, value);
     }
-    else if (address == 0x4014) {
-        oam_dma(value); // Trigger OAM DMA
+    else if (address >= 0x5FF8 && address < 0x6000) {
+        if (nsf_) map_prg_page(address - 0x5FF8, static_cast<uint32_t>(nsf_->get_bank(value) - prg_base_));
     }
+    else if (address >= 0x6000 && address < 0x8000) prg_ram_.write(address & 0x1FFF, value);
 }
 
+bool MemoryMap::irq_asserted() const noexcept {
+    return audio_ && audio_->irq_pending();
+}
+
+// RAM and ROM pages go to OAM as one block; only a page in the register space needs 256 bus reads.
+// The 513/514-cycle CPU stall is charged by the emulator when the DmaComplete event fires, right
+// after the writing instruction.
 void MemoryMap::oam_dma(uint8_t page) {
-    ppu_->oam_dma(page);
-}
\ No newline at end of file
+    if (!visual_) return;
+    const uint16_t base = static_cast<uint16_t>(page << 8);
+    std::array<uint8_t, 256> bus_bytes;
+    const uint8_t* source;
+    if (base < 0x2000) {
+        const size_t offset = base & 0x07FF;
+        source = internal_ram_.page(0) + offset;
+    } else if (base >= 0x8000) {
+        source = prg_pages_[(base >> 12) & 0x07] + (base & 0x0FFF);
+    } else if (base >= 0x6000) {
+        const size_t offset = base & 0x1FFF;
+        source = prg_ram_.page(offset / cow_page_size) + offset % cow_page_size;
+    } else {
+        for (size_t i = 0; i < bus_bytes.size(); ++i) bus_bytes[i] = fetch(static_cast<uint16_t>(base + i));
+        source = bus_bytes.data();
+    }
+#if NES_ENABLE_BUS_COUNTERS
+    if (source != bus_bytes.data()) reads_[base >> 13] += 256;
+#endif
+    visual_->oam_dma(source);
+    if (scheduler_) scheduler_->schedule(EventType::DmaComplete, scheduler_->now());
+}
@@ -0,0 +1,204 @@
+#include "nes/metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace nes;
+
+namespace {
+constexpr size_t region_count = static_cast<size_t>(MemoryRegion::Count);
+
+size_t bucket_index(uint64_t value) noexcept {
+    if (value < 32) return static_cast<size_t>(value);
+    int msb = 63;
+    while (!(value >> msb)) --msb;
+    const int shift = msb - 4;                       // keep the top five bits: 16..31
+    return 32 + static_cast<size_t>(msb - 5) * 16 + static_cast<size_t>((value >> shift) - 16);
+}
+
+uint64_t bucket_upper(size_t index) noexcept {
+    if (index < 32) return index;
+    const size_t msb = 5 + (index - 32) / 16;
+    const uint64_t mantissa = 16 + (index - 32) % 16;
+    const uint64_t shift = msb - 4;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+double load_seconds(const std::atomic<uint64_t>& ns) noexcept {
+    return static_cast<double>(ns.load(std::memory_order_relaxed)) * 1e-9;
+}
+}
+
+const char* nes::memory_region_name(MemoryRegion region) noexcept {
+    switch (region) {
+        case MemoryRegion::Ram: return "ram";
+        case MemoryRegion::Ppu: return "ppu";
+        case MemoryRegion::ApuIo: return "apu_io";
+        case MemoryRegion::CartRam: return "cart_ram";
+        case MemoryRegion::Rom: return "rom";
+        case MemoryRegion::Count: break;
+    }
+    return "unknown";
+}
+
+void LatencyHistogram::record(uint64_t value) noexcept {
+    buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::percentile(double p) const noexcept {
+    const uint64_t total = count();
+    if (total == 0) return 0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * static_cast<double>(total) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(bucket_upper(i), max());
+    }
+    return max(); // buckets raced ahead of count_ while we read
+}
+
+void LatencyHistogram::clear() noexcept {
+    for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+}
+
+MetricsSnapshot& MetricsSnapshot::operator+=(const MetricsSnapshot& other) noexcept {
+    cpu_cycles += other.cpu_cycles;
+    instructions += other.instructions;
+    ppu_dots += other.ppu_dots;
+    frames += other.frames;
+    apu_samples += other.apu_samples;
+    dma_stall_cycles += other.dma_stall_cycles;
+    for (size_t i = 0; i < region_count; ++i) {
+        memory_reads[i] += other.memory_reads[i];
+        memory_writes[i] += other.memory_writes[i];
+    }
+    cpu_seconds += other.cpu_seconds;
+    event_seconds += other.event_seconds;
+    frame_time_count += other.frame_time_count;
+    frame_time_seconds += other.frame_time_seconds;
+    frame_time_p50_us = std::max(frame_time_p50_us, other.frame_time_p50_us);
+    frame_time_p99_us = std::max(frame_time_p99_us, other.frame_time_p99_us);
+    frame_time_p999_us = std::max(frame_time_p999_us, other.frame_time_p999_us);
+    frame_time_max_us = std::max(frame_time_max_us, other.frame_time_max_us);
+    return *this;
+}
+
+void Metrics::publish(const Delta& delta) noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    counters_.cpu_cycles.fetch_add(delta.cpu_cycles, relaxed);
+    counters_.instructions.fetch_add(delta.instructions, relaxed);
+    counters_.ppu_dots.fetch_add(delta.ppu_dots, relaxed);
+    counters_.frames.fetch_add(delta.frames, relaxed);
+    counters_.apu_samples.fetch_add(delta.apu_samples, relaxed);
+    counters_.dma_stall_cycles.fetch_add(delta.dma_stall_cycles, relaxed);
+    counters_.cpu_ns.fetch_add(delta.cpu_ns, relaxed);
+    counters_.event_ns.fetch_add(delta.event_ns, relaxed);
+    for (size_t i = 0; i < region_count; ++i) {
+        if (delta.memory_reads[i]) memory_.reads[i].fetch_add(delta.memory_reads[i], relaxed);
+        if (delta.memory_writes[i]) memory_.writes[i].fetch_add(delta.memory_writes[i], relaxed);
+    }
+}
+
+MetricsSnapshot Metrics::snapshot() const noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    MetricsSnapshot s;
+    s.cpu_cycles = counters_.cpu_cycles.load(relaxed);
+    s.instructions = counters_.instructions.load(relaxed);
+    s.ppu_dots = counters_.ppu_dots.load(relaxed);
+    s.frames = counters_.frames.load(relaxed);
+    s.apu_samples = counters_.apu_samples.load(relaxed);
+    s.dma_stall_cycles = counters_.dma_stall_cycles.load(relaxed);
+    for (size_t i = 0; i < region_count; ++i) {
+        s.memory_reads[i] = memory_.reads[i].load(relaxed);
+        s.memory_writes[i] = memory_.writes[i].load(relaxed);
+    }
+    s.cpu_seconds = load_seconds(counters_.cpu_ns);
+    s.event_seconds = load_seconds(counters_.event_ns);
+    s.frame_time_count = frame_times_.count();
+    s.frame_time_seconds = static_cast<double>(frame_times_.sum()) * 1e-9;
+    s.frame_time_p50_us = static_cast<double>(frame_times_.percentile(50)) / 1000.0;
+    s.frame_time_p99_us = static_cast<double>(frame_times_.percentile(99)) / 1000.0;
+    s.frame_time_p999_us = static_cast<double>(frame_times_.percentile(99.9)) / 1000.0;
+    s.frame_time_max_us = static_cast<double>(frame_times_.max()) / 1000.0;
+    return s;
+}
+
+void Metrics::clear() noexcept {
+    for (auto* c : { &counters_.cpu_cycles, &counters_.instructions, &counters_.ppu_dots, &counters_.frames, &counters_.apu_samples,
+                     &counters_.dma_stall_cycles, &counters_.cpu_ns, &counters_.event_ns }) {
+        c->store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < region_count; ++i) {
+        memory_.reads[i].store(0, std::memory_order_relaxed);
+        memory_.writes[i].store(0, std::memory_order_relaxed);
+    }
+    frame_times_.clear();
+}
+
+std::string nes::metrics_json(const MetricsSnapshot& s) {
+    std::ostringstream out;
+    out << "{\"cpu_cycles\":" << s.cpu_cycles << ",\"instructions\":" << s.instructions << ",\"ppu_dots\":" << s.ppu_dots
+        << ",\"frames\":" << s.frames << ",\"apu_samples\":" << s.apu_samples << ",\"dma_stall_cycles\":" << s.dma_stall_cycles
+        << ",\"memory\":{";
+    for (size_t i = 0; i < region_count; ++i) {
+        out << (i ? "," : "") << "\"" << memory_region_name(static_cast<MemoryRegion>(i)) << "\":{\"reads\":" << s.memory_reads[i]
+            << ",\"writes\":" << s.memory_writes[i] << "}";
+    }
+    out << "},\"wall_seconds\":{\"cpu\":" << s.cpu_seconds << ",\"events\":" << s.event_seconds << "}"
+        << ",\"frame_time_us\":{\"count\":" << s.frame_time_count << ",\"p50\":" << s.frame_time_p50_us << ",\"p99\":" << s.frame_time_p99_us
+        << ",\"p999\":" << s.frame_time_p999_us << ",\"max\":" << s.frame_time_max_us << "}}";
+    return out.str();
+}
+
+std::string nes::metrics_prometheus(const MetricsSnapshot& s, const std::string& labels) {
+    std::ostringstream out;
+    const std::string plain = labels.empty() ? "" : "{" + labels + "}";
+    auto with = [&](const std::string& extra) { return "{" + (labels.empty() ? extra : labels + "," + extra) + "}"; };
+    auto counter = [&](const char* name, const char* help, uint64_t value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n" << name << plain << " " << value << "\n";
+    };
+    counter("nes_cpu_cycles_total", "CPU cycles emulated", s.cpu_cycles);
+    counter("nes_cpu_instructions_total", "CPU instructions executed", s.instructions);
+    counter("nes_ppu_dots_total", "PPU dots emulated", s.ppu_dots);
+    counter("nes_frames_total", "Frames completed", s.frames);
+    counter("nes_apu_samples_total", "Audio samples generated", s.apu_samples);
+    counter("nes_dma_stall_cycles_total", "CPU cycles stalled by DMA", s.dma_stall_cycles);
+
+    out << "# HELP nes_memory_accesses_total CPU bus accesses by region\n# TYPE nes_memory_accesses_total counter\n";
+    for (size_t i = 0; i < region_count; ++i) {
+        const std::string region = std::string("region=\"") + memory_region_name(static_cast<MemoryRegion>(i)) + "\"";
+        out << "nes_memory_accesses_total" << with(region + ",op=\"read\"") << " " << s.memory_reads[i] << "\n";
+        out << "nes_memory_accesses_total" << with(region + ",op=\"write\"") << " " << s.memory_writes[i] << "\n";
+    }
+    out << "# HELP nes_wall_seconds_total Host time by subsystem\n# TYPE nes_wall_seconds_total counter\n";
+    out << "nes_wall_seconds_total" << with("subsystem=\"cpu\"") << " " << s.cpu_seconds << "\n";
+    out << "nes_wall_seconds_total" << with("subsystem=\"events\"") << " " << s.event_seconds << "\n";
+
+    out << "# HELP nes_frame_time_seconds Host time per emulated frame\n# TYPE nes_frame_time_seconds summary\n";
+    out << "nes_frame_time_seconds" << with("quantile=\"0.5\"") << " " << s.frame_time_p50_us * 1e-6 << "\n";
+    out << "nes_frame_time_seconds" << with("quantile=\"0.99\"") << " " << s.frame_time_p99_us * 1e-6 << "\n";
+    out << "nes_frame_time_seconds" << with("quantile=\"0.999\"") << " " << s.frame_time_p999_us * 1e-6 << "\n";
+    out << "nes_frame_time_seconds_sum" << plain << " " << s.frame_time_seconds << "\n";
+    out << "nes_frame_time_seconds_count" << plain << " " << s.frame_time_count << "\n";
+    return out.str();
+}
+
+void nes::write_metrics_file(const std::string& path, const std::string& text) {
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary);
+        if (!out || !out.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+            throw std::runtime_error("Failed to write metrics: " + temp);
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) throw std::runtime_error("Failed to replace metrics file: " + path);
+}
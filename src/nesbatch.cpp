@@ -0,0 +1,81 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <stdexcept>
+#include "nes/batch.h"
+#include "nes/metrics.h"
+
+// Job file: one job per line, "rom_path frames [inputs_file|-] [video.y4m|-] [hashes.nhsh|-] [golden.nhsh]";
+// blank lines and '#' comments are skipped. An inputs file holds one raw controller byte per frame.
+// With a golden log the job fails on the first frame whose video or audio hash differs. A line that
+// does not parse stops the run with its file and line number.
+static std::vector<nes::BatchJob> read_jobs(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Failed to open job file " + path);
+    std::vector<nes::BatchJob> jobs;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        if (line.empty() || line[0] == '#') continue;
+        const std::string where = path + ":" + std::to_string(number) + ": ";
+        std::istringstream fields(line);
+        nes::BatchJob job;
+        std::string inputs_path, extra;
+        if (!(fields >> job.rom_path)) continue; // whitespace only
+        if (!(fields >> job.frames)) throw std::runtime_error(where + "expected \"rom_path frames\", got \"" + line + "\"");
+        if (fields >> inputs_path && inputs_path != "-") {
+            std::ifstream inputs(inputs_path, std::ios::binary);
+            if (!inputs) throw std::runtime_error(where + "cannot open inputs file " + inputs_path);
+            job.inputs.assign((std::istreambuf_iterator<char>(inputs)), std::istreambuf_iterator<char>());
+        }
+        for (std::string* field : { &job.video_path, &job.hash_log_path, &job.golden_path }) {
+            if (!(fields >> *field)) break;
+            if (*field == "-") field->clear();
+        }
+        if (fields >> extra) throw std::runtime_error(where + "unexpected field \"" + extra + "\"");
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: nesbatch jobs.txt [workers] [ram_dir|-] [metrics.prom]\n";
+        return 1;
+    }
+    std::vector<nes::BatchJob> jobs;
+    try { jobs = read_jobs(argv[1]); } catch (const std::exception& e) { std::cerr << e.what() << "\n"; return 2; }
+    nes::BatchOptions options;
+    if (argc > 2) options.workers = static_cast<unsigned>(std::stoul(argv[2]));
+    std::string ram_dir = (argc > 3 && std::string(argv[3]) != "-") ? argv[3] : "";
+
+    nes::BatchRunner runner(options);
+    std::cout << "Running " << jobs.size() << " jobs on " << runner.workers() << " workers...\n";
+    std::vector<nes::BatchResult> results = runner.run(jobs);
+
+    int failed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        std::cout << "Job " << i << " " << jobs[i].rom_path << " frames=" << r.frames
+                  << " hash=" << std::hex << std::setw(16) << std::setfill('0') << r.frame_hash << std::dec << std::setfill(' ')
+                  << " load=" << r.load_ms << "ms run=" << r.run_ms << "ms worker=" << r.worker;
+        if (!jobs[i].video_path.empty()) std::cout << " video=" << jobs[i].video_path << " dropped=" << r.video_frames_dropped;
+        if (!r.error.empty()) { std::cout << " error: " << r.error; failed++; }
+        else if (r.divergent_frame >= 0) { std::cout << " DIVERGED at frame " << r.divergent_frame; failed++; }
+        std::cout << "\n";
+        if (!ram_dir.empty() && !r.ram.empty()) {
+            std::ofstream ram(ram_dir + "/job" + std::to_string(i) + ".ram", std::ios::binary);
+            ram.write(reinterpret_cast<const char*>(r.ram.data()), static_cast<std::streamsize>(r.ram.size()));
+        }
+    }
+    const auto& stats = runner.stats();
+    std::cout << stats.frames << " frames in " << stats.wall_seconds << "s (" << stats.frames_per_second
+              << " fps aggregate, " << stats.steals << " steals)\n";
+    std::cout << nes::metrics_json(stats.metrics) << "\n";
+    if (argc > 4) {
+        try { nes::write_metrics_file(argv[4], nes::metrics_prometheus(stats.metrics, "job=\"nesbatch\"")); }
+        catch (const std::exception& e) { std::cerr << e.what() << "\n"; }
+    }
+    return failed ? 4 : 0;
+}
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "nes/emulator.h"
+#include "nes/rom_builder.h"
+#include "nes/workloads.h"
+
+// Micro-benchmarks over ROMs generated in-tree, so runs need no game files and are comparable across
+// commits. Every benchmark reports a rate (items per second) per repetition; warmup repetitions are
+// run first and discarded.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+    uint64_t items = 0;
+    double seconds = 0;
+};
+
+struct Benchmark {
+    std::string name;
+    std::string unit;                  // what one item is, reported as <unit>/s
+    std::function<Sample()> run;       // one repetition; setup that should not count stays outside timed()
+};
+
+struct Summary {
+    std::string name, unit;
+    std::vector<double> rates;         // sorted ascending
+    double mean = 0;
+};
+
+struct Options {
+    int warmup = 2;
+    int reps = 10;
+    std::string filter;                // substring match on the benchmark name
+    std::string json_path = "nesbench.json";
+    std::string label;                 // free text, e.g. the commit being measured
+    std::string dump_dir;              // write the workload ROMs here instead of benchmarking
+};
+
+template <typename F>
+Sample timed(uint64_t items, F&& body) {
+    auto start = Clock::now();
+    body();
+    return Sample{ items, std::chrono::duration<double>(Clock::now() - start).count() };
+}
+
+using M = nes::AddrMode;
+
+struct AddressingMode {
+    const char* name;
+    const char* mnemonic;
+    M mode;
+    uint16_t operand;
+};
+
+const std::vector<AddressingMode> addressing_modes = {
+    { "implied", "INX", M::Implied, 0 },
+    { "immediate", "LDA", M::Immediate, 0x42 },
+    { "zeropage", "LDA", M::ZeroPage, 0x10 },
+    { "zeropage_x", "LDA", M::ZeroPageX, 0x10 },
+    { "absolute", "LDA", M::Absolute, 0x0300 },
+    { "absolute_x", "LDA", M::AbsoluteX, 0x0300 },
+    { "absolute_y", "LDA", M::AbsoluteY, 0x0300 },
+    { "indirect_x", "LDA", M::IndirectX, 0x10 },
+    { "indirect_y", "LDA", M::IndirectY, 0x10 },
+    { "relative", "BCC", M::Relative, 0 },          // always taken, to the next instruction
+    { "read_modify_write", "INC", M::ZeroPage, 0x10 },
+    { "store_absolute", "STA", M::Absolute, 0x0300 },
+};
+
+// About 4 KB of the same instruction, then a jump back; carry is clear so BCC is always taken
+std::vector<uint8_t> addressing_mode_rom(const AddressingMode& mode) {
+    nes::Assembler a;
+    a.op("SEI").op("CLD").op("CLC").op("LDX", M::Immediate, 0).op("LDY", M::Immediate, 0).label("loop");
+    while (a.here() < 0xCFF0) {
+        uint16_t operand = mode.mode == M::Relative ? static_cast<uint16_t>(a.here() + 2) : mode.operand;
+        a.op(mode.mnemonic, mode.mode, operand);
+    }
+    a.op("JMP", M::Absolute, "loop").label("rti").op("RTI");
+    nes::RomBuilder rom;
+    rom.place(a).vectors(a.address_of("rti"), a.origin(), a.address_of("rti"));
+    return rom.build();
+}
+
+std::unique_ptr<nes::Emulator> boot(const std::shared_ptr<const nes::ROM>& rom, bool rendering) {
+    auto emu = std::make_unique<nes::Emulator>();
+    emu->set_rendering(rendering);
+    emu->load_rom(rom);
+    emu->reset();
+    return emu;
+}
+
+std::vector<Benchmark> build_benchmarks() {
+    constexpr uint64_t dots_per_frame = 341 * 262;
+    std::vector<Benchmark> benches;
+
+    for (const auto& mode : addressing_modes) {
+        auto rom = std::make_shared<const nes::ROM>(addressing_mode_rom(mode));
+        benches.push_back({ std::string("cpu/") + mode.name, "instructions", [rom] {
+            auto emu = boot(rom, false);
+            constexpr uint64_t steps = 200000;
+            return timed(steps, [&] { for (uint64_t i = 0; i < steps; ++i) emu->step(); });
+        } });
+    }
+
+    auto idle_rom = std::make_shared<const nes::ROM>(nes::build_workload(nes::Workload::Alu));
+    benches.push_back({ "memory/fetch_ram", "reads", [idle_rom] {
+        auto emu = boot(idle_rom, false);
+        constexpr uint64_t reads = 1 << 22;
+        volatile uint8_t sink = 0;
+        return timed(reads, [&] {
+            uint8_t acc = 0;
+            for (uint64_t i = 0; i < reads; ++i) acc ^= emu->memory().read(static_cast<uint16_t>(i & 0x1FFF));
+            sink = acc;
+        });
+    } });
+    benches.push_back({ "memory/fetch_prg", "reads", [idle_rom] {
+        auto emu = boot(idle_rom, false);
+        constexpr uint64_t reads = 1 << 22;
+        volatile uint8_t sink = 0;
+        return timed(reads, [&] {
+            uint8_t acc = 0;
+            for (uint64_t i = 0; i < reads; ++i) acc ^= emu->memory().read(static_cast<uint16_t>(0x8000 | (i & 0x7FFF)));
+            sink = acc;
+        });
+    } });
+
+    benches.push_back({ "ppu/dots", "dots", [idle_rom] {
+        auto emu = boot(idle_rom, true);
+        emu->ppu().write_register(1, 0x1E);
+        constexpr uint64_t dots = dots_per_frame * 10;
+        return timed(dots, [&] { emu->ppu().run_dots(dots); });
+    } });
+    benches.push_back({ "ppu/frames_headless", "frames", [idle_rom] {
+        auto emu = boot(idle_rom, false);
+        emu->ppu().write_register(1, 0x1E);
+        constexpr uint64_t frames = 10;
+        return timed(frames, [&] { emu->ppu().run_dots(dots_per_frame * frames); });
+    } });
+
+    benches.push_back({ "apu/generate_audio", "samples", [] {
+        nes::APU apu;
+        apu.reset();
+        apu.write_register(0x4015, 0x0F);                               // pulse 1/2, triangle, noise
+        apu.write_register(0x4000, 0xBF); apu.write_register(0x4002, 0xFD); apu.write_register(0x4003, 0x08);
+        apu.write_register(0x4004, 0x7F); apu.write_register(0x4006, 0x80); apu.write_register(0x4007, 0x09);
+        apu.write_register(0x4008, 0xFF); apu.write_register(0x400A, 0x40); apu.write_register(0x400B, 0x08);
+        apu.write_register(0x400C, 0x3F); apu.write_register(0x400E, 0x04); apu.write_register(0x400F, 0x08);
+        std::vector<int16_t> buffer;
+        constexpr int samples = 44100;
+        return timed(samples, [&] { apu.generate_audio(samples, buffer); });
+    } });
+
+    const std::vector<uint8_t> image = nes::build_workload(nes::Workload::Scrolling);
+    benches.push_back({ "rom/load", "loads", [image] {
+        nes::Emulator emu;
+        emu.set_rendering(false);
+        constexpr uint64_t loads = 200;
+        return timed(loads, [&] {
+            for (uint64_t i = 0; i < loads; ++i) { emu.load_rom(std::make_shared<const nes::ROM>(image)); emu.reset(); }
+        });
+    } });
+
+    auto frame_rom = std::make_shared<const nes::ROM>(image);
+    benches.push_back({ "emulator/frames", "frames", [frame_rom] {
+        auto emu = boot(frame_rom, true);
+        constexpr uint64_t frames = 60;
+        return timed(frames, [&] { for (uint64_t i = 0; i < frames; ++i) emu->run_frame(); });
+    } });
+    benches.push_back({ "emulator/frames_headless", "frames", [frame_rom] {
+        auto emu = boot(frame_rom, false);
+        constexpr uint64_t frames = 60;
+        return timed(frames, [&] { for (uint64_t i = 0; i < frames; ++i) emu->run_frame(); });
+    } });
+
+    for (nes::Workload workload : nes::all_workloads) {
+        auto rom = std::make_shared<const nes::ROM>(nes::build_workload(workload));
+        benches.push_back({ std::string("workload/") + nes::workload_name(workload), "frames", [rom] {
+            auto emu = boot(rom, true);
+            constexpr uint64_t frames = 60;
+            return timed(frames, [&] { for (uint64_t i = 0; i < frames; ++i) emu->run_frame(); });
+        } });
+    }
+    return benches;
+}
+
+// Nearest-rank percentile over an ascending vector
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+std::string json_escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out;
+}
+
+void write_json(std::ostream& out, const Options& options, const std::vector<Summary>& results) {
+    out << std::setprecision(10);
+    out << "{\n  \"label\": \"" << json_escape(options.label) << "\",\n  \"warmup\": " << options.warmup
+        << ",\n  \"repetitions\": " << options.reps << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Summary& s = results[i];
+        out << "    { \"name\": \"" << s.name << "\", \"unit\": \"" << s.unit << "/s\""
+            << ", \"min\": " << s.rates.front() << ", \"p50\": " << percentile(s.rates, 50)
+            << ", \"p90\": " << percentile(s.rates, 90) << ", \"p99\": " << percentile(s.rates, 99)
+            << ", \"max\": " << s.rates.back() << ", \"mean\": " << s.mean << " }"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--reps" && has_value) options.reps = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--warmup" && has_value) options.warmup = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--filter" && has_value) options.filter = argv[++i];
+        else if (arg == "--json" && has_value) options.json_path = argv[++i];
+        else if (arg == "--label" && has_value) options.label = argv[++i];
+        else if (arg == "--dump-roms" && has_value) options.dump_dir = argv[++i];
+        else return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cout << "Usage: nesbench [--reps N] [--warmup N] [--filter text] [--json out.json] [--label text]\n"
+                  << "       nesbench --dump-roms dir\n";
+        return 1;
+    }
+    if (!options.dump_dir.empty()) {
+        for (nes::Workload workload : nes::all_workloads) {
+            std::string path = options.dump_dir + "/" + nes::workload_name(workload) + ".nes";
+            std::vector<uint8_t> image = nes::build_workload(workload);
+            std::ofstream out(path, std::ios::binary);
+            if (!out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()))) {
+                std::cerr << "Failed to write " << path << "\n";
+                return 2;
+            }
+            std::cout << "Wrote " << path << "\n";
+        }
+        return 0;
+    }
+
+    std::vector<Summary> results;
+    try {
+        for (const Benchmark& bench : build_benchmarks()) {
+            if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) continue;
+            for (int i = 0; i < options.warmup; ++i) bench.run();
+            Summary summary{ bench.name, bench.unit, {}, 0 };
+            for (int i = 0; i < options.reps; ++i) {
+                Sample sample = bench.run();
+                double rate = sample.seconds > 0 ? static_cast<double>(sample.items) / sample.seconds : 0;
+                summary.rates.push_back(rate);
+                summary.mean += rate / options.reps;
+            }
+            std::sort(summary.rates.begin(), summary.rates.end());
+            std::cout << std::left << std::setw(28) << summary.name << std::right << std::fixed << std::setprecision(0)
+                      << " p50 " << std::setw(14) << percentile(summary.rates, 50)
+                      << "  p90 " << std::setw(14) << percentile(summary.rates, 90)
+                      << "  min " << std::setw(14) << summary.rates.front() << "  " << summary.unit << "/s\n";
+            results.push_back(std::move(summary));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark error: " << e.what() << "\n";
+        return 3;
+    }
+
+    std::ofstream json(options.json_path);
+    if (!json) { std::cerr << "Failed to write " << options.json_path << "\n"; return 2; }
+    write_json(json, options, results);
+    std::cout << "Wrote " << options.json_path << "\n";
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "nes/regression.h"
+#include "nes/shm_transport.h"
+
+// Reference consumer for ShmPublisher: follows the ring, reports publish-to-read latency and frames
+// missed, and optionally saves the first frame it sees as a PPM.
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: nesshm /shm-name [frames] [first.ppm]\n";
+        return 1;
+    }
+    const uint64_t limit = (argc > 2) ? std::stoull(argv[2]) : 0; // 0: until the publisher closes
+    std::unique_ptr<nes::ShmReader> reader;
+    for (int attempt = 0; !reader; ++attempt) {
+        try { reader = std::make_unique<nes::ShmReader>(argv[1]); }
+        catch (const std::exception& e) {
+            if (attempt == 50) { std::cerr << e.what() << "\n"; return 2; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // publisher still starting
+        }
+    }
+
+    nes::ShmFrame frame;
+    uint64_t frames = 0, missed = 0;
+    double latency_sum_us = 0, latency_max_us = 0;
+    while (limit == 0 || frames < limit) {
+        nes::ShmReader::Result result = reader->next(frame, 5000);
+        if (result == nes::ShmReader::Result::Closed) break;
+        if (result == nes::ShmReader::Result::Timeout) { std::cerr << "No frame for 5s\n"; break; }
+        const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        const double latency_us = static_cast<double>(static_cast<uint64_t>(now) - frame.timestamp_ns) / 1000.0;
+        latency_sum_us += latency_us;
+        latency_max_us = std::max(latency_max_us, latency_us);
+        missed += frame.missed;
+        if (frames == 0 && argc > 3) {
+            try { nes::save_ppm(argv[3], frame.rgb); } catch (const std::exception& e) { std::cerr << e.what() << "\n"; }
+        }
+        frames++;
+    }
+    std::cout << frames << " frames read, " << missed << " missed, latency mean " << (frames ? latency_sum_us / static_cast<double>(frames) : 0)
+              << "us max " << latency_max_us << "us\n";
+    return 0;
+}
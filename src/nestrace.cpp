@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "nes/rom_builder.h"
+#include "nes/trace.h"
+
+// Offline decoder for TraceBuffer files: one nestest-style line per record, e.g.
+// C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7
+
+static std::string format_operand(const nes::TraceRecord& r, nes::AddrMode mode) {
+    using M = nes::AddrMode;
+    char text[16] = "";
+    const unsigned word = r.operand1 | (r.operand2 << 8);
+    switch (mode) {
+        case M::Implied: break;
+        case M::Accumulator: std::snprintf(text, sizeof(text), "A"); break;
+        case M::Immediate: std::snprintf(text, sizeof(text), "#$%02X", r.operand1); break;
+        case M::ZeroPage: std::snprintf(text, sizeof(text), "$%02X", r.operand1); break;
+        case M::ZeroPageX: std::snprintf(text, sizeof(text), "$%02X,X", r.operand1); break;
+        case M::ZeroPageY: std::snprintf(text, sizeof(text), "$%02X,Y", r.operand1); break;
+        case M::Absolute: std::snprintf(text, sizeof(text), "$%04X", word); break;
+        case M::AbsoluteX: std::snprintf(text, sizeof(text), "$%04X,X", word); break;
+        case M::AbsoluteY: std::snprintf(text, sizeof(text), "$%04X,Y", word); break;
+        case M::Indirect: std::snprintf(text, sizeof(text), "($%04X)", word); break;
+        case M::IndirectX: std::snprintf(text, sizeof(text), "($%02X,X)", r.operand1); break;
+        case M::IndirectY: std::snprintf(text, sizeof(text), "($%02X),Y", r.operand1); break;
+        case M::Relative:
+            std::snprintf(text, sizeof(text), "$%04X", static_cast<unsigned>((r.pc + 2 + static_cast<int8_t>(r.operand1)) & 0xFFFF));
+            break;
+    }
+    return text;
+}
+
+static std::string format_record(const nes::TraceRecord& r) {
+    const char* mnemonic = nullptr;
+    nes::AddrMode mode = nes::AddrMode::Implied;
+    char bytes[16];
+    char disassembly[48];
+    if (nes::decode_opcode(r.opcode, mnemonic, mode)) {
+        int size = nes::operand_size(mode);
+        if (size == 0) std::snprintf(bytes, sizeof(bytes), "%02X", r.opcode);
+        else if (size == 1) std::snprintf(bytes, sizeof(bytes), "%02X %02X", r.opcode, r.operand1);
+        else std::snprintf(bytes, sizeof(bytes), "%02X %02X %02X", r.opcode, r.operand1, r.operand2);
+        std::snprintf(disassembly, sizeof(disassembly), "%s %s", mnemonic, format_operand(r, mode).c_str());
+    } else {
+        std::snprintf(bytes, sizeof(bytes), "%02X", r.opcode);
+        std::snprintf(disassembly, sizeof(disassembly), ".db $%02X", r.opcode);
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%04X  %-8s  %-31s A:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3u CYC:%llu",
+                  r.pc, bytes, disassembly, r.a, r.x, r.y, r.p, r.sp, r.scanline, static_cast<unsigned>(r.dot),
+                  static_cast<unsigned long long>(r.cycle));
+    return line;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: nestrace trace.bin [out.log]\n";
+        return 1;
+    }
+    std::vector<nes::TraceRecord> records;
+    try { records = nes::TraceBuffer::load(argv[1]); } catch (const std::exception& e) { std::cerr << e.what() << "\n"; return 2; }
+    FILE* out = stdout;
+    if (argc > 2 && !(out = std::fopen(argv[2], "w"))) { std::cerr << "Failed to create " << argv[2] << "\n"; return 3; }
+    for (const auto& r : records) {
+        std::fputs(format_record(r).c_str(), out);
+        std::fputc('\n', out);
+    }
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "nes/nsf.h"
+#include <cstring>
+#include <algorithm>
+
+namespace nes {
+static std::string read_field(const std::vector<uint8_t>& data, size_t offset) {
+    const char* text = reinterpret_cast<const char*>(data.data() + offset);
+    return std::string(text, strnlen(text, 32));
+}
+
+NsfLoader::NsfLoader(const std::vector<uint8_t>& data) {
+    if (data.size() < 0x80 || std::memcmp(data.data(), "NESM\x1A", 5) != 0) {
+        throw std::runtime_error("Invalid NSF format");
+    }
+    header_.version = data[5];
+    header_.total_songs = data[6];
+    header_.starting_song = data[7];
+    header_.load_address = static_cast<uint16_t>(data[8] | (data[9] << 8));
+    header_.init_address = static_cast<uint16_t>(data[0x0A] | (data[0x0B] << 8));
+    header_.play_address = static_cast<uint16_t>(data[0x0C] | (data[0x0D] << 8));
+    header_.name = read_field(data, 0x0E);
+    header_.artist = read_field(data, 0x2E);
+    header_.copyright = read_field(data, 0x4E);
+    header_.ntsc_speed = static_cast<uint16_t>(data[0x6E] | (data[0x6F] << 8));
+    std::copy(data.begin() + 0x70, data.begin() + 0x78, header_.bank_init.begin());
+    header_.pal_speed = static_cast<uint16_t>(data[0x78] | (data[0x79] << 8));
+    header_.region_flags = data[0x7A];
+    header_.extra_chips = data[0x7B];
+    if (header_.total_songs == 0) throw std::runtime_error("NSF has no songs");
+
+    const size_t payload = data.size() - 0x80;
+    if (payload == 0) throw std::runtime_error("NSF has no tune data");
+    bankswitched_ = std::any_of(header_.bank_init.begin(), header_.bank_init.end(), [](uint8_t b) { return b != 0; });
+    if (bankswitched_) {
+        // Banks are aligned to 4 KB; the payload starts at the load address' offset inside its bank
+        size_t padding = header_.load_address & 0x0FFF;
+        bank_count_ = (padding + payload + 0x0FFF) / 0x1000;
+        image_.assign(bank_count_ * 0x1000, 0);
+        std::copy(data.begin() + 0x80, data.end(), image_.begin() + padding);
+        initial_banks_ = header_.bank_init;
+    } else {
+        if (header_.load_address < 0x8000) throw std::runtime_error("NSF load address below $8000");
+        size_t offset = header_.load_address - 0x8000;
+        bank_count_ = 8;
+        image_.assign(0x8000, 0);
+        std::copy(data.begin() + 0x80, data.begin() + 0x80 + std::min(payload, image_.size() - offset), image_.begin() + offset);
+        for (int i = 0; i < 8; ++i) initial_banks_[i] = static_cast<uint8_t>(i);
+    }
+}
+
+uint32_t NsfLoader::play_period_us() const noexcept {
+    uint16_t speed = is_pal() ? header_.pal_speed : header_.ntsc_speed;
+    if (speed == 0) return is_pal() ? 20000 : 16639; // fall back to the video frame rate
+    return speed;
+}
+}
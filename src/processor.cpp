@@ -10,95 +10,97 @@ static const std::array<Processor6502::Instruction, 256> create_instruction_tabl
 
 inline uint8_t Processor6502::read_memory(uint16_t addr) const { return memory_->fetch(addr); }
 inline void Processor6502::write_memory(uint16_t addr, uint8_t val) { const_cast<MemoryMap*>(memory_)->store(addr, val); }
-inline void Processor6502::push_stack(uint8_t val) { write_memory(0x0100 + stack_pointer_, val); stack_pointer_--; }
-inline uint8_t Processor6502::pull_stack() { stack_pointer_++; return read_memory(0x0100 + stack_pointer_); }
+inline void Processor6502::push_stack(uint8_t val) { write_memory(0x0100 + regs_.stack_pointer_, val); regs_.stack_pointer_--; }
+inline uint8_t Processor6502::pull_stack() { regs_.stack_pointer_++; return read_memory(0x0100 + regs_.stack_pointer_); }
 
 Processor6502::Processor6502(const MemoryMap* memory) : memory_(memory) {
-    accumulator_ = index_x_ = index_y_ = 0;
-    stack_pointer_ = 0xFD;
-    status_flags_ = 0x00 | Unused;
-    absolute_address_ = relative_offset_ = 0;
-    operand_value_ = 0;
-    current_instruction_ = 0;
-    cycle_count_ = 0;
+    regs_.accumulator_ = regs_.index_x_ = regs_.index_y_ = 0;
+    regs_.stack_pointer_ = 0xFD;
+    regs_.status_flags_ = 0x00 | Unused;
+    regs_.absolute_address_ = regs_.relative_offset_ = 0;
+    regs_.operand_value_ = 0;
+    regs_.current_instruction_ = 0;
+    regs_.cycle_count_ = 0;
+    regs_.irq_armed_ = false;
 }
 
-uint16_t Processor6502::get_program_counter() const noexcept { return program_counter_; }
+uint16_t Processor6502::get_program_counter() const noexcept { return regs_.program_counter_; }
 
 void Processor6502::initialize() {
-    accumulator_ = index_x_ = index_y_ = 0;
-    stack_pointer_ = 0xFD;
-    status_flags_ = 0x00 | Unused;
-    absolute_address_ = relative_offset_ = 0;
-    operand_value_ = 0;
+    regs_.accumulator_ = regs_.index_x_ = regs_.index_y_ = 0;
+    regs_.stack_pointer_ = 0xFD;
+    regs_.status_flags_ = 0x00 | Unused;
+    regs_.absolute_address_ = regs_.relative_offset_ = 0;
+    regs_.operand_value_ = 0;
+    regs_.irq_armed_ = false;
     // Reset vector at 0xFFFC
-    program_counter_ = static_cast<uint16_t>(read_memory(0xFFFC) | (read_memory(0xFFFD) << 8));
-    cycle_count_ = 8;
+    regs_.program_counter_ = static_cast<uint16_t>(read_memory(0xFFFC) | (read_memory(0xFFFD) << 8));
+    regs_.cycle_count_ = 8;
 }
 
 uint8_t Processor6502::load_operand() {
-    if ((instruction_table_[current_instruction_].addressing == &Processor6502::implied_mode)) {
-        operand_value_ = accumulator_;
+    if ((instruction_table_[regs_.current_instruction_].addressing == &Processor6502::implied_mode)) {
+        regs_.operand_value_ = regs_.accumulator_;
     } else {
-        operand_value_ = read_memory(absolute_address_);
+        regs_.operand_value_ = read_memory(regs_.absolute_address_);
     }
-    return operand_value_;
+    return regs_.operand_value_;
 }
 
 // ADDRESSING MODES
-int Processor6502::implied_mode() { operand_value_ = accumulator_; return 0; }
-int Processor6502::immediate_mode() { absolute_address_ = program_counter_++; return 0; }
-int Processor6502::zero_page_mode() { absolute_address_ = read_memory(program_counter_++); absolute_address_ &= 0x00FF; return 0; }
-int Processor6502::zero_page_x_mode() { absolute_address_ = (read_memory(program_counter_++) + index_x_) & 0x00FF; return 0; }
-int Processor6502::zero_page_y_mode() { absolute_address_ = (read_memory(program_counter_++) + index_y_) & 0x00FF; return 0; }
+int Processor6502::implied_mode() { regs_.operand_value_ = regs_.accumulator_; return 0; }
+int Processor6502::immediate_mode() { regs_.absolute_address_ = regs_.program_counter_++; return 0; }
+int Processor6502::zero_page_mode() { regs_.absolute_address_ = read_memory(regs_.program_counter_++); regs_.absolute_address_ &= 0x00FF; return 0; }
+int Processor6502::zero_page_x_mode() { regs_.absolute_address_ = (read_memory(regs_.program_counter_++) + regs_.index_x_) & 0x00FF; return 0; }
+int Processor6502::zero_page_y_mode() { regs_.absolute_address_ = (read_memory(regs_.program_counter_++) + regs_.index_y_) & 0x00FF; return 0; }
 int Processor6502::absolute_mode() {
-    uint16_t low = read_memory(program_counter_++);
-    uint16_t high = read_memory(program_counter_++);
-    absolute_address_ = (high << 8) | low;
+    uint16_t low = read_memory(regs_.program_counter_++);
+    uint16_t high = read_memory(regs_.program_counter_++);
+    regs_.absolute_address_ = (high << 8) | low;
     return 0;
 }
 int Processor6502::absolute_x_mode() {
-    uint16_t low = read_memory(program_counter_++);
-    uint16_t high = read_memory(program_counter_++);
-    absolute_address_ = ((high << 8) | low) + index_x_;
-    if ((absolute_address_ & 0xFF00) != (high << 8)) return 1;
+    uint16_t low = read_memory(regs_.program_counter_++);
+    uint16_t high = read_memory(regs_.program_counter_++);
+    regs_.absolute_address_ = ((high << 8) | low) + regs_.index_x_;
+    if ((regs_.absolute_address_ & 0xFF00) != (high << 8)) return 1;
     return 0;
 }
 int Processor6502::absolute_y_mode() {
-    uint16_t low = read_memory(program_counter_++);
-    uint16_t high = read_memory(program_counter_++);
-    absolute_address_ = ((high << 8) | low) + index_y_;
-    if ((absolute_address_ & 0xFF00) != (high << 8)) return 1;
+    uint16_t low = read_memory(regs_.program_counter_++);
+    uint16_t high = read_memory(regs_.program_counter_++);
+    regs_.absolute_address_ = ((high << 8) | low) + regs_.index_y_;
+    if ((regs_.absolute_address_ & 0xFF00) != (high << 8)) return 1;
     return 0;
 }
 int Processor6502::indirect_mode() {
-    uint16_t ptr_low = read_memory(program_counter_++);
-    uint16_t ptr_high = read_memory(program_counter_++);
+    uint16_t ptr_low = read_memory(regs_.program_counter_++);
+    uint16_t ptr_high = read_memory(regs_.program_counter_++);
     uint16_t ptr = (ptr_high << 8) | ptr_low;
     // 6502 bug: if low byte is 0xFF, fetch wraps on page
     uint16_t low = read_memory(ptr);
     uint16_t high = read_memory((ptr & 0xFF00) | ((ptr + 1) & 0x00FF));
-    absolute_address_ = (high << 8) | low;
+    regs_.absolute_address_ = (high << 8) | low;
     return 0;
 }
 int Processor6502::indexed_indirect_mode() {
-    uint16_t temp = read_memory(program_counter_++);
-    uint16_t low = read_memory((temp + index_x_) & 0x00FF);
-    uint16_t high = read_memory((temp + index_x_ + 1) & 0x00FF);
-    absolute_address_ = (high << 8) | low;
+    uint16_t temp = read_memory(regs_.program_counter_++);
+    uint16_t low = read_memory((temp + regs_.index_x_) & 0x00FF);
+    uint16_t high = read_memory((temp + regs_.index_x_ + 1) & 0x00FF);
+    regs_.absolute_address_ = (high << 8) | low;
     return 0;
 }
 int Processor6502::indirect_indexed_mode() {
-    uint16_t temp = read_memory(program_counter_++);
+    uint16_t temp = read_memory(regs_.program_counter_++);
     uint16_t low = read_memory(temp & 0x00FF);
     uint16_t high = read_memory((temp + 1) & 0x00FF);
-    absolute_address_ = ((high << 8) | low) + index_y_;
-    if ((absolute_address_ & 0xFF00) != (high << 8)) return 1;
+    regs_.absolute_address_ = ((high << 8) | low) + regs_.index_y_;
+    if ((regs_.absolute_address_ & 0xFF00) != (high << 8)) return 1;
     return 0;
 }
 int Processor6502::relative_mode() {
-    relative_offset_ = read_memory(program_counter_++);
-    if (relative_offset_ & 0x80) relative_offset_ |= 0xFF00;
+    regs_.relative_offset_ = read_memory(regs_.program_counter_++);
+    if (regs_.relative_offset_ & 0x80) regs_.relative_offset_ |= 0xFF00;
     return 0;
 }
 
@@ -113,156 +115,156 @@ void Processor6502::perform_comparison(uint8_t reg, uint8_t val) {
 // OPERATIONS
 int Processor6502::add_with_carry() {
     load_operand();
-    uint16_t sum = static_cast<uint16_t>(accumulator_) + operand_value_ + check_flag(Carry);
+    uint16_t sum = static_cast<uint16_t>(regs_.accumulator_) + regs_.operand_value_ + check_flag(Carry);
     set_flag(Carry, sum > 0xFF);
     set_flag(Zero, (sum & 0xFF) == 0);
-    set_flag(Overflow, (~(static_cast<int>(accumulator_) ^ static_cast<int>(operand_value_)) & (static_cast<int>(accumulator_) ^ static_cast<int>(sum)) & 0x80));
+    set_flag(Overflow, (~(static_cast<int>(regs_.accumulator_) ^ static_cast<int>(regs_.operand_value_)) & (static_cast<int>(regs_.accumulator_) ^ static_cast<int>(sum)) & 0x80));
     set_flag(Negative, sum & 0x80);
-    accumulator_ = static_cast<uint8_t>(sum & 0xFF);
+    regs_.accumulator_ = static_cast<uint8_t>(sum & 0xFF);
     return 1;
 }
 
-int Processor6502::logical_and() { load_operand(); accumulator_ &= operand_value_; set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 1; }
+int Processor6502::logical_and() { load_operand(); regs_.accumulator_ &= regs_.operand_value_; set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 1; }
 int Processor6502::arithmetic_shift_left() {
     load_operand();
-    uint16_t shifted = static_cast<uint16_t>(operand_value_) << 1;
+    uint16_t shifted = static_cast<uint16_t>(regs_.operand_value_) << 1;
     set_flag(Carry, (shifted & 0xFF00) != 0);
     set_flag(Zero, (shifted & 0x00FF) == 0);
     set_flag(Negative, shifted & 0x80);
-    if (instruction_table_[current_instruction_].addressing == &Processor6502::implied_mode) accumulator_ = static_cast<uint8_t>(shifted & 0x00FF);
-    else write_memory(absolute_address_, static_cast<uint8_t>(shifted & 0x00FF));
+    if (instruction_table_[regs_.current_instruction_].addressing == &Processor6502::implied_mode) regs_.accumulator_ = static_cast<uint8_t>(shifted & 0x00FF);
+    else write_memory(regs_.absolute_address_, static_cast<uint8_t>(shifted & 0x00FF));
     return 0;
 }
 
-int Processor6502::branch_carry_clear() { if (check_flag(Carry) == 0) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
-int Processor6502::branch_carry_set() { if (check_flag(Carry) == 1) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
-int Processor6502::branch_equal() { if (check_flag(Zero) == 1) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
+int Processor6502::branch_carry_clear() { if (check_flag(Carry) == 0) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
+int Processor6502::branch_carry_set() { if (check_flag(Carry) == 1) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
+int Processor6502::branch_equal() { if (check_flag(Zero) == 1) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
 int Processor6502::test_bits() {
     load_operand();
-    uint8_t result = operand_value_ & accumulator_;
+    uint8_t result = regs_.operand_value_ & regs_.accumulator_;
     set_flag(Zero, (result) == 0);
-    set_flag(Negative, operand_value_ & 0x80);
-    set_flag(Overflow, operand_value_ & 0x40);
+    set_flag(Negative, regs_.operand_value_ & 0x80);
+    set_flag(Overflow, regs_.operand_value_ & 0x40);
     return 0;
 }
-int Processor6502::branch_minus() { if (check_flag(Negative) == 1) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
-int Processor6502::branch_not_equal() { if (check_flag(Zero) == 0) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
-int Processor6502::branch_plus() { if (check_flag(Negative) == 0) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
+int Processor6502::branch_minus() { if (check_flag(Negative) == 1) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
+int Processor6502::branch_not_equal() { if (check_flag(Zero) == 0) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
+int Processor6502::branch_plus() { if (check_flag(Negative) == 0) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
 int Processor6502::software_interrupt() {
-    program_counter_++;
+    regs_.program_counter_++;
     set_flag(InterruptDisable, true);
-    push_stack(static_cast<uint8_t>((program_counter_ >> 8) & 0x00FF));
-    push_stack(static_cast<uint8_t>(program_counter_ & 0x00FF));
+    push_stack(static_cast<uint8_t>((regs_.program_counter_ >> 8) & 0x00FF));
+    push_stack(static_cast<uint8_t>(regs_.program_counter_ & 0x00FF));
     set_flag(Break, true);
-    push_stack(status_flags_);
+    push_stack(regs_.status_flags_);
     set_flag(Break, false);
-    program_counter_ = static_cast<uint16_t>(read_memory(0xFFFE) | (read_memory(0xFFFF) << 8));
+    regs_.program_counter_ = static_cast<uint16_t>(read_memory(0xFFFE) | (read_memory(0xFFFF) << 8));
     return 0;
 }
-int Processor6502::branch_overflow_clear() { if (check_flag(Overflow) == 0) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
-int Processor6502::branch_overflow_set() { if (check_flag(Overflow) == 1) { cycle_count_++; uint16_t prev = program_counter_; program_counter_ += relative_offset_; if ((program_counter_ & 0xFF00) != (prev & 0xFF00)) cycle_count_++; } return 0; }
+int Processor6502::branch_overflow_clear() { if (check_flag(Overflow) == 0) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
+int Processor6502::branch_overflow_set() { if (check_flag(Overflow) == 1) { regs_.cycle_count_++; uint16_t prev = regs_.program_counter_; regs_.program_counter_ += regs_.relative_offset_; if ((regs_.program_counter_ & 0xFF00) != (prev & 0xFF00)) regs_.cycle_count_++; } return 0; }
 int Processor6502::clear_carry_flag() { set_flag(Carry, false); return 0; }
 int Processor6502::clear_decimal_flag() { set_flag(Decimal, false); return 0; }
 int Processor6502::clear_interrupt_flag() { set_flag(InterruptDisable, false); return 0; }
 int Processor6502::clear_overflow_flag() { set_flag(Overflow, false); return 0; }
-int Processor6502::compare_with_accumulator() { load_operand(); perform_comparison(accumulator_, operand_value_); return 1; }
-int Processor6502::compare_with_x_register() { load_operand(); perform_comparison(index_x_, operand_value_); return 0; }
-int Processor6502::compare_with_y_register() { load_operand(); perform_comparison(index_y_, operand_value_); return 0; }
-int Processor6502::decrement_memory() { load_operand(); uint8_t val = static_cast<uint8_t>(operand_value_ - 1); write_memory(absolute_address_, val); set_flag(Zero, val == 0); set_flag(Negative, val & 0x80); return 0; }
-int Processor6502::decrement_x_register() { index_x_ = static_cast<uint8_t>(index_x_ - 1); set_flag(Zero, index_x_ == 0); set_flag(Negative, index_x_ & 0x80); return 0; }
-int Processor6502::decrement_y_register() { index_y_ = static_cast<uint8_t>(index_y_ - 1); set_flag(Zero, index_y_ == 0); set_flag(Negative, index_y_ & 0x80); return 0; }
-int Processor6502::exclusive_or() { load_operand(); accumulator_ ^= operand_value_; set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 1; }
-int Processor6502::increment_memory() { load_operand(); uint8_t val = static_cast<uint8_t>(operand_value_ + 1); write_memory(absolute_address_, val); set_flag(Zero, val == 0); set_flag(Negative, val & 0x80); return 0; }
-int Processor6502::increment_x_register() { index_x_ = static_cast<uint8_t>(index_x_ + 1); set_flag(Zero, index_x_ == 0); set_flag(Negative, index_x_ & 0x80); return 0; }
-int Processor6502::increment_y_register() { index_y_ = static_cast<uint8_t>(index_y_ + 1); set_flag(Zero, index_y_ == 0); set_flag(Negative, index_y_ & 0x80); return 0; }
+int Processor6502::compare_with_accumulator() { load_operand(); perform_comparison(regs_.accumulator_, regs_.operand_value_); return 1; }
+int Processor6502::compare_with_x_register() { load_operand(); perform_comparison(regs_.index_x_, regs_.operand_value_); return 0; }
+int Processor6502::compare_with_y_register() { load_operand(); perform_comparison(regs_.index_y_, regs_.operand_value_); return 0; }
+int Processor6502::decrement_memory() { load_operand(); uint8_t val = static_cast<uint8_t>(regs_.operand_value_ - 1); write_memory(regs_.absolute_address_, val); set_flag(Zero, val == 0); set_flag(Negative, val & 0x80); return 0; }
+int Processor6502::decrement_x_register() { regs_.index_x_ = static_cast<uint8_t>(regs_.index_x_ - 1); set_flag(Zero, regs_.index_x_ == 0); set_flag(Negative, regs_.index_x_ & 0x80); return 0; }
+int Processor6502::decrement_y_register() { regs_.index_y_ = static_cast<uint8_t>(regs_.index_y_ - 1); set_flag(Zero, regs_.index_y_ == 0); set_flag(Negative, regs_.index_y_ & 0x80); return 0; }
+int Processor6502::exclusive_or() { load_operand(); regs_.accumulator_ ^= regs_.operand_value_; set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 1; }
+int Processor6502::increment_memory() { load_operand(); uint8_t val = static_cast<uint8_t>(regs_.operand_value_ + 1); write_memory(regs_.absolute_address_, val); set_flag(Zero, val == 0); set_flag(Negative, val & 0x80); return 0; }
+int Processor6502::increment_x_register() { regs_.index_x_ = static_cast<uint8_t>(regs_.index_x_ + 1); set_flag(Zero, regs_.index_x_ == 0); set_flag(Negative, regs_.index_x_ & 0x80); return 0; }
+int Processor6502::increment_y_register() { regs_.index_y_ = static_cast<uint8_t>(regs_.index_y_ + 1); set_flag(Zero, regs_.index_y_ == 0); set_flag(Negative, regs_.index_y_ & 0x80); return 0; }
 int Processor6502::jump_to_subroutine() {
-    program_counter_--;
-    push_stack(static_cast<uint8_t>((program_counter_ >> 8) & 0x00FF));
-    push_stack(static_cast<uint8_t>(program_counter_ & 0x00FF));
-    program_counter_ = absolute_address_;
+    regs_.program_counter_--;
+    push_stack(static_cast<uint8_t>((regs_.program_counter_ >> 8) & 0x00FF));
+    push_stack(static_cast<uint8_t>(regs_.program_counter_ & 0x00FF));
+    regs_.program_counter_ = regs_.absolute_address_;
     return 0;
 }
-int Processor6502::load_accumulator() { load_operand(); accumulator_ = operand_value_; set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 1; }
-int Processor6502::load_x_register() { load_operand(); index_x_ = operand_value_; set_flag(Zero, index_x_ == 0); set_flag(Negative, index_x_ & 0x80); return 1; }
-int Processor6502::load_y_register() { load_operand(); index_y_ = operand_value_; set_flag(Zero, index_y_ == 0); set_flag(Negative, index_y_ & 0x80); return 1; }
+int Processor6502::load_accumulator() { load_operand(); regs_.accumulator_ = regs_.operand_value_; set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 1; }
+int Processor6502::load_x_register() { load_operand(); regs_.index_x_ = regs_.operand_value_; set_flag(Zero, regs_.index_x_ == 0); set_flag(Negative, regs_.index_x_ & 0x80); return 1; }
+int Processor6502::load_y_register() { load_operand(); regs_.index_y_ = regs_.operand_value_; set_flag(Zero, regs_.index_y_ == 0); set_flag(Negative, regs_.index_y_ & 0x80); return 1; }
 int Processor6502::logical_shift_right() {
     load_operand();
-    set_flag(Carry, operand_value_ & 0x01);
-    uint8_t temp = static_cast<uint8_t>(operand_value_ >> 1);
+    set_flag(Carry, regs_.operand_value_ & 0x01);
+    uint8_t temp = static_cast<uint8_t>(regs_.operand_value_ >> 1);
     set_flag(Zero, temp == 0);
     set_flag(Negative, temp & 0x80);
-    if (instruction_table_[current_instruction_].addressing == &Processor6502::implied_mode) accumulator_ = temp;
-    else write_memory(absolute_address_, temp);
+    if (instruction_table_[regs_.current_instruction_].addressing == &Processor6502::implied_mode) regs_.accumulator_ = temp;
+    else write_memory(regs_.absolute_address_, temp);
     return 0;
 }
 int Processor6502::no_operation() { // many opcodes are effectively NOPs
     // some NOPs have extra cycles/bytes; we use basic NOP behavior here
     return 0;
 }
-int Processor6502::or_with_accumulator() { load_operand(); accumulator_ |= operand_value_; set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 1; }
-int Processor6502::push_accumulator() { push_stack(accumulator_); return 0; }
-int Processor6502::push_processor_status() { push_stack(status_flags_ | Break | Unused); set_flag(Break, false); return 0; }
-int Processor6502::pull_accumulator() { accumulator_ = pull_stack(); set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 0; }
-int Processor6502::pull_processor_status() { status_flags_ = pull_stack(); set_flag(Unused, true); return 0; }
+int Processor6502::or_with_accumulator() { load_operand(); regs_.accumulator_ |= regs_.operand_value_; set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 1; }
+int Processor6502::push_accumulator() { push_stack(regs_.accumulator_); return 0; }
+int Processor6502::push_processor_status() { push_stack(regs_.status_flags_ | Break | Unused); set_flag(Break, false); return 0; }
+int Processor6502::pull_accumulator() { regs_.accumulator_ = pull_stack(); set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 0; }
+int Processor6502::pull_processor_status() { regs_.status_flags_ = pull_stack(); set_flag(Unused, true); return 0; }
 int Processor6502::rotate_left() {
     load_operand();
-    uint16_t rotated = (static_cast<uint16_t>(operand_value_) << 1) | check_flag(Carry);
+    uint16_t rotated = (static_cast<uint16_t>(regs_.operand_value_) << 1) | check_flag(Carry);
     set_flag(Carry, rotated & 0xFF00);
     set_flag(Zero, (rotated & 0x00FF) == 0);
     set_flag(Negative, rotated & 0x80);
-    if (instruction_table_[current_instruction_].addressing == &Processor6502::implied_mode) accumulator_ = static_cast<uint8_t>(rotated & 0x00FF);
-    else write_memory(absolute_address_, static_cast<uint8_t>(rotated & 0x00FF));
+    if (instruction_table_[regs_.current_instruction_].addressing == &Processor6502::implied_mode) regs_.accumulator_ = static_cast<uint8_t>(rotated & 0x00FF);
+    else write_memory(regs_.absolute_address_, static_cast<uint8_t>(rotated & 0x00FF));
     return 0;
 }
 int Processor6502::rotate_right() {
     load_operand();
-    uint16_t rotated = (check_flag(Carry) << 7) | (operand_value_ >> 1);
-    set_flag(Carry, operand_value_ & 0x01);
+    uint16_t rotated = (check_flag(Carry) << 7) | (regs_.operand_value_ >> 1);
+    set_flag(Carry, regs_.operand_value_ & 0x01);
     set_flag(Zero, (rotated & 0x00FF) == 0);
     set_flag(Negative, rotated & 0x80);
-    if (instruction_table_[current_instruction_].addressing == &Processor6502::implied_mode) accumulator_ = static_cast<uint8_t>(rotated & 0x00FF);
-    else write_memory(absolute_address_, static_cast<uint8_t>(rotated & 0x00FF));
+    if (instruction_table_[regs_.current_instruction_].addressing == &Processor6502::implied_mode) regs_.accumulator_ = static_cast<uint8_t>(rotated & 0x00FF);
+    else write_memory(regs_.absolute_address_, static_cast<uint8_t>(rotated & 0x00FF));
     return 0;
 }
 int Processor6502::return_from_interrupt() {
-    status_flags_ = pull_stack();
-    status_flags_ &= ~Break;
-    status_flags_ |= Unused;
+    regs_.status_flags_ = pull_stack();
+    regs_.status_flags_ &= ~Break;
+    regs_.status_flags_ |= Unused;
     uint16_t low = pull_stack();
     uint16_t high = pull_stack();
-    program_counter_ = (high << 8) | low;
+    regs_.program_counter_ = (high << 8) | low;
     return 0;
 }
 int Processor6502::return_from_subroutine() {
     uint16_t low = pull_stack();
     uint16_t high = pull_stack();
-    program_counter_ = ((high << 8) | low) + 1;
+    regs_.program_counter_ = ((high << 8) | low) + 1;
     return 0;
 }
 int Processor6502::subtract_with_carry() {
     load_operand();
-    uint16_t value = static_cast<uint16_t>(operand_value_) ^ 0x00FF;
-    uint16_t temp = static_cast<uint16_t>(accumulator_) + value + check_flag(Carry);
+    uint16_t value = static_cast<uint16_t>(regs_.operand_value_) ^ 0x00FF;
+    uint16_t temp = static_cast<uint16_t>(regs_.accumulator_) + value + check_flag(Carry);
     set_flag(Carry, temp & 0xFF00);
     set_flag(Zero, (temp & 0x00FF) == 0);
-    set_flag(Overflow, ( (temp ^ accumulator_) & (temp ^ value) & 0x80 ));
+    set_flag(Overflow, ( (temp ^ regs_.accumulator_) & (temp ^ value) & 0x80 ));
     set_flag(Negative, temp & 0x80);
-    accumulator_ = static_cast<uint8_t>(temp & 0x00FF);
+    regs_.accumulator_ = static_cast<uint8_t>(temp & 0x00FF);
     return 1;
 }
 int Processor6502::set_carry_flag() { set_flag(Carry, true); return 0; }
 int Processor6502::set_decimal_flag() { set_flag(Decimal, true); return 0; }
 int Processor6502::set_interrupt_flag() { set_flag(InterruptDisable, true); return 0; }
 int Processor6502::set_overflow_flag() { set_flag(Overflow, true); return 0; }
-int Processor6502::store_accumulator() { write_memory(absolute_address_, accumulator_); return 0; }
-int Processor6502::store_x_register() { write_memory(absolute_address_, index_x_); return 0; }
-int Processor6502::store_y_register() { write_memory(absolute_address_, index_y_); return 0; }
-int Processor6502::transfer_accumulator_to_x() { index_x_ = accumulator_; set_flag(Zero, index_x_ == 0); set_flag(Negative, index_x_ & 0x80); return 0; }
-int Processor6502::transfer_accumulator_to_y() { index_y_ = accumulator_; set_flag(Zero, index_y_ == 0); set_flag(Negative, index_y_ & 0x80); return 0; }
-int Processor6502::transfer_stack_pointer_to_x() { index_x_ = stack_pointer_; set_flag(Zero, index_x_ == 0); set_flag(Negative, index_x_ & 0x80); return 0; }
-int Processor6502::transfer_x_to_accumulator() { accumulator_ = index_x_; set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 0; }
-int Processor6502::transfer_x_to_stack_pointer() { stack_pointer_ = index_x_; return 0; }
-int Processor6502::transfer_y_to_accumulator() { accumulator_ = index_y_; set_flag(Zero, accumulator_ == 0); set_flag(Negative, accumulator_ & 0x80); return 0; }
+int Processor6502::store_accumulator() { write_memory(regs_.absolute_address_, regs_.accumulator_); return 0; }
+int Processor6502::store_x_register() { write_memory(regs_.absolute_address_, regs_.index_x_); return 0; }
+int Processor6502::store_y_register() { write_memory(regs_.absolute_address_, regs_.index_y_); return 0; }
+int Processor6502::transfer_accumulator_to_x() { regs_.index_x_ = regs_.accumulator_; set_flag(Zero, regs_.index_x_ == 0); set_flag(Negative, regs_.index_x_ & 0x80); return 0; }
+int Processor6502::transfer_accumulator_to_y() { regs_.index_y_ = regs_.accumulator_; set_flag(Zero, regs_.index_y_ == 0); set_flag(Negative, regs_.index_y_ & 0x80); return 0; }
+int Processor6502::transfer_stack_pointer_to_x() { regs_.index_x_ = regs_.stack_pointer_; set_flag(Zero, regs_.index_x_ == 0); set_flag(Negative, regs_.index_x_ & 0x80); return 0; }
+int Processor6502::transfer_x_to_accumulator() { regs_.accumulator_ = regs_.index_x_; set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 0; }
+int Processor6502::transfer_x_to_stack_pointer() { regs_.stack_pointer_ = regs_.index_x_; return 0; }
+int Processor6502::transfer_y_to_accumulator() { regs_.accumulator_ = regs_.index_y_; set_flag(Zero, regs_.accumulator_ == 0); set_flag(Negative, regs_.accumulator_ & 0x80); return 0; }
 
 // Build the opcode lookup table.
 // For brevity and clarity we initialize the table with the standard official opcodes.
@@ -466,37 +468,90 @@ static const std::array<Processor6502::Instruction, 256> create_instruction_tabl
 
 // STEP: execute one instruction
 int Processor6502::step() {
-    if (cycle_count_ > 0) {
-        cycle_count_--;
-        return cycle_count_;
+    if (regs_.cycle_count_ > 0) {
+        regs_.cycle_count_--;
+        return regs_.cycle_count_;
     }
 
-    current_instruction_ = read_memory(program_counter_);
-    program_counter_++;
-    const Instruction& instr = instruction_table_[current_instruction_];
-    cycle_count_ = instr.cycles;
+    regs_.current_instruction_ = read_memory(regs_.program_counter_);
+    regs_.program_counter_++;
+    const Instruction& instr = instruction_table_[regs_.current_instruction_];
+    regs_.cycle_count_ = instr.cycles;
     int additional_cycle1 = (this->*instr.addressing)();
     int additional_cycle2 = (this->*instr.operation)();
-    cycle_count_ += (additional_cycle1 & additional_cycle2);
-    return cycle_count_;
+    regs_.cycle_count_ += (additional_cycle1 & additional_cycle2);
+    return regs_.cycle_count_;
+}
+
+// Batch entry used by the scheduler: pending interrupt/reset cycles are charged to this instruction
+int Processor6502::execute_instruction() {
+    if (regs_.irq_armed_ && !(regs_.status_flags_ & InterruptDisable)) poll_irq();
+    int cycles = regs_.cycle_count_;
+#if NES_ENABLE_PROFILER
+    const uint16_t pc = regs_.program_counter_;
+#endif
+    regs_.current_instruction_ = read_memory(regs_.program_counter_);
+    regs_.program_counter_++;
+    const Instruction& instr = instruction_table_[regs_.current_instruction_];
+    regs_.cycle_count_ = instr.cycles;
+    int additional_cycle1 = (this->*instr.addressing)();
+    int additional_cycle2 = (this->*instr.operation)();
+    cycles += regs_.cycle_count_ + (additional_cycle1 & additional_cycle2);
+    regs_.cycle_count_ = 0;
+#if NES_ENABLE_PROFILER
+    if (profiler_) profiler_->count_instruction(pc, regs_.current_instruction_, cycles, regs_.program_counter_);
+#endif
+    return cycles;
 }
 
 std::string Processor6502::state() const {
     std::ostringstream o;
-    o << "PC=" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << program_counter_
-      << " A=" << std::setw(2) << static_cast<int>(accumulator_)
-      << " X=" << std::setw(2) << static_cast<int>(index_x_)
-      << " Y=" << std::setw(2) << static_cast<int>(index_y_)
-      << " SP=" << std::setw(2) << static_cast<int>(stack_pointer_)
-      << " P=" << std::setw(2) << static_cast<int>(status_flags_);
+    o << "PC=" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << regs_.program_counter_
+      << " A=" << std::setw(2) << static_cast<int>(regs_.accumulator_)
+      << " X=" << std::setw(2) << static_cast<int>(regs_.index_x_)
+      << " Y=" << std::setw(2) << static_cast<int>(regs_.index_y_)
+      << " SP=" << std::setw(2) << static_cast<int>(regs_.stack_pointer_)
+      << " P=" << std::setw(2) << static_cast<int>(regs_.status_flags_);
     return o.str();
 }
 
-void CPU6502::trigger_nmi() {
-    push(static_cast<uint8_t>((pc_ >> 8) & 0x00FF));
-    push(static_cast<uint8_t>(pc_ & 0x00FF));
-    push(status_ | B | U);
-    SetFlag(I, true);
-    pc_ = static_cast<uint16_t>(read(0xFFFA) | (read(0xFFFB) << 8));
-    cycles_ += 7;
-}
\ No newline at end of file
+void Processor6502::trigger_nmi() {
+    push_stack(static_cast<uint8_t>((regs_.program_counter_ >> 8) & 0x00FF));
+    push_stack(static_cast<uint8_t>(regs_.program_counter_ & 0x00FF));
+    push_stack((regs_.status_flags_ & ~Break) | Unused);
+    set_flag(InterruptDisable, true);
+    regs_.program_counter_ = static_cast<uint16_t>(read_memory(0xFFFA) | (read_memory(0xFFFB) << 8));
+    regs_.cycle_count_ += 7;
+#if NES_ENABLE_PROFILER
+    if (profiler_) profiler_->count_interrupt(regs_.program_counter_);
+#endif
+}
+
+void Processor6502::trigger_irq() {
+    if (check_flag(InterruptDisable)) return;
+    push_stack(static_cast<uint8_t>((regs_.program_counter_ >> 8) & 0x00FF));
+    push_stack(static_cast<uint8_t>(regs_.program_counter_ & 0x00FF));
+    push_stack((regs_.status_flags_ & ~Break) | Unused);
+    set_flag(InterruptDisable, true);
+    regs_.program_counter_ = static_cast<uint16_t>(read_memory(0xFFFE) | (read_memory(0xFFFF) << 8));
+    regs_.cycle_count_ += 7;
+#if NES_ENABLE_PROFILER
+    if (profiler_) profiler_->count_interrupt(regs_.program_counter_);
+#endif
+}
+
+void Processor6502::poll_irq() {
+    if (memory_->irq_asserted()) trigger_irq();
+    else regs_.irq_armed_ = false; // acknowledged while masked
+}
+
+void Processor6502::call_subroutine(uint16_t address, uint8_t a, uint8_t x) {
+    uint16_t ret = host_return_address - 1; // RTS adds one
+    push_stack(static_cast<uint8_t>((ret >> 8) & 0x00FF));
+    push_stack(static_cast<uint8_t>(ret & 0x00FF));
+    regs_.accumulator_ = a;
+    regs_.index_x_ = x;
+    regs_.index_y_ = 0;
+    regs_.program_counter_ = address;
+    regs_.cycle_count_ = 0;
+}
@@ -0,0 +1,155 @@
+#include "nes/profiler.h"
+#include "nes/rom_builder.h"
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <string>
+
+using namespace nes;
+
+namespace {
+const char* mode_names[] = { "implied", "accumulator", "immediate", "zeropage", "zeropage,x", "zeropage,y", "absolute",
+                             "absolute,x", "absolute,y", "indirect", "(indirect,x)", "(indirect),y", "relative" };
+
+const char* io_name(size_t reg) {
+    static const char* ppu[8] = { "PPUCTRL", "PPUMASK", "PPUSTATUS", "OAMADDR", "OAMDATA", "PPUSCROLL", "PPUADDR", "PPUDATA" };
+    if (reg < 8) return ppu[reg];
+    switch (reg - 8) {
+        case 0x14: return "OAMDMA";
+        case 0x15: return "SND_CHN";
+        case 0x16: return "JOY1";
+        case 0x17: return "JOY2/FRAME";
+        default: return "APU";
+    }
+}
+
+std::string hex4(uint64_t value) {
+    char text[8];
+    std::snprintf(text, sizeof(text), "$%04X", static_cast<unsigned>(value & 0xFFFF));
+    return text;
+}
+
+double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+// Indices of the `top` largest nonzero values, largest first
+template <typename Container>
+std::vector<size_t> top_indices(const Container& values, size_t top) {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < values.size(); ++i) if (values[i]) order.push_back(i);
+    size_t keep = std::min(top, order.size());
+    std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(keep), order.end(),
+                      [&](size_t a, size_t b) { return values[a] > values[b]; });
+    order.resize(keep);
+    return order;
+}
+}
+
+Profiler::Profiler()
+    : pc_counts_(0x10000), pc_cycles_(0x10000), loop_counts_(0x10000), loop_ends_(0x10000), call_counts_(0x10000), call_cycles_(0x10000) {}
+
+void Profiler::reset() {
+    for (auto* v : { &pc_counts_, &pc_cycles_, &loop_counts_, &call_counts_, &call_cycles_ }) std::fill(v->begin(), v->end(), 0);
+    std::fill(loop_ends_.begin(), loop_ends_.end(), 0);
+    opcode_counts_.fill(0);
+    opcode_cycles_.fill(0);
+    io_reads_.fill(0);
+    io_writes_.fill(0);
+    call_edges_.clear();
+    depth_ = 0;
+    total_cycles_ = 0;
+}
+
+void Profiler::enter(uint16_t entry, bool interrupt) {
+    uint64_t caller = interrupt ? interrupted : (depth_ == 0 ? top_level : stack_[std::min(depth_, max_depth) - 1].entry);
+    call_counts_[entry]++;
+    call_edges_[caller << 16 | entry]++;
+    if (depth_ < max_depth) stack_[depth_] = Frame{ entry, total_cycles_ };
+    depth_++;
+}
+
+void Profiler::leave() noexcept {
+    if (depth_ == 0) return; // returning past where profiling started
+    depth_--;
+    if (depth_ < max_depth) call_cycles_[stack_[depth_].entry] += total_cycles_ - stack_[depth_].start_cycles;
+}
+
+uint64_t Profiler::instructions() const noexcept {
+    return std::accumulate(opcode_counts_.begin(), opcode_counts_.end(), uint64_t(0));
+}
+
+void Profiler::report(std::ostream& out, size_t top) const {
+    char line[160];
+    const uint64_t total = total_cycles_;
+    out << "Instructions: " << instructions() << ", cycles: " << total << "\n";
+
+    out << "\nHot PCs (by cycles)\n";
+    for (size_t pc : top_indices(pc_cycles_, top)) {
+        std::snprintf(line, sizeof(line), "  %s  %12llu runs  %14llu cycles  %5.1f%%\n", hex4(pc).c_str(),
+                      static_cast<unsigned long long>(pc_counts_[pc]), static_cast<unsigned long long>(pc_cycles_[pc]), percent(pc_cycles_[pc], total));
+        out << line;
+    }
+
+    out << "\nOpcodes (by cycles)\n";
+    std::array<uint64_t, 13> mode_counts{}, mode_cycles{};
+    for (size_t op = 0; op < 256; ++op) {
+        const char* mnemonic = nullptr;
+        AddrMode mode = AddrMode::Implied;
+        if (!opcode_counts_[op] || !decode_opcode(static_cast<uint8_t>(op), mnemonic, mode)) continue;
+        mode_counts[static_cast<size_t>(mode)] += opcode_counts_[op];
+        mode_cycles[static_cast<size_t>(mode)] += opcode_cycles_[op];
+    }
+    for (size_t op : top_indices(opcode_cycles_, top)) {
+        const char* mnemonic = "???";
+        AddrMode mode = AddrMode::Implied;
+        decode_opcode(static_cast<uint8_t>(op), mnemonic, mode);
+        std::snprintf(line, sizeof(line), "  $%02X %s %-13s %12llu runs  %14llu cycles  %5.1f%%\n", static_cast<unsigned>(op), mnemonic,
+                      mode_names[static_cast<size_t>(mode)], static_cast<unsigned long long>(opcode_counts_[op]),
+                      static_cast<unsigned long long>(opcode_cycles_[op]), percent(opcode_cycles_[op], total));
+        out << line;
+    }
+
+    out << "\nAddressing modes\n";
+    for (size_t mode : top_indices(mode_cycles, mode_cycles.size())) {
+        std::snprintf(line, sizeof(line), "  %-13s %12llu runs  %14llu cycles  %5.1f%%\n", mode_names[mode],
+                      static_cast<unsigned long long>(mode_counts[mode]), static_cast<unsigned long long>(mode_cycles[mode]), percent(mode_cycles[mode], total));
+        out << line;
+    }
+
+    // A loop is a backward branch/JMP target; its body runs from there to the furthest jump back
+    out << "\nHot loops (by body cycles)\n";
+    std::vector<uint64_t> loop_cycles(loop_counts_.size());
+    for (size_t start = 0; start < loop_counts_.size(); ++start) {
+        if (!loop_counts_[start]) continue;
+        for (size_t pc = start; pc <= loop_ends_[start]; ++pc) loop_cycles[start] += pc_cycles_[pc];
+    }
+    for (size_t start : top_indices(loop_cycles, top)) {
+        std::snprintf(line, sizeof(line), "  %s-%s  %12llu iterations  %14llu cycles  %5.1f%%\n", hex4(start).c_str(), hex4(loop_ends_[start]).c_str(),
+                      static_cast<unsigned long long>(loop_counts_[start]), static_cast<unsigned long long>(loop_cycles[start]), percent(loop_cycles[start], total));
+        out << line;
+    }
+
+    out << "\nHot subroutines (inclusive cycles)\n";
+    for (size_t entry : top_indices(call_cycles_, top)) {
+        std::snprintf(line, sizeof(line), "  %s  %12llu calls  %14llu cycles  %5.1f%%  %8.1f per call\n", hex4(entry).c_str(),
+                      static_cast<unsigned long long>(call_counts_[entry]), static_cast<unsigned long long>(call_cycles_[entry]),
+                      percent(call_cycles_[entry], total), static_cast<double>(call_cycles_[entry]) / static_cast<double>(call_counts_[entry]));
+        out << line;
+        for (const auto& edge : call_edges_) {
+            if ((edge.first & 0xFFFF) != entry) continue;
+            uint64_t caller = edge.first >> 16;
+            std::string name = caller == top_level ? "top level" : caller == interrupted ? "interrupt" : hex4(caller);
+            out << "      from " << name << ": " << edge.second << "\n";
+        }
+    }
+
+    out << "\nI/O registers\n";
+    for (size_t reg = 0; reg < io_reads_.size(); ++reg) {
+        if (!io_reads_[reg] && !io_writes_[reg]) continue;
+        uint64_t address = reg < 8 ? 0x2000 + reg : 0x4000 + (reg - 8);
+        std::snprintf(line, sizeof(line), "  %s %-10s %12llu reads  %12llu writes\n", hex4(address).c_str(), io_name(reg),
+                      static_cast<unsigned long long>(io_reads_[reg]), static_cast<unsigned long long>(io_writes_[reg]));
+        out << line;
+    }
+}
@@ -0,0 +1,114 @@
+#include "nes/regression.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace nes;
+
+namespace {
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+const char hash_log_magic[4] = { 'N', 'H', 'S', 'H' };
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+inline uint64_t read64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, 8); return v; } // little-endian hosts only
+inline uint32_t read32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * prime2;
+    return rotl(acc, 31) * prime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t lane) {
+    acc ^= round(0, lane);
+    return acc * prime1 + prime4;
+}
+}
+
+uint64_t nes::xxh64(const void* data, size_t size, uint64_t seed) noexcept {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v1 = seed + prime1 + prime2, v2 = seed + prime2, v3 = seed, v4 = seed - prime1;
+        for (const uint8_t* limit = end - 32; p <= limit; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + prime5;
+    }
+    h += static_cast<uint64_t>(size);
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ round(0, read64(p)), 27) * prime1 + prime4;
+    if (p + 4 <= end) { h = rotl(h ^ (static_cast<uint64_t>(read32(p)) * prime1), 23) * prime2 + prime3; p += 4; }
+    for (; p < end; ++p) h = rotl(h ^ (*p * prime5), 11) * prime1;
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+void HashLog::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Failed to create hash log: " + path);
+    const uint16_t header_version = version, reserved = 0;
+    const uint32_t count = static_cast<uint32_t>(frames.size());
+    out.write(hash_log_magic, 4);
+    out.write(reinterpret_cast<const char*>(&header_version), 2);
+    out.write(reinterpret_cast<const char*>(&reserved), 2);
+    out.write(reinterpret_cast<const char*>(&count), 4);
+    static_assert(sizeof(FrameHashes) == 16, "hash log records are written as-is");
+    out.write(reinterpret_cast<const char*>(frames.data()), static_cast<std::streamsize>(frames.size() * sizeof(FrameHashes)));
+    if (!out) throw std::runtime_error("Failed to write hash log: " + path);
+}
+
+HashLog HashLog::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open hash log: " + path);
+    char magic[4];
+    uint16_t file_version = 0, reserved = 0;
+    uint32_t count = 0;
+    if (!in.read(magic, 4) || std::memcmp(magic, hash_log_magic, 4) != 0) throw std::runtime_error("Invalid hash log format: " + path);
+    in.read(reinterpret_cast<char*>(&file_version), 2);
+    in.read(reinterpret_cast<char*>(&reserved), 2);
+    in.read(reinterpret_cast<char*>(&count), 4);
+    if (!in || file_version != version) throw std::runtime_error("Unsupported hash log version: " + path);
+    // The count comes from the file: check it against what is there before allocating for it
+    const std::streampos body = in.tellg();
+    in.seekg(0, std::ios::end);
+    const uint64_t available = static_cast<uint64_t>(in.tellg() - body);
+    in.seekg(body);
+    if (count > available / sizeof(FrameHashes)) throw std::runtime_error("Truncated hash log: " + path);
+    HashLog log;
+    log.frames.resize(count);
+    if (!in.read(reinterpret_cast<char*>(log.frames.data()), static_cast<std::streamsize>(uint64_t{count} * sizeof(FrameHashes)))) {
+        throw std::runtime_error("Truncated hash log: " + path);
+    }
+    return log;
+}
+
+int64_t nes::first_divergence(const HashLog& actual, const HashLog& golden) noexcept {
+    const size_t common = std::min(actual.frames.size(), golden.frames.size());
+    auto mismatch = std::mismatch(actual.frames.begin(), actual.frames.begin() + static_cast<std::ptrdiff_t>(common), golden.frames.begin());
+    if (mismatch.first != actual.frames.begin() + static_cast<std::ptrdiff_t>(common)) return mismatch.first - actual.frames.begin();
+    return actual.frames.size() == golden.frames.size() ? -1 : static_cast<int64_t>(common);
+}
+
+void nes::save_ppm(const std::string& path, const std::vector<uint8_t>& rgb, int width, int height) {
+    if (rgb.size() != static_cast<size_t>(width) * static_cast<size_t>(height) * 3) throw std::invalid_argument("PPM size does not match the image");
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Failed to create image: " + path);
+    out << "P6\n" << width << " " << height << "\n255\n";
+    out.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+    if (!out) throw std::runtime_error("Failed to write image: " + path);
+}
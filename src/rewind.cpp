@@ -0,0 +1,135 @@
+#include "nes/rewind.h"
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace nes;
+
+static void put_varint(std::vector<uint8_t>& out, size_t& pos, size_t value) {
+    while (value >= 0x80) { out[pos++] = static_cast<uint8_t>(value | 0x80); value >>= 7; }
+    out[pos++] = static_cast<uint8_t>(value);
+}
+
+static size_t get_varint(const uint8_t*& in) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *in++;
+        value |= static_cast<size_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return value;
+    }
+}
+
+// Encodes a ^ b (b may be null for a keyframe) as (zero run, literal count, literals) tokens
+static size_t encode_xor(const uint8_t* a, const uint8_t* b, size_t size, std::vector<uint8_t>& out) {
+    size_t pos = 0, i = 0;
+    while (i < size) {
+        size_t zeros_start = i;
+        // Skip unchanged bytes a word at a time where possible
+        while (i + 8 <= size) {
+            uint64_t x, y = 0;
+            std::memcpy(&x, a + i, 8);
+            if (b) std::memcpy(&y, b + i, 8);
+            if (x != y) break;
+            i += 8;
+        }
+        while (i < size && a[i] == (b ? b[i] : 0)) i++;
+        size_t literal_start = i;
+        // A literal run ends at the first pair of unchanged bytes
+        while (i < size && (a[i] != (b ? b[i] : 0) || (i + 1 < size && a[i + 1] != (b ? b[i + 1] : 0)))) i++;
+        put_varint(out, pos, literal_start - zeros_start);
+        put_varint(out, pos, i - literal_start);
+        for (size_t j = literal_start; j < i; ++j) out[pos++] = static_cast<uint8_t>(a[j] ^ (b ? b[j] : 0));
+    }
+    return pos;
+}
+
+RewindBuffer::RewindBuffer(const RewindConfig& config)
+    : config_(config), arena_(config.memory_budget), head_(0), used_(0), since_keyframe_(0) {
+    if (config_.keyframe_interval == 0) throw std::invalid_argument("keyframe interval must be at least 1");
+}
+
+void RewindBuffer::clear() noexcept {
+    entries_.clear();
+    head_ = used_ = 0;
+    since_keyframe_ = 0;
+}
+
+void RewindBuffer::push(const Emulator& emu) {
+    size_t size = emu.state_size();
+    if (size == 0) return;
+    if (current_.size() != size) {
+        // A different ROM or component shape: old history can't be diffed against
+        clear();
+        current_.assign(size, 0);
+        scratch_.assign(size, 0);
+        encoded_.assign(size * 2 + 32, 0);
+    }
+    emu.save_state(scratch_.data(), scratch_.size());
+    bool keyframe = entries_.empty() || since_keyframe_ >= config_.keyframe_interval;
+    size_t length = encode_xor(scratch_.data(), keyframe ? nullptr : current_.data(), size, encoded_);
+    current_.swap(scratch_);
+    if (length > arena_.size()) { clear(); return; } // budget below one snapshot: keep no history
+    size_t offset = reserve(length);
+    if (!keyframe && entries_.empty()) {
+        // Eviction reached the segment this delta belongs to; start a fresh one
+        keyframe = true;
+        length = encode_xor(current_.data(), nullptr, size, encoded_);
+        if (length > arena_.size()) { clear(); return; }
+        offset = reserve(length);
+    }
+    std::memcpy(arena_.data() + offset, encoded_.data(), length);
+    entries_.push_back({ offset, static_cast<uint32_t>(length), keyframe });
+    head_ = offset + length;
+    used_ += length;
+    since_keyframe_ = keyframe ? 1 : since_keyframe_ + 1;
+}
+
+// Finds ring space for length bytes at head_, evicting the oldest segments it would overwrite.
+// Live entries from the previous lap always sit at or after head_.
+size_t RewindBuffer::reserve(size_t length) noexcept {
+    if (head_ + length > arena_.size()) {
+        while (!entries_.empty() && entries_.front().offset >= head_) drop_oldest_segment();
+        head_ = 0;
+    }
+    while (!entries_.empty() && entries_.front().offset >= head_ && entries_.front().offset < head_ + length) drop_oldest_segment();
+    return head_;
+}
+
+void RewindBuffer::drop_oldest_segment() noexcept {
+    do {
+        used_ -= entries_.front().size;
+        entries_.pop_front();
+    } while (!entries_.empty() && !entries_.front().keyframe);
+    if (entries_.empty()) since_keyframe_ = 0;
+}
+
+void RewindBuffer::decode_into(const Entry& entry, std::vector<uint8_t>& target) const {
+    const uint8_t* in = arena_.data() + entry.offset;
+    const uint8_t* end = in + entry.size;
+    size_t pos = 0;
+    while (in < end) {
+        pos += get_varint(in);
+        size_t count = get_varint(in);
+        for (size_t j = 0; j < count; ++j) target[pos++] ^= *in++;
+    }
+}
+
+bool RewindBuffer::step_back(Emulator& emu) {
+    if (entries_.size() < 2) return false;
+    Entry last = entries_.back();
+    entries_.pop_back();
+    used_ -= last.size;
+    head_ = last.offset; // it was the most recent allocation
+    if (!last.keyframe) {
+        decode_into(last, current_);
+        since_keyframe_--;
+    } else {
+        // Crossing a keyframe: restore the previous one and replay its segment's deltas
+        size_t k = entries_.size() - 1;
+        while (!entries_[k].keyframe) --k;
+        std::fill(current_.begin(), current_.end(), 0);
+        for (size_t i = k; i < entries_.size(); ++i) decode_into(entries_[i], current_);
+        since_keyframe_ = static_cast<uint32_t>(entries_.size() - k);
+    }
+    return emu.load_state(current_.data(), current_.size());
+}
@@ -11,6 +11,7 @@ RomLoader::RomLoader(const std::vector<uint8_t>& data) {
     header_.control_flags = data[6];
     header_.mapper_id = (data[7] & 0xF0) | (data[6] >> 4);
     header_.mirror_type = (data[6] & 0x01);
+    header_.four_screen = (data[6] & 0x08) != 0;
     size_t offset = 16;
     if (header_.control_flags & 0x04) offset += 512;
     size_t prog_size = static_cast<size_t>(header_.program_banks) * 16 * 1024;
@@ -0,0 +1,200 @@
+#include "nes/rom_builder.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace nes;
+
+namespace {
+struct Opcode {
+    const char* mnemonic;
+    AddrMode mode;
+    uint8_t code;
+};
+
+using M = AddrMode;
+
+// Official 6502 opcodes
+const Opcode opcodes[] = {
+    { "ADC", M::Immediate, 0x69 }, { "ADC", M::ZeroPage, 0x65 }, { "ADC", M::ZeroPageX, 0x75 }, { "ADC", M::Absolute, 0x6D },
+    { "ADC", M::AbsoluteX, 0x7D }, { "ADC", M::AbsoluteY, 0x79 }, { "ADC", M::IndirectX, 0x61 }, { "ADC", M::IndirectY, 0x71 },
+    { "AND", M::Immediate, 0x29 }, { "AND", M::ZeroPage, 0x25 }, { "AND", M::ZeroPageX, 0x35 }, { "AND", M::Absolute, 0x2D },
+    { "AND", M::AbsoluteX, 0x3D }, { "AND", M::AbsoluteY, 0x39 }, { "AND", M::IndirectX, 0x21 }, { "AND", M::IndirectY, 0x31 },
+    { "ASL", M::Accumulator, 0x0A }, { "ASL", M::ZeroPage, 0x06 }, { "ASL", M::ZeroPageX, 0x16 }, { "ASL", M::Absolute, 0x0E },
+    { "ASL", M::AbsoluteX, 0x1E },
+    { "BCC", M::Relative, 0x90 }, { "BCS", M::Relative, 0xB0 }, { "BEQ", M::Relative, 0xF0 }, { "BMI", M::Relative, 0x30 },
+    { "BNE", M::Relative, 0xD0 }, { "BPL", M::Relative, 0x10 }, { "BVC", M::Relative, 0x50 }, { "BVS", M::Relative, 0x70 },
+    { "BIT", M::ZeroPage, 0x24 }, { "BIT", M::Absolute, 0x2C }, { "BRK", M::Implied, 0x00 },
+    { "CLC", M::Implied, 0x18 }, { "CLD", M::Implied, 0xD8 }, { "CLI", M::Implied, 0x58 }, { "CLV", M::Implied, 0xB8 },
+    { "CMP", M::Immediate, 0xC9 }, { "CMP", M::ZeroPage, 0xC5 }, { "CMP", M::ZeroPageX, 0xD5 }, { "CMP", M::Absolute, 0xCD },
+    { "CMP", M::AbsoluteX, 0xDD }, { "CMP", M::AbsoluteY, 0xD9 }, { "CMP", M::IndirectX, 0xC1 }, { "CMP", M::IndirectY, 0xD1 },
+    { "CPX", M::Immediate, 0xE0 }, { "CPX", M::ZeroPage, 0xE4 }, { "CPX", M::Absolute, 0xEC },
+    { "CPY", M::Immediate, 0xC0 }, { "CPY", M::ZeroPage, 0xC4 }, { "CPY", M::Absolute, 0xCC },
+    { "DEC", M::ZeroPage, 0xC6 }, { "DEC", M::ZeroPageX, 0xD6 }, { "DEC", M::Absolute, 0xCE }, { "DEC", M::AbsoluteX, 0xDE },
+    { "DEX", M::Implied, 0xCA }, { "DEY", M::Implied, 0x88 },
+    { "EOR", M::Immediate, 0x49 }, { "EOR", M::ZeroPage, 0x45 }, { "EOR", M::ZeroPageX, 0x55 }, { "EOR", M::Absolute, 0x4D },
+    { "EOR", M::AbsoluteX, 0x5D }, { "EOR", M::AbsoluteY, 0x59 }, { "EOR", M::IndirectX, 0x41 }, { "EOR", M::IndirectY, 0x51 },
+    { "INC", M::ZeroPage, 0xE6 }, { "INC", M::ZeroPageX, 0xF6 }, { "INC", M::Absolute, 0xEE }, { "INC", M::AbsoluteX, 0xFE },
+    { "INX", M::Implied, 0xE8 }, { "INY", M::Implied, 0xC8 },
+    { "JMP", M::Absolute, 0x4C }, { "JMP", M::Indirect, 0x6C }, { "JSR", M::Absolute, 0x20 },
+    { "LDA", M::Immediate, 0xA9 }, { "LDA", M::ZeroPage, 0xA5 }, { "LDA", M::ZeroPageX, 0xB5 }, { "LDA", M::Absolute, 0xAD },
+    { "LDA", M::AbsoluteX, 0xBD }, { "LDA", M::AbsoluteY, 0xB9 }, { "LDA", M::IndirectX, 0xA1 }, { "LDA", M::IndirectY, 0xB1 },
+    { "LDX", M::Immediate, 0xA2 }, { "LDX", M::ZeroPage, 0xA6 }, { "LDX", M::ZeroPageY, 0xB6 }, { "LDX", M::Absolute, 0xAE },
+    { "LDX", M::AbsoluteY, 0xBE },
+    { "LDY", M::Immediate, 0xA0 }, { "LDY", M::ZeroPage, 0xA4 }, { "LDY", M::ZeroPageX, 0xB4 }, { "LDY", M::Absolute, 0xAC },
+    { "LDY", M::AbsoluteX, 0xBC },
+    { "LSR", M::Accumulator, 0x4A }, { "LSR", M::ZeroPage, 0x46 }, { "LSR", M::ZeroPageX, 0x56 }, { "LSR", M::Absolute, 0x4E },
+    { "LSR", M::AbsoluteX, 0x5E },
+    { "NOP", M::Implied, 0xEA },
+    { "ORA", M::Immediate, 0x09 }, { "ORA", M::ZeroPage, 0x05 }, { "ORA", M::ZeroPageX, 0x15 }, { "ORA", M::Absolute, 0x0D },
+    { "ORA", M::AbsoluteX, 0x1D }, { "ORA", M::AbsoluteY, 0x19 }, { "ORA", M::IndirectX, 0x01 }, { "ORA", M::IndirectY, 0x11 },
+    { "PHA", M::Implied, 0x48 }, { "PHP", M::Implied, 0x08 }, { "PLA", M::Implied, 0x68 }, { "PLP", M::Implied, 0x28 },
+    { "ROL", M::Accumulator, 0x2A }, { "ROL", M::ZeroPage, 0x26 }, { "ROL", M::ZeroPageX, 0x36 }, { "ROL", M::Absolute, 0x2E },
+    { "ROL", M::AbsoluteX, 0x3E },
+    { "ROR", M::Accumulator, 0x6A }, { "ROR", M::ZeroPage, 0x66 }, { "ROR", M::ZeroPageX, 0x76 }, { "ROR", M::Absolute, 0x6E },
+    { "ROR", M::AbsoluteX, 0x7E },
+    { "RTI", M::Implied, 0x40 }, { "RTS", M::Implied, 0x60 },
+    { "SBC", M::Immediate, 0xE9 }, { "SBC", M::ZeroPage, 0xE5 }, { "SBC", M::ZeroPageX, 0xF5 }, { "SBC", M::Absolute, 0xED },
+    { "SBC", M::AbsoluteX, 0xFD }, { "SBC", M::AbsoluteY, 0xF9 }, { "SBC", M::IndirectX, 0xE1 }, { "SBC", M::IndirectY, 0xF1 },
+    { "SEC", M::Implied, 0x38 }, { "SED", M::Implied, 0xF8 }, { "SEI", M::Implied, 0x78 },
+    { "STA", M::ZeroPage, 0x85 }, { "STA", M::ZeroPageX, 0x95 }, { "STA", M::Absolute, 0x8D }, { "STA", M::AbsoluteX, 0x9D },
+    { "STA", M::AbsoluteY, 0x99 }, { "STA", M::IndirectX, 0x81 }, { "STA", M::IndirectY, 0x91 },
+    { "STX", M::ZeroPage, 0x86 }, { "STX", M::ZeroPageY, 0x96 }, { "STX", M::Absolute, 0x8E },
+    { "STY", M::ZeroPage, 0x84 }, { "STY", M::ZeroPageX, 0x94 }, { "STY", M::Absolute, 0x8C },
+    { "TAX", M::Implied, 0xAA }, { "TAY", M::Implied, 0xA8 }, { "TSX", M::Implied, 0xBA }, { "TXA", M::Implied, 0x8A },
+    { "TXS", M::Implied, 0x9A }, { "TYA", M::Implied, 0x98 },
+};
+}
+
+int nes::operand_size(AddrMode mode) noexcept {
+    switch (mode) {
+        case M::Implied: case M::Accumulator: return 0;
+        case M::Absolute: case M::AbsoluteX: case M::AbsoluteY: case M::Indirect: return 2;
+        default: return 1;
+    }
+}
+
+bool nes::decode_opcode(uint8_t code, const char*& mnemonic, AddrMode& mode) noexcept {
+    for (const Opcode& entry : opcodes) {
+        if (entry.code == code) { mnemonic = entry.mnemonic; mode = entry.mode; return true; }
+    }
+    return false;
+}
+
+size_t Assembler::emit_opcode(const std::string& mnemonic, AddrMode mode) {
+    for (const Opcode& entry : opcodes) {
+        if (entry.mode == mode && mnemonic == entry.mnemonic) {
+            code_.push_back(entry.code);
+            return code_.size();
+        }
+    }
+    throw std::invalid_argument("No such instruction: " + mnemonic);
+}
+
+Assembler& Assembler::op(const std::string& mnemonic, AddrMode mode, uint16_t operand) {
+    if (mode == M::Relative) {
+        emit_opcode(mnemonic, mode);
+        int delta = static_cast<int>(operand) - static_cast<int>(here() + 1);
+        if (delta < -128 || delta > 127) throw std::invalid_argument("Branch out of range: " + mnemonic);
+        code_.push_back(static_cast<uint8_t>(delta));
+        return *this;
+    }
+    const int size = operand_size(mode);
+    if (size == 1 && operand > 0xFF) throw std::invalid_argument("Operand does not fit in a byte: " + mnemonic);
+    emit_opcode(mnemonic, mode);
+    if (size >= 1) code_.push_back(static_cast<uint8_t>(operand & 0xFF));
+    if (size == 2) code_.push_back(static_cast<uint8_t>(operand >> 8));
+    return *this;
+}
+
+Assembler& Assembler::op(const std::string& mnemonic, AddrMode mode, const std::string& target) {
+    const int size = operand_size(mode);
+    if (mode != M::Relative && size != 2) throw std::invalid_argument("Label operand needs an absolute or relative mode: " + mnemonic);
+    size_t offset = emit_opcode(mnemonic, mode);
+    fixups_.push_back({ offset, target, mode == M::Relative });
+    code_.resize(code_.size() + static_cast<size_t>(size));
+    return *this;
+}
+
+Assembler& Assembler::label(const std::string& name) {
+    for (const Label& l : labels_) {
+        if (l.name == name) throw std::invalid_argument("Duplicate label: " + name);
+    }
+    labels_.push_back({ name, here() });
+    return *this;
+}
+
+Assembler& Assembler::byte(uint8_t value) {
+    code_.push_back(value);
+    return *this;
+}
+
+Assembler& Assembler::data(const std::vector<uint8_t>& bytes) {
+    code_.insert(code_.end(), bytes.begin(), bytes.end());
+    return *this;
+}
+
+uint16_t Assembler::address_of(const std::string& name) const {
+    for (const Label& l : labels_) {
+        if (l.name == name) return l.address;
+    }
+    throw std::runtime_error("Undefined label: " + name);
+}
+
+std::vector<uint8_t> Assembler::finish() const {
+    std::vector<uint8_t> code = code_;
+    for (const Fixup& fix : fixups_) {
+        uint16_t target = address_of(fix.target);
+        if (fix.relative) {
+            int delta = static_cast<int>(target) - static_cast<int>(origin_ + fix.offset + 1);
+            if (delta < -128 || delta > 127) throw std::runtime_error("Branch out of range: " + fix.target);
+            code[fix.offset] = static_cast<uint8_t>(delta);
+        } else {
+            code[fix.offset] = static_cast<uint8_t>(target & 0xFF);
+            code[fix.offset + 1] = static_cast<uint8_t>(target >> 8);
+        }
+    }
+    return code;
+}
+
+RomBuilder::RomBuilder(const RomSpec& spec)
+    : spec_(spec), prg_(static_cast<size_t>(spec.prg_banks) * 0x4000, 0), chr_(static_cast<size_t>(spec.chr_banks) * 0x2000, 0) {
+    if (spec.prg_banks == 0) throw std::invalid_argument("ROM needs at least one PRG bank");
+}
+
+RomBuilder& RomBuilder::place(uint16_t address, const std::vector<uint8_t>& bytes) {
+    if (address < 0x8000 || address + bytes.size() > 0x10000) throw std::invalid_argument("Code must fit in $8000-$FFFF");
+    size_t offset = prg_.size() == 0x4000 ? (address & 0x3FFF) : prg_.size() - 0x8000 + (address - 0x8000);
+    return place_prg(offset, bytes);
+}
+
+RomBuilder& RomBuilder::place_prg(size_t offset, const std::vector<uint8_t>& bytes) {
+    if (offset + bytes.size() > prg_.size()) throw std::invalid_argument("PRG placement out of range");
+    std::copy(bytes.begin(), bytes.end(), prg_.begin() + static_cast<std::ptrdiff_t>(offset));
+    return *this;
+}
+
+RomBuilder& RomBuilder::place_chr(size_t offset, const std::vector<uint8_t>& bytes) {
+    if (offset + bytes.size() > chr_.size()) throw std::invalid_argument("CHR placement out of range");
+    std::copy(bytes.begin(), bytes.end(), chr_.begin() + static_cast<std::ptrdiff_t>(offset));
+    return *this;
+}
+
+RomBuilder& RomBuilder::vectors(uint16_t nmi, uint16_t reset, uint16_t irq) {
+    const uint16_t words[3] = { nmi, reset, irq };
+    std::vector<uint8_t> table;
+    for (uint16_t w : words) { table.push_back(static_cast<uint8_t>(w & 0xFF)); table.push_back(static_cast<uint8_t>(w >> 8)); }
+    return place(0xFFFA, table);
+}
+
+std::vector<uint8_t> RomBuilder::build() const {
+    std::vector<uint8_t> image(16, 0);
+    std::memcpy(image.data(), "NES\x1A", 4);
+    image[4] = spec_.prg_banks;
+    image[5] = spec_.chr_banks;
+    image[6] = static_cast<uint8_t>((spec_.mapper & 0x0F) << 4 | (spec_.battery ? 0x02 : 0) | (spec_.vertical_mirroring ? 0x01 : 0));
+    image[7] = static_cast<uint8_t>(spec_.mapper & 0xF0);
+    image.insert(image.end(), prg_.begin(), prg_.end());
+    image.insert(image.end(), chr_.begin(), chr_.end());
+    return image;
+}
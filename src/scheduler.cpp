@@ -0,0 +1,80 @@
+#include "nes/scheduler.h"
+
+using namespace nes;
+
+void Scheduler::reset() noexcept {
+    size_ = 0;
+    now_ = 0;
+    slot_.fill(-1);
+}
+
+void Scheduler::place(size_t index, const Event& ev) noexcept {
+    heap_[index] = ev;
+    slot_[static_cast<size_t>(ev.type)] = static_cast<int8_t>(index);
+}
+
+void Scheduler::sift_up(size_t index) noexcept {
+    Event ev = heap_[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (heap_[parent].time <= ev.time) break;
+        place(index, heap_[parent]);
+        index = parent;
+    }
+    place(index, ev);
+}
+
+void Scheduler::sift_down(size_t index) noexcept {
+    Event ev = heap_[index];
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= size_) break;
+        if (child + 1 < size_ && heap_[child + 1].time < heap_[child].time) child++;
+        if (ev.time <= heap_[child].time) break;
+        place(index, heap_[child]);
+        index = child;
+    }
+    place(index, ev);
+}
+
+void Scheduler::remove_at(size_t index) noexcept {
+    slot_[static_cast<size_t>(heap_[index].type)] = -1;
+    if (index == --size_) return;
+    Event moved = heap_[size_];
+    place(index, moved);
+    sift_down(index);
+    sift_up(static_cast<size_t>(slot_[static_cast<size_t>(moved.type)]));
+}
+
+void Scheduler::schedule(EventType type, uint64_t time) noexcept {
+    int8_t existing = slot_[static_cast<size_t>(type)];
+    if (existing >= 0) remove_at(static_cast<size_t>(existing));
+    place(size_, { time, type });
+    sift_up(size_++);
+}
+
+void Scheduler::cancel(EventType type) noexcept {
+    int8_t existing = slot_[static_cast<size_t>(type)];
+    if (existing >= 0) remove_at(static_cast<size_t>(existing));
+}
+
+bool Scheduler::valid_state() const noexcept {
+    if (size_ > capacity_) return false;
+    for (size_t i = 0; i < size_; ++i) {
+        const size_t type = static_cast<size_t>(heap_[i].type);
+        if (type >= capacity_ || slot_[type] != static_cast<int8_t>(i)) return false;
+        if (i > 0 && heap_[(i - 1) / 2].time > heap_[i].time) return false;
+    }
+    for (size_t type = 0; type < capacity_; ++type) {
+        const int8_t index = slot_[type];
+        if (index != -1 && (index < 0 || index >= size_ || static_cast<size_t>(heap_[static_cast<size_t>(index)].type) != type)) return false;
+    }
+    return true;
+}
+
+bool Scheduler::pop_due(Event& out) noexcept {
+    if (size_ == 0 || heap_[0].time > now_) return false;
+    out = heap_[0];
+    remove_at(0);
+    return true;
+}
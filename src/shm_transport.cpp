@@ -0,0 +1,230 @@
+#include "nes/shm_transport.h"
+#include "nes/visual.h"
+#include "nes/trace_events.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+using namespace nes;
+
+namespace {
+const char shm_magic[8] = { 'N', 'E', 'S', 'S', 'H', 'M', 0, 0 };
+static_assert(sizeof(ShmLayout::Slot) <= ShmLayout::slot_header_bytes, "slot header overflows its cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be address-free");
+
+// Shared (not FUTEX_PRIVATE) operations: the word lives in memory mapped by several processes
+bool futex_wait(std::atomic<uint32_t>& word, uint32_t expected, int timeout_ms) {
+#ifdef __linux__
+    timespec timeout{ timeout_ms / 1000, static_cast<long>(timeout_ms % 1000) * 1000000 };
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0) == 0;
+#else
+    (void)word; (void)expected;
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms < 0 ? 1 : std::min(timeout_ms, 1)));
+    return true;
+#endif
+}
+
+void futex_wake_all(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+uint64_t steady_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint8_t* slot_base(uint8_t* base, const ShmLayout::Header& header, uint64_t index) {
+    return base + ShmLayout::header_bytes + (index % header.slot_count) * header.slot_stride;
+}
+}
+
+ShmPublisher::ShmPublisher(const ShmOptions& options) : name_(options.name) {
+    if (options.slots < 2) throw std::invalid_argument("Shared-memory ring needs at least two slots");
+    slot_seen_.assign(options.slots, 0);
+    const size_t stride = ShmLayout::stride(options.audio_capacity);
+    size_ = ShmLayout::header_bytes + stride * options.slots;
+    if (options.force) shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        throw std::runtime_error("Shared memory " + name_ + " already exists: another publisher, or left by a crashed run (ShmOptions::force replaces it)");
+    }
+    if (fd < 0) throw std::runtime_error("Failed to create shared memory " + name_);
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("Failed to size shared memory " + name_);
+    }
+    void* addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("Failed to map shared memory " + name_);
+    }
+    base_ = static_cast<uint8_t*>(addr);
+
+    auto* h = new (base_) ShmLayout::Header{};
+    h->version = ShmLayout::version;
+    h->slot_count = options.slots;
+    h->audio_capacity = options.audio_capacity;
+    h->sample_rate = options.sample_rate;
+    h->slot_stride = stride;
+    for (uint32_t i = 0; i < options.slots; ++i) new (slot_base(base_, *h, i)) ShmLayout::Slot{};
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(h->magic, shm_magic, sizeof(shm_magic)); // readers check this last-written field
+}
+
+ShmPublisher::~ShmPublisher() {
+    if (!base_) return;
+    header().closed.store(1, std::memory_order_release);
+    header().wake_word.fetch_add(1);
+    futex_wake_all(header().wake_word);
+    munmap(base_, size_);
+    shm_unlink(name_.c_str()); // attached readers keep their mapping until they close
+}
+
+uint64_t ShmPublisher::published() const noexcept {
+    return header().published.load(std::memory_order_relaxed);
+}
+
+ShmLayout::Slot& ShmPublisher::begin_slot(uint64_t index) noexcept {
+    auto& slot = *reinterpret_cast<ShmLayout::Slot*>(slot_base(base_, header(), index));
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // odd sequence is visible before any payload byte
+    return slot;
+}
+
+void ShmPublisher::finish_slot(ShmLayout::Slot& slot, uint64_t index, uint64_t frame_number, const int16_t* audio, size_t samples) noexcept {
+    ShmLayout::Header& h = header();
+    const size_t kept = std::min<size_t>(samples, h.audio_capacity);
+    auto* payload = reinterpret_cast<uint8_t*>(&slot) + ShmLayout::slot_header_bytes;
+    if (kept) std::memcpy(payload + ShmLayout::frame_bytes, audio, kept * sizeof(int16_t));
+    slot.frame_number = frame_number;
+    slot.timestamp_ns = steady_ns();
+    slot.audio_samples = static_cast<uint32_t>(kept);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    h.published.store(index + 1, std::memory_order_release);
+    h.wake_word.fetch_add(1);
+    if (h.waiters.load() > 0) futex_wake_all(h.wake_word);
+}
+
+void ShmPublisher::publish(const PPU& ppu, uint64_t frame_number, const int16_t* audio, size_t samples) noexcept {
+    TraceScope scope("shm_publish", TraceCategory::Output);
+    const uint64_t index = header().published.load(std::memory_order_relaxed);
+    ShmLayout::Slot& slot = begin_slot(index);
+    ppu.copy_frame(reinterpret_cast<uint8_t*>(&slot) + ShmLayout::slot_header_bytes, slot_seen_[index % slot_seen_.size()]);
+    finish_slot(slot, index, frame_number, audio, samples);
+}
+
+void ShmPublisher::publish(const uint8_t* rgb, uint64_t frame_number, const int16_t* audio, size_t samples) noexcept {
+    TraceScope scope("shm_publish", TraceCategory::Output);
+    const uint64_t index = header().published.load(std::memory_order_relaxed);
+    ShmLayout::Slot& slot = begin_slot(index);
+    std::memcpy(reinterpret_cast<uint8_t*>(&slot) + ShmLayout::slot_header_bytes, rgb, ShmLayout::frame_bytes);
+    slot_seen_[index % slot_seen_.size()] = 0; // no longer a PPU frame: the next PPU publish here copies it all
+    finish_slot(slot, index, frame_number, audio, samples);
+}
+
+ShmReader::ShmReader(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) throw std::runtime_error("No shared-memory publisher at " + name);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < ShmLayout::header_bytes) {
+        ::close(fd);
+        throw std::runtime_error("Shared memory not initialised yet: " + name);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) throw std::runtime_error("Failed to map shared memory " + name);
+    base_ = static_cast<uint8_t*>(addr);
+    const ShmLayout::Header& h = header();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (std::memcmp(h.magic, shm_magic, sizeof(shm_magic)) != 0 || h.version != ShmLayout::version || h.slot_count < 2 ||
+        h.slot_stride != ShmLayout::stride(h.audio_capacity) || size_ != ShmLayout::header_bytes + h.slot_stride * h.slot_count) {
+        munmap(base_, size_);
+        base_ = nullptr;
+        throw std::runtime_error("Incompatible shared-memory layout at " + name);
+    }
+    next_index_ = h.published.load(std::memory_order_acquire); // live: start with the next frame
+}
+
+ShmReader::~ShmReader() {
+    if (base_) munmap(base_, size_);
+}
+
+void ShmReader::skip_to_latest() noexcept {
+    const uint64_t published = header().published.load(std::memory_order_acquire);
+    if (published > next_index_) next_index_ = published - 1;
+}
+
+// Seqlock read: copy, then confirm the slot still holds the same completed frame
+bool ShmReader::try_read(uint64_t index, ShmFrame& frame) const {
+    const auto& slot = *reinterpret_cast<const ShmLayout::Slot*>(slot_base(base_, header(), index));
+    const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != 2 * index + 2) return false;
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(&slot) + ShmLayout::slot_header_bytes;
+    const uint32_t samples = std::min(slot.audio_samples, header().audio_capacity);
+    frame.rgb.assign(payload, payload + ShmLayout::frame_bytes);
+    frame.audio.resize(samples);
+    std::memcpy(frame.audio.data(), payload + ShmLayout::frame_bytes, samples * sizeof(int16_t));
+    frame.frame_number = slot.frame_number;
+    frame.timestamp_ns = slot.timestamp_ns;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+ShmReader::Result ShmReader::next(ShmFrame& frame, int timeout_ms) {
+    ShmLayout::Header& h = header();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    uint64_t missed = 0;
+    for (;;) {
+        const uint64_t published = h.published.load(std::memory_order_acquire);
+        if (next_index_ < published) {
+            // The slot after the newest may be mid-rewrite, so the oldest safe frame is one ring back plus one
+            if (published - next_index_ >= h.slot_count) {
+                const uint64_t oldest = published - h.slot_count + 1;
+                missed += oldest - next_index_;
+                next_index_ = oldest;
+            }
+            const uint64_t index = next_index_++;
+            if (try_read(index, frame)) {
+                frame.index = index;
+                frame.missed = missed;
+                return Result::Frame;
+            }
+            missed++; // overwritten while we copied it
+            continue;
+        }
+        if (h.closed.load(std::memory_order_acquire)) return Result::Closed;
+
+        int wait_ms = timeout_ms;
+        if (timeout_ms >= 0) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) return Result::Timeout;
+            wait_ms = static_cast<int>(left);
+        }
+        // Register before re-checking, so a publish in between either sees us or changes the word
+        h.waiters.fetch_add(1);
+        const uint32_t word = h.wake_word.load();
+        if (h.published.load() == next_index_ && !h.closed.load()) futex_wait(h.wake_word, word, wait_ms);
+        h.waiters.fetch_sub(1);
+    }
+}
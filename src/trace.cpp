@@ -0,0 +1,64 @@
+#include "nes/trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace nes;
+
+static constexpr char trace_magic[4] = { 'N', 'T', 'R', 'C' };
+static constexpr uint32_t trace_version = 1;
+
+TraceBuffer::TraceBuffer(size_t capacity) {
+    if (capacity == 0) throw std::invalid_argument("Trace buffer needs a capacity");
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    records_.resize(size);
+    mask_ = size - 1;
+}
+
+std::vector<TraceRecord> TraceBuffer::records() const {
+    std::vector<TraceRecord> out;
+    out.reserve(size());
+    for (uint64_t i = head_ - size(); i < head_; ++i) out.push_back(records_[i & mask_]);
+    return out;
+}
+
+void TraceBuffer::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Failed to create trace: " + path);
+    uint64_t count = size();
+    out.write(trace_magic, 4);
+    out.write(reinterpret_cast<const char*>(&trace_version), sizeof(trace_version));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    // At most two contiguous runs: from the oldest record to the end of the array, then from the start
+    const uint64_t first = (head_ - count) & mask_;
+    const uint64_t run = std::min<uint64_t>(count, records_.size() - first);
+    out.write(reinterpret_cast<const char*>(records_.data() + first), static_cast<std::streamsize>(run * sizeof(TraceRecord)));
+    out.write(reinterpret_cast<const char*>(records_.data()), static_cast<std::streamsize>((count - run) * sizeof(TraceRecord)));
+    if (!out) throw std::runtime_error("Failed to write trace: " + path);
+}
+
+std::vector<TraceRecord> TraceBuffer::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open trace: " + path);
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t count = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || std::memcmp(magic, trace_magic, 4) != 0) throw std::runtime_error("Invalid trace format: " + path);
+    if (version != trace_version) throw std::runtime_error("Unsupported trace version: " + path);
+    // The count comes from the file: check it against what is there before allocating for it
+    const std::streampos body = in.tellg();
+    in.seekg(0, std::ios::end);
+    const uint64_t available = static_cast<uint64_t>(in.tellg() - body);
+    in.seekg(body);
+    if (count > available / sizeof(TraceRecord)) throw std::runtime_error("Truncated trace: " + path);
+    std::vector<TraceRecord> records(static_cast<size_t>(count));
+    if (!in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(count * sizeof(TraceRecord)))) {
+        throw std::runtime_error("Truncated trace: " + path);
+    }
+    return records;
+}
@@ -0,0 +1,212 @@
+#include "nes/trace_events.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace nes;
+
+std::atomic<TraceEventRecorder*> TraceEventRecorder::active_{ nullptr };
+
+namespace {
+std::atomic<uint64_t> next_recorder_id{ 1 };
+
+struct ThreadCache {
+    uint64_t recorder = 0;
+    void* buffer = nullptr;
+};
+thread_local ThreadCache thread_cache;
+
+const char* category_name(TraceCategory category) {
+    switch (category) {
+        case TraceCategory::Emulator: return "emulator";
+        case TraceCategory::Cpu: return "cpu";
+        case TraceCategory::Ppu: return "ppu";
+        case TraceCategory::Apu: return "apu";
+        case TraceCategory::Io: return "io";
+        case TraceCategory::Output: return "output";
+    }
+    return "other";
+}
+
+size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void json_string(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+void json_micros(std::ostream& out, uint64_t ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+    out << text;
+}
+}
+
+TraceEventRecorder::TraceEventRecorder(const TraceEventOptions& options) : options_(options), id_(next_recorder_id.fetch_add(1)) {
+    if (options_.events_per_thread == 0) throw std::invalid_argument("Trace event ring must hold at least one event");
+    options_.events_per_thread = round_up_pow2(options_.events_per_thread);
+}
+
+TraceEventRecorder::~TraceEventRecorder() {
+    stop();
+}
+
+uint64_t TraceEventRecorder::now_ns() noexcept {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TraceEventRecorder::start() {
+    TraceEventRecorder* expected = nullptr;
+    if (!active_.compare_exchange_strong(expected, this, std::memory_order_acq_rel)) {
+        if (expected == this) return;
+        throw std::runtime_error("Another trace event recorder is already active");
+    }
+    std::lock_guard<std::mutex> guard(flusher_lock_);
+    running_ = true;
+    flusher_ = std::thread([this] { flusher_loop(); });
+}
+
+void TraceEventRecorder::stop() {
+    TraceEventRecorder* expected = this;
+    active_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> guard(flusher_lock_);
+        running_ = false;
+    }
+    flusher_wake_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+    flush();
+}
+
+TraceEventRecorder::ThreadBuffer& TraceEventRecorder::local() {
+    if (thread_cache.recorder == id_) return *static_cast<ThreadBuffer*>(thread_cache.buffer);
+    std::lock_guard<std::mutex> guard(buffers_lock_);
+    buffers_.push_back(std::make_unique<ThreadBuffer>(options_.events_per_thread, static_cast<uint32_t>(buffers_.size() + 1)));
+    thread_cache.recorder = id_;
+    thread_cache.buffer = buffers_.back().get();
+    return *buffers_.back();
+}
+
+void TraceEventRecorder::push(const TraceEvent& event) noexcept {
+    ThreadBuffer* buffer = nullptr;
+    try { buffer = &local(); } catch (...) { return; } // first event on a thread and out of memory
+    const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->tail.load(std::memory_order_acquire) >= buffer->events.size()) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[head & (buffer->events.size() - 1)] = event;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceEventRecorder::complete(const char* name, TraceCategory category, uint64_t start_ns, uint64_t duration_ns,
+                                  const char* arg_name, uint64_t arg) noexcept {
+    push(TraceEvent{ start_ns, duration_ns, name, arg_name, arg, category, 'X' });
+}
+
+void TraceEventRecorder::instant(const char* name, TraceCategory category, const char* arg_name, uint64_t arg) noexcept {
+    push(TraceEvent{ now_ns(), 0, name, arg_name, arg, category, 'i' });
+}
+
+void TraceEventRecorder::name_thread(const std::string& name) {
+    ThreadBuffer& buffer = local();
+    std::lock_guard<std::mutex> guard(buffers_lock_); // the flusher reads names while capturing
+    buffer.name = name;
+}
+
+void TraceEventRecorder::flush() {
+    std::lock_guard<std::mutex> buffers_guard(buffers_lock_);
+    std::lock_guard<std::mutex> window_guard(window_lock_);
+    for (auto& buffer : buffers_) {
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) window_.push_back(WindowEvent{ buffer->events[tail & (buffer->events.size() - 1)], buffer->tid });
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+    // Threads flush out of order, so this trims approximately; capture() sorts what is left
+    const uint64_t window_ns = options_.window_ms * 1000000;
+    const uint64_t now = now_ns();
+    const uint64_t cutoff = now > window_ns ? now - window_ns : 0;
+    while (!window_.empty() && window_.front().event.start_ns + window_.front().event.duration_ns < cutoff) window_.pop_front();
+}
+
+void TraceEventRecorder::flusher_loop() {
+    std::unique_lock<std::mutex> lock(flusher_lock_);
+    while (running_) {
+        flusher_wake_.wait_for(lock, std::chrono::milliseconds(options_.flush_interval_ms));
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+uint64_t TraceEventRecorder::dropped() const noexcept {
+    std::lock_guard<std::mutex> guard(buffers_lock_);
+    uint64_t total = 0;
+    for (const auto& buffer : buffers_) total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+std::string TraceEventRecorder::capture_json() {
+    flush();
+    std::vector<WindowEvent> events;
+    {
+        std::lock_guard<std::mutex> guard(window_lock_);
+        events.assign(window_.begin(), window_.end());
+    }
+    std::stable_sort(events.begin(), events.end(), [](const WindowEvent& a, const WindowEvent& b) { return a.event.start_ns < b.event.start_ns; });
+    const uint64_t origin = events.empty() ? 0 : events.front().event.start_ns;
+
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> guard(buffers_lock_);
+        for (const auto& buffer : buffers_) {
+            out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+            json_string(out, buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name);
+            out << "}}";
+            first = false;
+        }
+    }
+    for (const auto& e : events) {
+        out << (first ? "" : ",") << "\n{\"name\":";
+        json_string(out, e.event.name);
+        out << ",\"cat\":\"" << category_name(e.event.category) << "\",\"ph\":\"" << e.event.phase << "\",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":";
+        json_micros(out, e.event.start_ns - origin);
+        if (e.event.phase == 'X') {
+            out << ",\"dur\":";
+            json_micros(out, e.event.duration_ns);
+        } else {
+            out << ",\"s\":\"t\"";
+        }
+        if (e.event.arg_name) {
+            out << ",\"args\":{";
+            json_string(out, e.event.arg_name);
+            out << ":" << e.event.arg << "}";
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+void TraceEventRecorder::capture(const std::string& path) {
+    const std::string json = capture_json();
+    std::ofstream out(path, std::ios::binary);
+    if (!out || !out.write(json.data(), static_cast<std::streamsize>(json.size()))) throw std::runtime_error("Failed to write trace events: " + path);
+}
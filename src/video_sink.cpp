@@ -0,0 +1,223 @@
+#include "nes/video_sink.h"
+#include "nes/trace_events.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace nes;
+
+namespace {
+constexpr size_t rgb_bytes = VideoSink::width * VideoSink::height * 3;
+constexpr size_t luma_bytes = VideoSink::width * VideoSink::height;
+constexpr size_t yuv_bytes = luma_bytes + 2 * (luma_bytes / 4);
+
+size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// BT.601 full range in 8.8 fixed point. Luma sums stay below 2^16, chroma terms within int16,
+// so both fit 16-bit lanes.
+void luma_row(const int16_t* r, const int16_t* g, const int16_t* b, uint8_t* y, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i kr = _mm_set1_epi16(77), kg = _mm_set1_epi16(150), kb = _mm_set1_epi16(29), round = _mm_set1_epi16(128);
+    for (; x + 8 <= width; x += 8) {
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r + x)), kr),
+                                    _mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x)), kg));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x)), kb));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 8);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y + x), _mm_packus_epi16(sum, sum));
+    }
+#endif
+    for (; x < width; ++x) y[x] = static_cast<uint8_t>((77 * r[x] + 150 * g[x] + 29 * b[x] + 128) >> 8);
+}
+
+void chroma_row(const int16_t* r, const int16_t* g, const int16_t* b, uint8_t* u, uint8_t* v, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i ur = _mm_set1_epi16(-43), ug = _mm_set1_epi16(-85), ub = _mm_set1_epi16(128);
+    const __m128i vr = _mm_set1_epi16(128), vg = _mm_set1_epi16(-107), vb = _mm_set1_epi16(-21);
+    for (; x + 8 <= width; x += 8) {
+        const __m128i rr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + x));
+        const __m128i gg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x));
+        const __m128i bb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i cu = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(rr, ur), _mm_mullo_epi16(gg, ug)), _mm_mullo_epi16(bb, ub));
+        __m128i cv = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(rr, vr), _mm_mullo_epi16(gg, vg)), _mm_mullo_epi16(bb, vb));
+        cu = _mm_add_epi16(_mm_srai_epi16(cu, 8), bias);
+        cv = _mm_add_epi16(_mm_srai_epi16(cv, 8), bias);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x), _mm_packus_epi16(cu, cu));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x), _mm_packus_epi16(cv, cv));
+    }
+#endif
+    for (; x < width; ++x) {
+        u[x] = static_cast<uint8_t>(std::clamp(((-43 * r[x] - 85 * g[x] + 128 * b[x]) >> 8) + 128, 0, 255));
+        v[x] = static_cast<uint8_t>(std::clamp(((128 * r[x] - 107 * g[x] - 21 * b[x]) >> 8) + 128, 0, 255));
+    }
+}
+
+// RGB24 to planar 4:2:0; chroma from the average of each 2x2 block
+void rgb_to_yuv420(const uint8_t* rgb, uint8_t* out) {
+    constexpr int w = VideoSink::width, h = VideoSink::height, cw = w / 2;
+    uint8_t* y_plane = out;
+    uint8_t* u_plane = out + luma_bytes;
+    uint8_t* v_plane = u_plane + luma_bytes / 4;
+    int16_t r[2][w], g[2][w], b[2][w], ra[cw], ga[cw], ba[cw];
+    for (int row = 0; row < h; row += 2) {
+        for (int k = 0; k < 2; ++k) {
+            const uint8_t* src = rgb + static_cast<size_t>(row + k) * w * 3;
+            for (int x = 0; x < w; ++x) { r[k][x] = src[3 * x]; g[k][x] = src[3 * x + 1]; b[k][x] = src[3 * x + 2]; }
+            luma_row(r[k], g[k], b[k], y_plane + static_cast<size_t>(row + k) * w, w);
+        }
+        for (int x = 0; x < cw; ++x) {
+            ra[x] = static_cast<int16_t>((r[0][2 * x] + r[0][2 * x + 1] + r[1][2 * x] + r[1][2 * x + 1] + 2) >> 2);
+            ga[x] = static_cast<int16_t>((g[0][2 * x] + g[0][2 * x + 1] + g[1][2 * x] + g[1][2 * x + 1] + 2) >> 2);
+            ba[x] = static_cast<int16_t>((b[0][2 * x] + b[0][2 * x + 1] + b[1][2 * x] + b[1][2 * x + 1] + 2) >> 2);
+        }
+        chroma_row(ra, ga, ba, u_plane + static_cast<size_t>(row / 2) * cw, v_plane + static_cast<size_t>(row / 2) * cw, cw);
+    }
+}
+}
+
+VideoSink::VideoSink(const VideoSinkOptions& options) : options_(options) {
+    if (options_.frame_interval == 0 || options_.queue_frames == 0) throw std::invalid_argument("Video frame interval and queue must be nonzero");
+    try { open_outputs(); }
+    catch (...) { discard_outputs(); throw; } // the destructor won't run: don't leave half-made files behind
+}
+
+void VideoSink::open_outputs() {
+    if (!options_.audio_path.empty()) wav_ = std::make_unique<WavWriter>(options_.audio_path, options_.audio_sample_rate);
+    slots_.resize(round_up_pow2(options_.queue_frames));
+    for (auto& slot : slots_) slot.rgb.resize(rgb_bytes);
+    frame_.resize(options_.format == VideoFormat::Y4m ? yuv_bytes : rgb_bytes);
+    out_ = options_.path == "-" ? stdout : std::fopen(options_.path.c_str(), "wb");
+    if (!out_) throw std::runtime_error("Failed to open video output: " + options_.path);
+
+    if (options_.format == VideoFormat::Y4m) {
+        // Frame rate as an exact fraction of the recorded rate, in millionths
+        uint64_t num = static_cast<uint64_t>(std::llround(options_.refresh_hz * 1000000.0));
+        uint64_t den = 1000000ull * options_.frame_interval;
+        const uint64_t divisor = std::gcd(num, den);
+        std::fprintf(out_, "YUV4MPEG2 W%d H%d F%llu:%llu Ip A8:7 C420jpeg\n", width, height,
+                     static_cast<unsigned long long>(num / divisor), static_cast<unsigned long long>(den / divisor));
+    }
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+void VideoSink::discard_outputs() noexcept {
+    if (out_ && out_ != stdout) {
+        std::fclose(out_);
+        std::remove(options_.path.c_str());
+    }
+    out_ = nullptr;
+    if (wav_) {
+        try { wav_->close(); } catch (...) {}
+        wav_.reset();
+        std::remove(options_.audio_path.c_str());
+    }
+}
+
+VideoSink::~VideoSink() {
+    try { close(); } catch (...) {}
+}
+
+void VideoSink::push_repeat(const int16_t* audio, size_t samples) {
+    if (!writer_.joinable()) throw std::runtime_error("Video sink is closed");
+    if (wants_frame()) pending_repeats_++; // written like a dropped frame, before the next slot
+    frames_seen_++;
+    pending_audio_.insert(pending_audio_.end(), audio, audio + samples);
+}
+
+bool VideoSink::push_frame(const std::vector<uint8_t>& rgb, const int16_t* audio, size_t samples) {
+    if (!writer_.joinable()) throw std::runtime_error("Video sink is closed");
+    const bool recorded = wants_frame();
+    frames_seen_++;
+    if (!recorded || rgb.size() != rgb_bytes) {
+        if (recorded) throw std::invalid_argument("Video frames must be 256x240 RGB24");
+        pending_audio_.insert(pending_audio_.end(), audio, audio + samples);
+        return true;
+    }
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == slots_.size()) {
+        frames_dropped_++;
+        pending_repeats_++;
+        pending_audio_.insert(pending_audio_.end(), audio, audio + samples);
+        return false;
+    }
+    TraceScope scope("video_enqueue", TraceCategory::Output);
+    Slot& slot = slots_[head & (slots_.size() - 1)];
+    std::memcpy(slot.rgb.data(), rgb.data(), rgb_bytes);
+    slot.audio.assign(pending_audio_.begin(), pending_audio_.end());
+    slot.audio.insert(slot.audio.end(), audio, audio + samples);
+    slot.repeat_before = pending_repeats_;
+    pending_audio_.clear();
+    pending_repeats_ = 0;
+    head_.store(head + 1, std::memory_order_release);
+    wake_.notify_one(); // never takes the lock; the writer's timed wait covers a missed wake-up
+    return true;
+}
+
+void VideoSink::writer_loop() {
+    for (;;) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            if (stopping_.load(std::memory_order_acquire) && tail == head_.load(std::memory_order_acquire)) return;
+            std::unique_lock<std::mutex> lock(wake_lock_);
+            wake_.wait_for(lock, std::chrono::milliseconds(5));
+            continue;
+        }
+        write_slot(slots_[tail & (slots_.size() - 1)]);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+}
+
+void VideoSink::write_slot(Slot& slot) {
+    TraceScope scope("video_write", TraceCategory::Output);
+    for (uint32_t i = 0; i < slot.repeat_before; ++i) write_frame(true);
+    if (options_.format == VideoFormat::Y4m) rgb_to_yuv420(slot.rgb.data(), frame_.data());
+    else std::memcpy(frame_.data(), slot.rgb.data(), rgb_bytes);
+    have_frame_ = true;
+    write_frame(false);
+    write_audio(slot.audio.data(), slot.audio.size());
+}
+
+void VideoSink::write_frame(bool repeat) {
+    if (!error_.empty()) return;
+    if (repeat && !have_frame_) std::fill(frame_.begin(), frame_.end(), options_.format == VideoFormat::Y4m ? 0x80 : 0);
+    if ((options_.format == VideoFormat::Y4m && std::fputs("FRAME\n", out_) < 0) || std::fwrite(frame_.data(), 1, frame_.size(), out_) != frame_.size()) {
+        error_ = "Failed to write video frame to " + options_.path;
+        return;
+    }
+    frames_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VideoSink::write_audio(const int16_t* samples, size_t count) {
+    if (!wav_ || count == 0 || !error_.empty()) return;
+    try { wav_->write(samples, count); } catch (const std::exception& e) { error_ = e.what(); }
+}
+
+void VideoSink::close() {
+    if (!writer_.joinable()) return;
+    stopping_.store(true, std::memory_order_release);
+    wake_.notify_one();
+    writer_.join();
+    // The writer is gone, so this thread may finish its work: frames dropped at the very end
+    for (uint32_t i = 0; i < pending_repeats_; ++i) write_frame(true);
+    write_audio(pending_audio_.data(), pending_audio_.size());
+    pending_repeats_ = 0;
+    pending_audio_.clear();
+    if (wav_) wav_->close();
+    if (out_ != stdout && std::fclose(out_) != 0 && error_.empty()) error_ = "Failed to close video output: " + options_.path;
+    if (out_ == stdout) std::fflush(stdout);
+    out_ = nullptr;
+    if (!error_.empty()) throw std::runtime_error(error_);
+}
@@ -1,7 +1,11 @@
 #include "nes/visual.h"
 #include "nes/cpu.h"
+#include "nes/scheduler.h"
+#include "nes/trace_events.h"
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <sstream>
 
 using namespace nes;
@@ -17,27 +21,44 @@ const std::array<std::array<uint8_t,3>, 64> PPU::nes_palette_ = {{{{
     {{248,216,120}},{{216,248,120}},{{184,248,184}},{{184,248,216}},{{0,252,252}},{{248,216,248}},{{0,0,0}},{{0,0,0}}
 }};
 
-PPU::PPU(const ROM* rom, CPU6502* cpu) : rom_(rom), cpu_(cpu), chr_ram_(), has_chr_rom_(!rom_->chr().empty()), vram_{}, palette_{}, oam_{}, mirroring_(rom_->header().mirroring),
-    ppuctrl_(0), ppumask_(0), ppustatus_(0), oamaddr_(0), ppuscroll_(0), ppuaddr_(0), ppudata_(0), vram_addr_(0), temp_addr_(0), fine_x_(0), write_toggle_(false),
-    scanline_(-1), cycle_(0), scroll_x_(0), scroll_y_(0), nametable_base_(0), nmi_pending_(false),
-    coarse_x_(0), coarse_y_(0), fine_y_(0), sprite_overflow_(false), sprite_zero_hit_(false), scanline_pixels_{}, scanline_palettes_{}, sprite_buffer_(),
-    secondary_oam_{}, sprite_count_(0), oam_addr_secondary_(0), show_bg_(true), show_sprites_(true), bg_left_clip_(false), sprite_left_clip_(false), frame_buffer_(256 * 240 * 3, 0) {
-    if (!has_chr_rom_) chr_ram_.assign(8 * 1024, 0);
-    for (size_t i = 0; i < palette_.size(); ++i) palette_[i] = static_cast<uint8_t>(i % 64);
+static constexpr size_t frame_buffer_size = 256 * 240 * 3;
+
+// Shared by every PPU in the process; 0 is never handed out, it means "nothing seen"
+static uint64_t next_generation() {
+    static std::atomic<uint64_t> counter{ 0 };
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+PPU::PPU(const ROM* rom, CPU6502* cpu) : rom_(rom), cpu_(cpu), chr_ram_(), has_chr_rom_(!rom_->chr().empty()), state_{}, vram_(),
+    frame_buffer_(), generation_(next_generation()), scheduler_(nullptr), render_enabled_(true) {
+    set_mirroring(rom_->header().four_screen ? Mirroring::FourScreen : rom_->header().mirroring ? Mirroring::Vertical : Mirroring::Horizontal);
+    state_.scanline_ = -1;
+    state_.show_bg_ = state_.show_sprites_ = true;
+    for (size_t i = 0; i < state_.palette_.size(); ++i) state_.palette_[i] = static_cast<uint8_t>(i % 64);
 }
 
+PPU::PPU(const PPU& other, CPU6502* cpu) : rom_(other.rom_), cpu_(cpu), chr_ram_(other.chr_ram_), has_chr_rom_(other.has_chr_rom_),
+    state_(other.state_), vram_(other.vram_), frame_buffer_(), generation_(next_generation()), scheduler_(nullptr),
+    render_enabled_(other.render_enabled_) {}
+
 uint8_t PPU::read_register(uint8_t reg) {
+    catch_up();
     switch (reg) {
-        case 0: return ppuctrl_;
-        case 1: return ppumask_;
-        case 2: { uint8_t status = ppustatus_ | (sprite_overflow_ ? 0x20 : 0) | (sprite_zero_hit_ ? 0x40 : 0); ppustatus_ &= ~0x80; write_toggle_ = false; return status; }
-        case 3: return oamaddr_;
-        case 4: return oam_[oamaddr_];
-        case 5: return ppuscroll_;
-        case 6: return ppuaddr_;
+        case 0: return state_.ppuctrl_;
+        case 1: return state_.ppumask_;
+        case 2: { uint8_t status = state_.ppustatus_ | (state_.sprite_overflow_ ? 0x20 : 0) | (state_.sprite_zero_hit_ ? 0x40 : 0); state_.ppustatus_ &= ~0x80; state_.write_toggle_ = false; return status; }
+        case 3: return state_.oamaddr_;
+        case 4: return state_.oam_[state_.oamaddr_];
+        case 5: return state_.ppuscroll_;
+        case 6: return state_.ppuaddr_;
         case 7: {
-            uint8_t data = read_chr(vram_addr_);
-            vram_addr_ += (ppuctrl_ & 0x04) ? 32 : 1;
+            // CHR and nametable reads come out one access late, through the read buffer; palette reads
+            // are immediate and refill the buffer with the nametable byte underneath
+            const uint16_t addr = state_.vram_addr_ & 0x3FFF;
+            uint8_t data = state_.ppudata_;
+            if (addr >= 0x3F00) { data = read_palette(addr); state_.ppudata_ = read_vram(addr); }
+            else state_.ppudata_ = addr < 0x2000 ? read_chr(addr) : read_vram(addr);
+            state_.vram_addr_ += (state_.ppuctrl_ & 0x04) ? 32 : 1;
             return data;
         }
         default: return 0;
@@ -45,133 +66,216 @@ uint8_t PPU::read_register(uint8_t reg) {
 }
 
 void PPU::write_register(uint8_t reg, uint8_t value) {
+    catch_up();
     switch (reg) {
-        case 0: ppuctrl_ = value; temp_addr_ = (temp_addr_ & 0xF3FF) | ((value & 0x03) << 10); nametable_base_ = (value & 0x03) * 0x0400; break;
+        case 0: state_.ppuctrl_ = value; state_.temp_addr_ = (state_.temp_addr_ & 0xF3FF) | ((value & 0x03) << 10); state_.nametable_base_ = (value & 0x03) * 0x0400; break;
         case 1: 
-            ppumask_ = value; 
-            show_bg_ = (value & 0x08) != 0;
-            show_sprites_ = (value & 0x10) != 0;
-            bg_left_clip_ = (value & 0x02) != 0;
-            sprite_left_clip_ = (value & 0x04) != 0;
+            state_.ppumask_ = value; 
+            state_.show_bg_ = (value & 0x08) != 0;
+            state_.show_sprites_ = (value & 0x10) != 0;
+            state_.bg_left_clip_ = (value & 0x02) != 0;
+            state_.sprite_left_clip_ = (value & 0x04) != 0;
             break;
-        case 3: oamaddr_ = value; break;
-        case 4: oam_[oamaddr_++] = value; break;
+        case 3: state_.oamaddr_ = value; break;
+        case 4: state_.oam_[state_.oamaddr_++] = value; break;
         case 5: {
-            if (!write_toggle_) { scroll_x_ = value; temp_addr_ = (temp_addr_ & 0xFFE0) | (value >> 3); fine_x_ = value & 0x07; }
-            else { scroll_y_ = value; temp_addr_ = (temp_addr_ & 0x8FFF) | ((value & 0x07) << 12); temp_addr_ = (temp_addr_ & 0xFC1F) | ((value & 0xF8) << 2); }
-            write_toggle_ = !write_toggle_;
+            if (!state_.write_toggle_) { state_.scroll_x_ = value; state_.temp_addr_ = (state_.temp_addr_ & 0xFFE0) | (value >> 3); state_.fine_x_ = value & 0x07; }
+            else { state_.scroll_y_ = value; state_.temp_addr_ = (state_.temp_addr_ & 0x8FFF) | ((value & 0x07) << 12); state_.temp_addr_ = (state_.temp_addr_ & 0xFC1F) | ((value & 0xF8) << 2); }
+            state_.write_toggle_ = !state_.write_toggle_;
             break;
         }
         case 6: {
-            if (!write_toggle_) { temp_addr_ = (temp_addr_ & 0x80FF) | ((value & 0x3F) << 8); }
-            else { temp_addr_ = (temp_addr_ & 0xFF00) | value; vram_addr_ = temp_addr_; coarse_x_ = vram_addr_ & 0x1F; coarse_y_ = (vram_addr_ >> 5) & 0x1F; fine_y_ = (vram_addr_ >> 12) & 0x07; }
-            write_toggle_ = !write_toggle_;
+            if (!state_.write_toggle_) { state_.temp_addr_ = (state_.temp_addr_ & 0x80FF) | ((value & 0x3F) << 8); }
+            else { state_.temp_addr_ = (state_.temp_addr_ & 0xFF00) | value; state_.vram_addr_ = state_.temp_addr_; state_.coarse_x_ = state_.vram_addr_ & 0x1F; state_.coarse_y_ = (state_.vram_addr_ >> 5) & 0x1F; state_.fine_y_ = (state_.vram_addr_ >> 12) & 0x07; }
+            state_.write_toggle_ = !state_.write_toggle_;
+            break;
+        }
+        case 7: {
+            const uint16_t addr = state_.vram_addr_ & 0x3FFF;
+            if (addr < 0x2000) write_chr(addr, value);
+            else if (addr < 0x3F00) write_vram(addr, value);
+            else write_palette(addr, value);
+            state_.vram_addr_ += (state_.ppuctrl_ & 0x04) ? 32 : 1;
             break;
         }
-        case 7: write_chr(vram_addr_, value); vram_addr_ += (ppuctrl_ & 0x04) ? 32 : 1; break;
     }
 }
 
-uint16_t PPU::mirror_vram_addr(uint16_t addr) const {
-    addr &= 0x0FFF;
-    if (mirroring_ == 0) { // horizontal
-        if (addr >= 0x0800) addr -= 0x0800;
-    } else { // vertical
-        if (addr >= 0x0400) addr &= 0x03FF;
+void PPU::sync_from(const PPU& other) noexcept {
+    state_ = other.state_;
+    vram_.sync_from(other.vram_);
+    chr_ram_.sync_from(other.chr_ram_);
+}
+
+void PPU::set_mirroring(Mirroring mode) noexcept {
+    static constexpr std::array<std::array<uint8_t, 4>, 5> layouts = {{
+        {{ 0, 0, 1, 1 }}, // horizontal: $2000=$2400, $2800=$2C00
+        {{ 0, 1, 0, 1 }}, // vertical: $2000=$2800, $2400=$2C00
+        {{ 0, 0, 0, 0 }},
+        {{ 1, 1, 1, 1 }},
+        {{ 0, 1, 2, 3 }},
+    }};
+    state_.mirroring_ = static_cast<uint8_t>(mode);
+    state_.nametable_pages_ = layouts[static_cast<size_t>(mode)];
+}
+
+bool PPU::valid_state(const State& state) noexcept {
+    for (uint8_t page : state.nametable_pages_) {
+        if (page > 3) return false;
     }
-    return addr;
+    // The beam position and sprite count index the frame buffer, the line buffers and secondary OAM
+    if (state.scanline_ < -1 || state.scanline_ > 260 || state.cycle_ < 0 || state.cycle_ > 340) return false;
+    if (state.sprite_count_ < 0 || state.sprite_count_ > 8 || state.oam_addr_secondary_ > 32) return false;
+    return state.mirroring_ <= static_cast<uint8_t>(Mirroring::FourScreen);
 }
 
+void PPU::map_nametable(int slot, uint8_t page) noexcept {
+    state_.nametable_pages_[slot & 3] = page & 3;
+}
+
+void PPU::write_vram(uint16_t addr, uint8_t value) {
+    vram_.writable_page(state_.nametable_pages_[(addr >> 10) & 3])[addr & 0x03FF] = value;
+}
+
+// $3F10/$3F14/$3F18/$3F1C are the backdrop entries of $3F00/$3F04/$3F08/$3F0C
+static size_t palette_index(uint16_t addr) noexcept {
+    size_t index = addr & 0x1F;
+    return (index & 0x13) == 0x10 ? index & 0x0F : index;
+}
+
+uint8_t PPU::read_palette(uint16_t addr) const { return state_.palette_[palette_index(addr)]; }
+void PPU::write_palette(uint16_t addr, uint8_t value) { state_.palette_[palette_index(addr)] = value & 0x3F; }
+
 uint8_t PPU::read_chr(uint16_t addr) const {
     addr &= 0x1FFF;
     if (has_chr_rom_) {
         const auto& chr = rom_->chr();
         return chr.empty() ? 0 : chr[addr % chr.size()];
     }
-    return chr_ram_[addr % chr_ram_.size()];
+    return chr_ram_.read(addr);
 }
 
 void PPU::write_chr(uint16_t addr, uint8_t value) {
     addr &= 0x1FFF;
-    if (!has_chr_rom_) chr_ram_[addr % chr_ram_.size()] = value;
+    if (!has_chr_rom_) chr_ram_.write(addr, value);
 }
 
 size_t PPU::chr_size() const noexcept { return has_chr_rom_ ? rom_->chr().size() : chr_ram_.size(); }
 
 void PPU::step() {
-    cycle_++;
-    if (cycle_ > 340) {
-        cycle_ = 0;
-        scanline_++;
-        if (scanline_ == 240) render_scanline();
-        if (scanline_ > 260) { scanline_ = -1; sprite_zero_hit_ = false; sprite_overflow_ = false; }
+    state_.cycle_++;
+    if (state_.cycle_ > 340) {
+        state_.cycle_ = 0;
+        state_.scanline_++;
+        if (state_.scanline_ == 240) render_scanline();
+        if (state_.scanline_ > 260) { state_.scanline_ = -1; state_.sprite_zero_hit_ = false; state_.sprite_overflow_ = false; }
     }
 
-    if (scanline_ >= 0 && scanline_ < 240) {
-        if (cycle_ == 1) evaluate_sprites();
-        if (cycle_ >= 1 && cycle_ <= 256) {
+    if (state_.scanline_ >= 0 && state_.scanline_ < 240) {
+        if (state_.cycle_ == 1) {
+            evaluate_sprites();
+            // Once per line rather than per pixel, and still in time if rendering is switched on mid-frame
+            if (render_enabled_ && frame_buffer_.empty()) allocate_frame_buffer();
+        }
+        if (render_enabled_ && state_.cycle_ >= 1 && state_.cycle_ <= 256) {
             fetch_background();
-            render_pixel(cycle_ - 1);
+            render_pixel(state_.cycle_ - 1);
         }
-        if (cycle_ == 257) sprite_count_ = 0;
+        if (state_.cycle_ == 257) state_.sprite_count_ = 0;
+    }
+
+    if (state_.scanline_ == 241 && state_.cycle_ == 1) {
+        state_.ppustatus_ |= 0x80;
+        if (state_.ppuctrl_ & 0x80) state_.nmi_pending_ = true;
+    }
+    if (state_.scanline_ == -1 && state_.cycle_ == 1) state_.ppustatus_ &= ~0x80;
+}
+
+// Only dots 1-257 of visible lines (1 and 257 alone with rendering off), dot 1 of any line and the line
+// wrap do anything; the dots between them just advance the cycle counter and are skipped in one go
+void PPU::run_dots(uint64_t dots) {
+    state_.dot_ += dots;
+    while (dots) {
+        const int cycle = state_.cycle_;
+        const bool visible = state_.scanline_ >= 0 && state_.scanline_ < 240;
+        int next; // the next cycle value step() has work at
+        if (cycle < 1) next = 1;
+        else if (visible && cycle < 257) next = render_enabled_ ? cycle + 1 : 257;
+        else next = 341;
+        const uint64_t idle = std::min<uint64_t>(static_cast<uint64_t>(next - cycle - 1), dots);
+        state_.cycle_ += static_cast<int>(idle);
+        dots -= idle;
+        if (dots) { step(); --dots; }
     }
+}
 
-    if (scanline_ == 241 && cycle_ == 1) {
-        ppustatus_ |= 0x80;
-        if (ppuctrl_ & 0x80) nmi_pending_ = true;
+void PPU::catch_up() {
+    if (!scheduler_) return;
+    uint64_t target = scheduler_->now() * 3;
+    if (target <= state_.dot_) return;
+    TraceScope scope("ppu_catch_up", TraceCategory::Ppu, "dots", target - state_.dot_);
+    run_dots(target - state_.dot_);
+}
+
+void PPU::set_vblank(bool active) {
+    if (active) {
+        state_.ppustatus_ |= 0x80;
+        if (state_.ppuctrl_ & 0x80) state_.nmi_pending_ = true;
+    } else {
+        state_.ppustatus_ &= ~0x80;
+        state_.nmi_pending_ = false;
     }
-    if (scanline_ == -1 && cycle_ == 1) ppustatus_ &= ~0x80;
 }
 
 void PPU::evaluate_sprites() {
-    sprite_count_ = 0;
-    oam_addr_secondary_ = 0;
-    for (int i = 0; i < 64 && sprite_count_ < 8; ++i) {
-        uint8_t y = oam_[i * 4];
-        if (scanline_ >= y && scanline_ < y + 8) {
+    state_.sprite_count_ = 0;
+    state_.oam_addr_secondary_ = 0;
+    for (int i = 0; i < 64 && state_.sprite_count_ < 8; ++i) {
+        uint8_t y = state_.oam_[i * 4];
+        if (state_.scanline_ >= y && state_.scanline_ < y + 8) {
             for (int j = 0; j < 4; ++j) {
-                secondary_oam_[oam_addr_secondary_++] = oam_[i * 4 + j];
+                state_.secondary_oam_[state_.oam_addr_secondary_++] = state_.oam_[i * 4 + j];
             }
-            sprite_count_++;
-            if (i == 0) sprite_zero_hit_ = true;
+            state_.sprite_count_++;
+            if (i == 0) state_.sprite_zero_hit_ = true;
         }
     }
-    if (sprite_count_ >= 8) sprite_overflow_ = true;
+    if (state_.sprite_count_ >= 8) state_.sprite_overflow_ = true;
 }
 
 void PPU::fetch_background() {
-    int x = cycle_ - 1 + scroll_x_;
-    int y = scanline_ + scroll_y_;
+    int x = state_.cycle_ - 1 + state_.scroll_x_;
+    int y = state_.scanline_ + state_.scroll_y_;
     int tile_x = x / 8, tile_y = y / 8;
     int nt_index = (tile_y % 30) * 32 + (tile_x % 32);
-    uint8_t tile_id = vram_[mirror_vram_addr(nametable_base_ + nt_index)];
-    int attr_index = nametable_base_ + 0x03C0 + ((tile_y / 4) * 8) + (tile_x / 4);
-    uint8_t attr = vram_[mirror_vram_addr(attr_index)];
+    uint8_t tile_id = read_vram(static_cast<uint16_t>(state_.nametable_base_ + nt_index));
+    int attr_index = state_.nametable_base_ + 0x03C0 + ((tile_y / 4) * 8) + (tile_x / 4);
+    uint8_t attr = read_vram(static_cast<uint16_t>(attr_index));
     int shift = ((tile_y & 2) ? 4 : 0) + ((tile_x & 2) ? 2 : 0);
     uint8_t pal_sel = (attr >> shift) & 3;
-    uint16_t tile_addr = (ppuctrl_ & 0x10 ? 0x1000 : 0) + tile_id * 16 + (y % 8);
+    uint16_t tile_addr = (state_.ppuctrl_ & 0x10 ? 0x1000 : 0) + tile_id * 16 + (y % 8);
     uint8_t p0 = read_chr(tile_addr), p1 = read_chr(tile_addr + 8);
     int bit = ((p0 >> (7 - (x % 8))) & 1) | (((p1 >> (7 - (x % 8))) & 1) << 1);
-    scanline_pixels_[cycle_ - 1] = bit;
-    scanline_palettes_[cycle_ - 1] = pal_sel;
+    state_.scanline_pixels_[state_.cycle_ - 1] = bit;
+    state_.scanline_palettes_[state_.cycle_ - 1] = pal_sel;
 }
 
 void PPU::render_pixel(int x) {
-    uint8_t bg_pixel = show_bg_ && (!bg_left_clip_ || x >= 8) ? scanline_pixels_[x] : 0;
-    uint8_t bg_pal = show_bg_ ? scanline_palettes_[x] : 0;
+    uint8_t bg_pixel = state_.show_bg_ && (!state_.bg_left_clip_ || x >= 8) ? state_.scanline_pixels_[x] : 0;
+    uint8_t bg_pal = state_.show_bg_ ? state_.scanline_palettes_[x] : 0;
     uint8_t sp_pixel = 0, sp_pal = 0;
     bool sp_priority = false;
 
-    if (show_sprites_ && (!sprite_left_clip_ || x >= 8)) {
-        for (int i = 0; i < sprite_count_; ++i) {
-            int sx = secondary_oam_[i * 4 + 3];
+    if (state_.show_sprites_ && (!state_.sprite_left_clip_ || x >= 8)) {
+        for (int i = 0; i < state_.sprite_count_; ++i) {
+            int sx = state_.secondary_oam_[i * 4 + 3];
             if (x >= sx && x < sx + 8) {
                 int col = x - sx;
-                uint8_t attr = secondary_oam_[i * 4 + 2];
+                uint8_t attr = state_.secondary_oam_[i * 4 + 2];
                 bool flip_h = attr & 0x40;
-                int ry = scanline_ - secondary_oam_[i * 4];
+                int ry = state_.scanline_ - state_.secondary_oam_[i * 4];
                 if (attr & 0x80) ry = 7 - ry;
-                uint16_t tile_addr = (ppuctrl_ & 0x08 ? 0x1000 : 0) + secondary_oam_[i * 4 + 1] * 16 + ry;
+                uint16_t tile_addr = (state_.ppuctrl_ & 0x08 ? 0x1000 : 0) + state_.secondary_oam_[i * 4 + 1] * 16 + ry;
                 uint8_t p0 = read_chr(tile_addr), p1 = read_chr(tile_addr + 8);
                 int bit = ((p0 >> (flip_h ? col : (7 - col))) & 1) | (((p1 >> (flip_h ? col : (7 - col))) & 1) << 1);
                 if (bit != 0) {
@@ -189,23 +293,93 @@ void PPU::render_pixel(int x) {
         pixel = sp_pixel;
         pal = sp_pal;
     }
-    uint8_t pal_idx = palette_[(pal << 2) + pixel] & 0x3F;
+    uint8_t pal_idx = state_.palette_[(pal << 2) + pixel] & 0x3F;
     const auto& col = nes_palette_[pal_idx];
-    int dst = (scanline_ * 256 + x) * 3;
-    frame_buffer_[dst] = col[0];
-    frame_buffer_[dst + 1] = col[1];
-    frame_buffer_[dst + 2] = col[2];
+    uint8_t* dst = &frame_buffer_[static_cast<size_t>(state_.scanline_ * 256 + x) * 3];
+    // Composition already touches the old pixel, so change tracking is one compare
+    if (dst[0] != col[0] || dst[1] != col[1] || dst[2] != col[2]) {
+        dst[0] = col[0];
+        dst[1] = col[1];
+        dst[2] = col[2];
+        const int row = state_.scanline_ >> 3;
+        row_generation_[row] = generation_;
+        tile_generation_[row * 32 + (x >> 3)] = generation_;
+    }
 }
 
-void PPU::oam_dma(uint8_t page) {
-    uint16_t addr = page << 8;
-    for (int i = 0; i < 256; ++i) {
-        oam_[oamaddr_++] = read(addr + i);
-    }
+void PPU::oam_dma(const uint8_t* page) {
+    catch_up(); // sprites already drawn this frame used the old OAM
+    const size_t start = state_.oamaddr_;
+    std::memcpy(state_.oam_.data() + start, page, state_.oam_.size() - start);
+    if (start) std::memcpy(state_.oam_.data(), page + (state_.oam_.size() - start), start);
 }
 
 void PPU::render_frame(std::vector<uint8_t>& rgb_pixels) const {
-    rgb_pixels = frame_buffer_;
+    TraceScope scope("frame_publish", TraceCategory::Output);
+    if (frame_buffer_.empty()) rgb_pixels.assign(frame_buffer_size, 0);
+    else rgb_pixels = frame_buffer_;
+}
+
+void PPU::copy_frame(uint8_t* rgb_pixels) const {
+    if (frame_buffer_.empty()) std::fill_n(rgb_pixels, frame_buffer_size, 0);
+    else std::copy(frame_buffer_.begin(), frame_buffer_.end(), rgb_pixels);
+}
+
+const uint8_t* PPU::frame_data() const {
+    if (frame_buffer_.empty()) allocate_frame_buffer();
+    return frame_buffer_.data();
+}
+
+// The buffer starts black, which consumers that saw nothing from this PPU have not got yet
+void PPU::allocate_frame_buffer() const {
+    frame_buffer_.assign(frame_buffer_size, 0);
+    row_generation_.fill(generation_);
+    tile_generation_.fill(generation_);
+}
+
+void PPU::render_frame(std::vector<uint8_t>& rgb_pixels, std::vector<DirtyRect>& dirty, uint64_t& seen) const {
+    if (rgb_pixels.size() != frame_buffer_size) {
+        rgb_pixels.assign(frame_buffer_size, 0);
+        seen = 0;
+    }
+    copy_frame(rgb_pixels.data(), seen, &dirty);
+}
+
+void PPU::copy_frame(uint8_t* rgb_pixels, uint64_t& seen, std::vector<DirtyRect>* dirty) const {
+    TraceScope scope("frame_publish_dirty", TraceCategory::Output);
+    if (dirty) dirty->clear();
+    const uint64_t current = generation_;
+    generation_ = next_generation(); // changes from here on are new to this consumer
+    if (seen == 0 || frame_buffer_.empty()) {
+        copy_frame(rgb_pixels);
+        if (dirty) dirty->push_back(DirtyRect{ 0, 0, 256, 240 });
+        seen = current;
+        return;
+    }
+    for (int row = 0; row < 30; ++row) {
+        if (row_generation_[row] <= seen) continue;
+        uint32_t bits = 0;
+        for (int column = 0; column < 32; ++column) bits |= uint32_t{ tile_generation_[row * 32 + column] > seen } << column;
+        while (bits) {
+            const int first = __builtin_ctz(bits);
+            int last = first;
+            while (last < 31 && (bits >> (last + 1) & 1)) ++last;
+            bits = last == 31 ? 0u : bits & (~0u << (last + 1));
+            const uint16_t x = static_cast<uint16_t>(first * 8), width = static_cast<uint16_t>((last - first + 1) * 8);
+            const uint16_t y = static_cast<uint16_t>(row * 8);
+            for (int line = y; line < y + 8; ++line) {
+                const size_t offset = (static_cast<size_t>(line) * 256 + x) * 3;
+                std::memcpy(rgb_pixels + offset, frame_buffer_.data() + offset, width * 3u);
+            }
+            if (!dirty) continue;
+            // The same span in the tile row above grows downwards instead of adding a rect
+            auto above = std::find_if(dirty->begin(), dirty->end(),
+                                      [&](const DirtyRect& r) { return r.y + r.height == y && r.x == x && r.width == width; });
+            if (above != dirty->end()) above->height += 8;
+            else dirty->push_back(DirtyRect{ x, y, width, 8 });
+        }
+    }
+    seen = current;
 }
 
 void PPU::render_scanline() {
@@ -214,8 +388,8 @@ void PPU::render_scanline() {
 
 std::string PPU::debug_info() const {
     std::ostringstream oss;
-    oss << "Scanline: " << scanline_ << " Cycle: " << cycle_ << " Sprites: " << sprite_count_
-        << " Overflow: " << (sprite_overflow_ ? "Yes" : "No") << " Hit: " << (sprite_zero_hit_ ? "Yes" : "No");
+    oss << "Scanline: " << state_.scanline_ << " Cycle: " << state_.cycle_ << " Sprites: " << state_.sprite_count_
+        << " Overflow: " << (state_.sprite_overflow_ ? "Yes" : "No") << " Hit: " << (state_.sprite_zero_hit_ ? "Yes" : "No");
     return oss.str();
 }
 
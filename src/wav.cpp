@@ -0,0 +1,49 @@
+#include "nes/wav.h"
+#include "nes/trace_events.h"
+#include <cstdio>
+#include <stdexcept>
+
+using namespace nes;
+
+static void put_u16(std::ofstream& out, uint16_t v) { char b[2] = { static_cast<char>(v & 0xFF), static_cast<char>(v >> 8) }; out.write(b, 2); }
+static void put_u32(std::ofstream& out, uint32_t v) { put_u16(out, static_cast<uint16_t>(v & 0xFFFF)); put_u16(out, static_cast<uint16_t>(v >> 16)); }
+
+WavWriter::WavWriter(const std::string& path, uint32_t sample_rate, uint16_t channels)
+    : out_(path, std::ios::binary), sample_rate_(sample_rate), channels_(channels), samples_written_(0) {
+    if (!out_) throw std::runtime_error("Failed to open WAV output: " + path);
+    write_header(0);
+    if (!out_) {
+        out_.close();
+        std::remove(path.c_str()); // no half-written header left behind
+        throw std::runtime_error("Failed to write WAV header: " + path);
+    }
+}
+
+WavWriter::~WavWriter() { close(); }
+
+void WavWriter::write_header(uint32_t data_bytes) {
+    out_.write("RIFF", 4); put_u32(out_, 36 + data_bytes);
+    out_.write("WAVE", 4);
+    out_.write("fmt ", 4); put_u32(out_, 16);
+    put_u16(out_, 1); // PCM
+    put_u16(out_, channels_);
+    put_u32(out_, sample_rate_);
+    put_u32(out_, sample_rate_ * channels_ * 2);
+    put_u16(out_, static_cast<uint16_t>(channels_ * 2));
+    put_u16(out_, 16);
+    out_.write("data", 4); put_u32(out_, data_bytes);
+}
+
+void WavWriter::write(const int16_t* samples, size_t count) {
+    TraceScope scope("wav_write", TraceCategory::Output, "samples", count);
+    // WAV is little-endian, as are all hosts we build for
+    out_.write(reinterpret_cast<const char*>(samples), static_cast<std::streamsize>(count * sizeof(int16_t)));
+    samples_written_ += count;
+}
+
+void WavWriter::close() {
+    if (!out_.is_open()) return;
+    out_.seekp(0);
+    write_header(static_cast<uint32_t>(samples_written_ * sizeof(int16_t)));
+    out_.close();
+}
@@ -0,0 +1,198 @@
+#include "nes/workloads.h"
+
+using namespace nes;
+
+namespace {
+using M = AddrMode;
+
+// Interrupts off, stack at $01FF, NMI and rendering off
+void prologue(Assembler& a) {
+    a.op("SEI").op("CLD").op("LDX", M::Immediate, 0xFF).op("TXS");
+    a.op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2000).op("STA", M::Absolute, 0x2001);
+}
+
+void load_palette(Assembler& a) {
+    a.op("BIT", M::Absolute, 0x2002);
+    a.op("LDA", M::Immediate, 0x3F).op("STA", M::Absolute, 0x2006).op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2006);
+    a.op("LDX", M::Immediate, 0x00);
+    a.label("palette_loop").op("LDA", M::AbsoluteX, "palette").op("STA", M::Absolute, 0x2007);
+    a.op("INX").op("CPX", M::Immediate, 32).op("BNE", M::Relative, "palette_loop");
+}
+
+void palette_table(Assembler& a) {
+    a.label("palette");
+    for (int i = 0; i < 8; ++i) a.data({ 0x0F, 0x16, 0x27, 0x18 });
+}
+
+// Tiles 0-3: blank, plane 0 solid, plane 1 solid, checkerboard in both planes
+std::vector<uint8_t> pattern_tiles() {
+    std::vector<uint8_t> chr(64, 0);
+    for (int row = 0; row < 8; ++row) {
+        chr[16 + row] = 0xFF;
+        chr[32 + 8 + row] = 0xFF;
+        chr[48 + row] = (row & 1) ? 0xAA : 0x55;
+        chr[48 + 8 + row] = (row & 1) ? 0x55 : 0xAA;
+    }
+    return chr;
+}
+
+// Shared tail: an RTI for unused vectors, then the image with `nmi` (or the RTI) wired up
+std::vector<uint8_t> link(Assembler& a, const char* nmi) {
+    a.label("rti").op("RTI");
+    RomBuilder rom;
+    rom.place(a).place_chr(0, pattern_tiles());
+    rom.vectors(a.address_of(nmi ? nmi : "rti"), a.origin(), a.address_of("rti"));
+    return rom.build();
+}
+
+std::vector<uint8_t> alu() {
+    Assembler a;
+    prologue(a);
+    a.op("LDA", M::Immediate, 0x00).op("STA", M::ZeroPage, 0x00);
+    a.label("outer").op("LDX", M::Immediate, 0x00);
+    a.label("inner");
+    a.op("TXA").op("CLC").op("ADC", M::ZeroPage, 0x00).op("ASL", M::Accumulator).op("ROL", M::Accumulator);
+    a.op("EOR", M::Immediate, 0x5A).op("AND", M::Immediate, 0xF0).op("ORA", M::Immediate, 0x0F);
+    a.op("SEC").op("SBC", M::Immediate, 0x11).op("LSR", M::Accumulator).op("ROR", M::Accumulator);
+    a.op("CMP", M::Immediate, 0x80).op("STA", M::ZeroPage, 0x00).op("TAY").op("INY").op("DEY");
+    a.op("INX").op("BNE", M::Relative, "inner");
+    a.op("INC", M::ZeroPage, 0x01).op("JMP", M::Absolute, "outer");
+    return link(a, nullptr);
+}
+
+std::vector<uint8_t> memory_bound() {
+    Assembler a;
+    prologue(a);
+    a.op("LDA", M::Immediate, 0x00).op("STA", M::ZeroPage, 0x10).op("LDA", M::Immediate, 0x02).op("STA", M::ZeroPage, 0x11);
+    a.label("loop").op("LDY", M::Immediate, 0x00);
+    a.label("copy");
+    a.op("LDA", M::IndirectY, 0x10).op("STA", M::AbsoluteY, 0x0300);
+    a.op("LDA", M::AbsoluteY, 0x0400).op("EOR", M::AbsoluteY, 0x0500).op("STA", M::AbsoluteY, 0x0600);
+    a.op("INY").op("BNE", M::Relative, "copy");
+    a.op("LDX", M::Immediate, 0x00);
+    a.label("sweep");
+    a.op("INC", M::AbsoluteX, 0x0700).op("DEC", M::AbsoluteX, 0x0200).op("LDA", M::ZeroPageX, 0x20).op("STA", M::ZeroPageX, 0x40);
+    a.op("INX").op("BNE", M::Relative, "sweep");
+    a.op("INC", M::ZeroPage, 0x11).op("LDA", M::ZeroPage, 0x11).op("AND", M::Immediate, 0x07).op("ORA", M::Immediate, 0x02);
+    a.op("STA", M::ZeroPage, 0x11).op("JMP", M::Absolute, "loop");
+    return link(a, nullptr);
+}
+
+std::vector<uint8_t> ppu_registers() {
+    Assembler a;
+    prologue(a);
+    a.label("loop").op("LDA", M::Absolute, 0x2002);
+    a.op("LDA", M::Immediate, 0x20).op("STA", M::Absolute, 0x2006).op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2006);
+    a.op("LDX", M::Immediate, 32);
+    a.label("write").op("STX", M::Absolute, 0x2007).op("DEX").op("BNE", M::Relative, "write");
+    a.op("LDA", M::Immediate, 0x20).op("STA", M::Absolute, 0x2006).op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2006);
+    a.op("LDA", M::Absolute, 0x2007).op("LDX", M::Immediate, 16); // first read only fills the buffer
+    a.label("read").op("LDA", M::Absolute, 0x2007).op("DEX").op("BNE", M::Relative, "read");
+    a.op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2005).op("STA", M::Absolute, 0x2005).op("STA", M::Absolute, 0x2003);
+    a.op("LDX", M::Immediate, 64);
+    a.label("oam").op("STX", M::Absolute, 0x2004).op("DEX").op("BNE", M::Relative, "oam");
+    a.op("JMP", M::Absolute, "loop");
+    return link(a, nullptr);
+}
+
+std::vector<uint8_t> sprites() {
+    Assembler a;
+    prologue(a);
+    load_palette(a);
+    // Shadow OAM at $0200: sprite n at (8n mod 256, 4n), tile 1 or 3, palette n mod 4
+    a.op("LDX", M::Immediate, 0x00);
+    a.label("init");
+    a.op("TXA").op("STA", M::AbsoluteX, 0x0200).op("ASL", M::Accumulator).op("STA", M::AbsoluteX, 0x0203);
+    a.op("TXA").op("LSR", M::Accumulator).op("LSR", M::Accumulator).op("AND", M::Immediate, 0x03).op("STA", M::AbsoluteX, 0x0202);
+    a.op("ORA", M::Immediate, 0x01).op("AND", M::Immediate, 0x03).op("STA", M::AbsoluteX, 0x0201);
+    a.op("INX").op("INX").op("INX").op("INX").op("BNE", M::Relative, "init");
+    a.op("LDA", M::Immediate, 0x80).op("STA", M::Absolute, 0x2000).op("LDA", M::Immediate, 0x1E).op("STA", M::Absolute, 0x2001);
+    a.label("main").op("INC", M::ZeroPage, 0x00).op("JMP", M::Absolute, "main");
+
+    a.label("nmi").op("PHA").op("TXA").op("PHA");
+    a.op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2003).op("LDA", M::Immediate, 0x02).op("STA", M::Absolute, 0x4014);
+    a.op("LDX", M::Immediate, 0x00);
+    a.label("move").op("INC", M::AbsoluteX, 0x0203).op("INC", M::AbsoluteX, 0x0200);
+    a.op("INX").op("INX").op("INX").op("INX").op("BNE", M::Relative, "move");
+    a.op("PLA").op("TAX").op("PLA").op("RTI");
+    palette_table(a);
+    return link(a, "nmi");
+}
+
+std::vector<uint8_t> scrolling() {
+    Assembler a;
+    prologue(a);
+    load_palette(a);
+    // Nametable 0 and its attributes: 1 KB of tiles 0-3 in sequence
+    a.op("LDA", M::Immediate, 0x20).op("STA", M::Absolute, 0x2006).op("LDA", M::Immediate, 0x00).op("STA", M::Absolute, 0x2006);
+    a.op("LDY", M::Immediate, 4).op("LDX", M::Immediate, 0x00);
+    a.label("fill").op("TXA").op("AND", M::Immediate, 0x03).op("STA", M::Absolute, 0x2007);
+    a.op("INX").op("BNE", M::Relative, "fill").op("DEY").op("BNE", M::Relative, "fill");
+    a.op("LDA", M::Immediate, 0x80).op("STA", M::Absolute, 0x2000).op("LDA", M::Immediate, 0x1E).op("STA", M::Absolute, 0x2001);
+    a.label("main").op("INC", M::ZeroPage, 0x01).op("JMP", M::Absolute, "main");
+
+    a.label("nmi").op("PHA");
+    a.op("INC", M::ZeroPage, 0x00).op("BIT", M::Absolute, 0x2002);
+    a.op("LDA", M::ZeroPage, 0x00).op("STA", M::Absolute, 0x2005).op("LSR", M::Accumulator).op("STA", M::Absolute, 0x2005);
+    a.op("LDA", M::Immediate, 0x80).op("STA", M::Absolute, 0x2000);
+    a.op("PLA").op("RTI");
+    palette_table(a);
+    return link(a, "nmi");
+}
+
+std::vector<uint8_t> apu_music() {
+    Assembler a;
+    prologue(a);
+    a.op("LDA", M::Immediate, 0x40).op("STA", M::Absolute, 0x4017);   // no frame IRQ
+    a.op("LDA", M::Immediate, 0x0F).op("STA", M::Absolute, 0x4015);
+    a.op("LDA", M::Immediate, 0xBF).op("STA", M::Absolute, 0x4000);   // duty 2, constant volume 15
+    a.op("LDA", M::Immediate, 0x7F).op("STA", M::Absolute, 0x4004);
+    a.op("LDA", M::Immediate, 0xFF).op("STA", M::Absolute, 0x4008);
+    a.op("LDA", M::Immediate, 0x3F).op("STA", M::Absolute, 0x400C);
+    a.op("LDA", M::Immediate, 0x80).op("STA", M::Absolute, 0x2000);
+    a.label("main").op("INC", M::ZeroPage, 0x02).op("JMP", M::Absolute, "main");
+
+    // Every 8th frame: next note on both pulses (pulse 2 a step behind), triangle and noise
+    a.label("nmi").op("PHA").op("TXA").op("PHA");
+    a.op("INC", M::ZeroPage, 0x00).op("LDA", M::ZeroPage, 0x00).op("AND", M::Immediate, 0x07).op("BNE", M::Relative, "done");
+    a.op("INC", M::ZeroPage, 0x01).op("LDA", M::ZeroPage, 0x01).op("AND", M::Immediate, 0x0F).op("TAX");
+    a.op("LDA", M::AbsoluteX, "notes_lo").op("STA", M::Absolute, 0x4002).op("STA", M::Absolute, 0x400A);
+    a.op("LDA", M::AbsoluteX, "notes_hi").op("STA", M::Absolute, 0x4003).op("STA", M::Absolute, 0x400B);
+    a.op("LDA", M::AbsoluteX, "notes_lo_prev").op("STA", M::Absolute, 0x4006);
+    a.op("LDA", M::AbsoluteX, "notes_hi_prev").op("STA", M::Absolute, 0x4007);
+    a.op("STX", M::Absolute, 0x400E).op("LDA", M::Immediate, 0x08).op("STA", M::Absolute, 0x400F);
+    a.label("done").op("PLA").op("TAX").op("PLA").op("RTI");
+
+    // C major up and down; high bytes carry length counter index 1
+    const std::vector<uint8_t> lo = { 0xAB, 0x7C, 0x52, 0x3F, 0x1C, 0xFD, 0xE1, 0xD5, 0xE1, 0xFD, 0x1C, 0x3F, 0x52, 0x7C, 0xAB, 0x7C };
+    const std::vector<uint8_t> hi = { 0x09, 0x09, 0x09, 0x09, 0x09, 0x08, 0x08, 0x08, 0x08, 0x08, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09 };
+    a.label("notes_lo").data(lo).label("notes_hi").data(hi);
+    a.label("notes_lo_prev").byte(lo.back()).data(std::vector<uint8_t>(lo.begin(), lo.end() - 1));
+    a.label("notes_hi_prev").byte(hi.back()).data(std::vector<uint8_t>(hi.begin(), hi.end() - 1));
+    return link(a, "nmi");
+}
+}
+
+const char* nes::workload_name(Workload workload) noexcept {
+    switch (workload) {
+        case Workload::Alu: return "alu";
+        case Workload::MemoryBound: return "memory";
+        case Workload::PpuRegisters: return "ppu_registers";
+        case Workload::Sprites: return "sprites";
+        case Workload::Scrolling: return "scrolling";
+        case Workload::ApuMusic: return "apu_music";
+    }
+    return "unknown";
+}
+
+std::vector<uint8_t> nes::build_workload(Workload workload) {
+    switch (workload) {
+        case Workload::Alu: return alu();
+        case Workload::MemoryBound: return memory_bound();
+        case Workload::PpuRegisters: return ppu_registers();
+        case Workload::Sprites: return sprites();
+        case Workload::Scrolling: return scrolling();
+        case Workload::ApuMusic: return apu_music();
+    }
+    return alu();
+}
@@ -0,0 +1,69 @@
+#include "test_util.h"
+#include "nes/emulator.h"
+#include "nes/workloads.h"
+
+using namespace nes;
+
+namespace {
+std::vector<uint8_t> snapshot(const Emulator& emu) {
+    std::vector<uint8_t> state(emu.state_size());
+    emu.save_state(state.data(), state.size());
+    return state;
+}
+
+// The writes each side makes: same pages on both, so every one has to unshare a page first
+void write_parent(Emulator& emu) {
+    emu.memory().internal_ram().write(0x0300, 0x11);
+    emu.memory().prg_ram().write(0x0100, 0x22);
+    emu.ppu().write_vram(0x2005, 0x33);
+}
+
+void write_child(Emulator& emu) {
+    emu.memory().internal_ram().write(0x0300, 0xA1);
+    emu.memory().internal_ram().write(0x0301, 0xA2);
+    emu.memory().prg_ram().write(0x0100, 0xB1);
+    emu.memory().prg_ram().write(0x0101, 0xB2);
+    emu.ppu().write_vram(0x2005, 0xC1);
+    emu.ppu().write_vram(0x2006, 0xC2);
+}
+
+void test_fork_writes_stay_private() {
+    const std::vector<uint8_t> rom = build_workload(Workload::Scrolling);
+    Emulator parent, reference;
+    parent.load_rom_bytes(rom);
+    reference.load_rom_bytes(rom);
+    for (int i = 0; i < 5; ++i) { parent.run_frame(); reference.run_frame(); }
+
+    std::unique_ptr<Emulator> child = parent.clone();
+    CHECK(snapshot(*child) == snapshot(parent));
+
+    write_parent(parent);
+    write_parent(reference);
+    write_child(*child);
+
+    CHECK(parent.memory().internal_ram().read(0x0300) == 0x11);
+    CHECK(parent.memory().prg_ram().read(0x0100) == 0x22);
+    CHECK(parent.ppu().read_vram(0x2005) == 0x33);
+    CHECK(child->memory().internal_ram().read(0x0300) == 0xA1);
+    CHECK(child->memory().prg_ram().read(0x0100) == 0xB1);
+    CHECK(child->ppu().read_vram(0x2005) == 0xC1);
+    // Neighbours on the same pages keep the value from before the fork on the side that didn't write them
+    CHECK(parent.memory().internal_ram().read(0x0301) == reference.memory().internal_ram().read(0x0301));
+    CHECK(parent.memory().prg_ram().read(0x0101) == reference.memory().prg_ram().read(0x0101));
+    CHECK(parent.ppu().read_vram(0x2006) == reference.ppu().read_vram(0x2006));
+
+    // The parent is exactly an instance that never forked, now and after running on
+    CHECK(snapshot(parent) == snapshot(reference));
+    for (int i = 0; i < 5; ++i) { parent.run_frame(); child->run_frame(); reference.run_frame(); }
+    CHECK(snapshot(parent) == snapshot(reference));
+    child.reset();
+    parent.run_frame();
+    reference.run_frame();
+    CHECK(snapshot(parent) == snapshot(reference)); // pages outlive the fork that shared them
+}
+}
+
+int main() {
+    test_fork_writes_stay_private();
+    return nes_test::result("clone");
+}
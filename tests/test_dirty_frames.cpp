@@ -0,0 +1,50 @@
+#include "test_util.h"
+#include "nes/emulator.h"
+#include "nes/workloads.h"
+
+using namespace nes;
+
+namespace {
+// Each consumer keeps its own copy and generation; the copies must always match the full frame
+void test_consumers_track_changes_independently() {
+    Emulator emu;
+    emu.load_rom_bytes(build_workload(Workload::Scrolling));
+    std::vector<uint8_t> every_frame, every_third, full;
+    std::vector<DirtyRect> dirty;
+    uint64_t every_frame_seen = 0, every_third_seen = 0;
+    for (int i = 0; i < 30; ++i) {
+        emu.run_frame();
+        emu.ppu().render_frame(full); // full copies leave the incremental consumers alone
+        emu.ppu().render_frame(every_frame, dirty, every_frame_seen);
+        CHECK(every_frame == full);
+        if (i == 0) CHECK(dirty.size() == 1 && dirty[0].width == 256 && dirty[0].height == 240);
+        for (const DirtyRect& r : dirty) CHECK(r.x % 8 == 0 && r.y % 8 == 0 && r.x + r.width <= 256 && r.y + r.height <= 240);
+        if (i % 3 == 2) {
+            emu.ppu().render_frame(every_third, dirty, every_third_seen);
+            CHECK(every_third == full);
+        }
+    }
+    // Nothing drawn since the last publish: nothing to copy
+    emu.ppu().render_frame(every_frame, dirty, every_frame_seen);
+    CHECK(dirty.empty());
+}
+
+void test_fresh_buffer_gets_whole_frame() {
+    Emulator emu;
+    emu.load_rom_bytes(build_workload(Workload::Sprites));
+    for (int i = 0; i < 5; ++i) emu.run_frame();
+    std::vector<uint8_t> full, late;
+    std::vector<DirtyRect> dirty;
+    uint64_t seen = 12345; // stale, but the empty buffer forces a full copy
+    emu.ppu().render_frame(full);
+    emu.ppu().render_frame(late, dirty, seen);
+    CHECK(late == full);
+    CHECK(dirty.size() == 1);
+}
+}
+
+int main() {
+    test_consumers_track_changes_independently();
+    test_fresh_buffer_gets_whole_frame();
+    return nes_test::result("dirty_frames");
+}
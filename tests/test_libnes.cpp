@@ -0,0 +1,101 @@
+#include "test_util.h"
+#include "nes/libnes.h"
+#include <cstring>
+
+// Through the exported C functions only, as an FFI caller would see them
+namespace {
+constexpr size_t samples_per_frame = NES_AUDIO_SAMPLE_RATE / 60; // NTSC is a little under 60 Hz
+
+bool about_one_frame(size_t samples) { return samples >= samples_per_frame - 2 && samples <= samples_per_frame + 16; }
+
+void test_errors_without_rom() {
+    CHECK(nes_abi_version() == NES_ABI_VERSION);
+    CHECK(nes_run_frames(nullptr, 1, nullptr) == NES_ERROR_ARGUMENT);
+    nes_instance* nes = nes_create();
+    CHECK(nes != nullptr);
+    CHECK(nes_run_frames(nes, 1, nullptr) == NES_ERROR_NOT_LOADED);
+    CHECK(std::strlen(nes_last_error(nes)) > 0);
+    CHECK(nes_get_frame_ptr(nes) == nullptr);
+    CHECK(nes_state_size(nes) == 0);
+    const uint8_t junk[16] = {};
+    CHECK(nes_load_rom(nes, junk, sizeof(junk)) == NES_ERROR_ROM);
+    CHECK(nes_load_rom(nes, nullptr, 0) == NES_ERROR_ARGUMENT);
+    nes_destroy(nes);
+}
+
+void test_run_frames_returns_every_frames_audio() {
+    nes_instance* nes = nes_create();
+    const std::vector<uint8_t> rom = nes_test::counter_rom();
+    CHECK(nes_load_rom(nes, rom.data(), rom.size()) == NES_OK);
+    CHECK(std::strlen(nes_last_error(nes)) == 0);
+    const uint8_t* frame = nes_get_frame_ptr(nes);
+    CHECK(frame != nullptr);
+
+    size_t samples = 0;
+    CHECK(nes_run_frames(nes, 1, nullptr) == NES_OK);
+    nes_get_audio_ptr(nes, &samples);
+    CHECK(about_one_frame(samples));
+    CHECK(nes_run_frames(nes, 10, nullptr) == NES_OK);
+    nes_get_audio_ptr(nes, &samples);
+    CHECK(samples >= 10 * (samples_per_frame - 2) && samples <= 10 * (samples_per_frame + 16)); // ten frames, not the last one
+    CHECK(nes_frame_count(nes) == 11);
+    CHECK(nes_get_frame_ptr(nes) == frame); // stable between loads
+    nes_destroy(nes);
+}
+
+void test_state_round_trip_keeps_audio_in_step() {
+    nes_instance* nes = nes_create();
+    const std::vector<uint8_t> rom = nes_test::counter_rom();
+    nes_load_rom(nes, rom.data(), rom.size());
+    nes_run_frames(nes, 5, nullptr);
+    std::vector<uint8_t> state(nes_state_size(nes));
+    CHECK(nes_save_state(nes, state.data(), state.size() - 1) == 0);
+    CHECK(nes_save_state(nes, state.data(), state.size()) == state.size());
+
+    nes_run_frames(nes, 10, nullptr);
+    CHECK(nes_load_state(nes, state.data(), state.size()) == NES_OK);
+    CHECK(nes_frame_count(nes) == 5);
+    size_t samples = 0;
+    CHECK(nes_run_frames(nes, 1, nullptr) == NES_OK);
+    nes_get_audio_ptr(nes, &samples);
+    CHECK(about_one_frame(samples)); // not a rewound gap's worth of silence
+
+    // Loading a later state after an earlier one: again just the one frame
+    nes_run_frames(nes, 20, nullptr);
+    std::vector<uint8_t> later(state.size());
+    nes_save_state(nes, later.data(), later.size());
+    nes_load_state(nes, state.data(), state.size());
+    CHECK(nes_load_state(nes, later.data(), later.size()) == NES_OK);
+    nes_run_frames(nes, 1, nullptr);
+    nes_get_audio_ptr(nes, &samples);
+    CHECK(about_one_frame(samples));
+
+    state[0] ^= 0xFF;
+    CHECK(nes_load_state(nes, state.data(), state.size()) == NES_ERROR_STATE);
+    CHECK(nes_load_state(nes, nullptr, 0) == NES_ERROR_ARGUMENT);
+    nes_destroy(nes);
+}
+
+void test_step_many_reports_each_instance() {
+    nes_instance* loaded = nes_create();
+    nes_instance* empty = nes_create();
+    const std::vector<uint8_t> rom = nes_test::counter_rom();
+    nes_load_rom(loaded, rom.data(), rom.size());
+    nes_instance* const instances[3] = { loaded, empty, loaded };
+    int statuses[3] = { 1, 1, 1 };
+    CHECK(nes_step_many(instances, 3, 2, nullptr, statuses) == NES_ERROR_NOT_LOADED);
+    CHECK(statuses[0] == NES_OK && statuses[1] == NES_ERROR_NOT_LOADED && statuses[2] == NES_OK);
+    CHECK(nes_frame_count(loaded) == 4); // the failure in between did not stop the rest
+    CHECK(nes_step_many(nullptr, 1, 1, nullptr, nullptr) == NES_ERROR_ARGUMENT);
+    nes_destroy(loaded);
+    nes_destroy(empty);
+}
+}
+
+int main() {
+    test_errors_without_rom();
+    test_run_frames_returns_every_frames_audio();
+    test_state_round_trip_keeps_audio_in_step();
+    test_step_many_reports_each_instance();
+    return nes_test::result("libnes");
+}
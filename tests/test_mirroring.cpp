@@ -0,0 +1,86 @@
+#include "test_util.h"
+#include "nes/emulator.h"
+
+using namespace nes;
+
+namespace {
+std::vector<uint8_t> rom_with(bool vertical) {
+    Assembler a(0x8000);
+    a.label("reset").op("JMP", AddrMode::Absolute, "reset");
+    RomSpec spec;
+    spec.vertical_mirroring = vertical;
+    return RomBuilder(spec).place(a).vectors(a.address_of("reset"), a.address_of("reset"), a.address_of("reset")).build();
+}
+
+// The nametable slot ($2000 + slot * $400) that a write to `from` shows up in, for each slot
+bool mirrors(PPU& ppu, uint16_t from, uint16_t to) {
+    ppu.write_vram(from, 0);
+    ppu.write_vram(to, 0);
+    ppu.write_vram(from, 0x5A);
+    return ppu.read_vram(to) == 0x5A;
+}
+
+void test_header_mirroring() {
+    Emulator horizontal, vertical;
+    horizontal.load_rom_bytes(rom_with(false));
+    vertical.load_rom_bytes(rom_with(true));
+    CHECK(horizontal.ppu().mirroring() == Mirroring::Horizontal);
+    CHECK(mirrors(horizontal.ppu(), 0x2000, 0x2400) && mirrors(horizontal.ppu(), 0x2800, 0x2C00));
+    CHECK(!mirrors(horizontal.ppu(), 0x2000, 0x2800));
+    CHECK(vertical.ppu().mirroring() == Mirroring::Vertical);
+    CHECK(mirrors(vertical.ppu(), 0x2000, 0x2800) && mirrors(vertical.ppu(), 0x2400, 0x2C00));
+    CHECK(!mirrors(vertical.ppu(), 0x2000, 0x2400));
+}
+
+void test_switching_keeps_vram() {
+    Emulator emu;
+    emu.load_rom_bytes(rom_with(false));
+    PPU& ppu = emu.ppu();
+    ppu.write_vram(0x2005, 0x11); // page 0
+    ppu.write_vram(0x2805, 0x22); // page 1 under horizontal mirroring
+    ppu.set_mirroring(Mirroring::SingleScreenB);
+    CHECK(ppu.read_vram(0x2005) == 0x22 && ppu.read_vram(0x2C05) == 0x22);
+    ppu.set_mirroring(Mirroring::SingleScreenA);
+    CHECK(ppu.read_vram(0x2405) == 0x11 && ppu.read_vram(0x2805) == 0x11);
+    ppu.set_mirroring(Mirroring::FourScreen);
+    CHECK(!mirrors(ppu, 0x2000, 0x2400) && !mirrors(ppu, 0x2400, 0x2800) && !mirrors(ppu, 0x2800, 0x2C00));
+    CHECK(mirrors(ppu, 0x2000, 0x3000)); // $3000-$3EFF repeats $2000-$2EFF
+}
+
+void test_map_nametable_stays_in_vram() {
+    Emulator emu;
+    emu.load_rom_bytes(rom_with(false));
+    PPU& ppu = emu.ppu();
+    ppu.map_nametable(1, 3);
+    CHECK(ppu.state().nametable_pages_[1] == 3);
+    ppu.map_nametable(5, 0xFF); // slot and page are both masked to 0-3
+    CHECK(ppu.state().nametable_pages_[1] == 3);
+    CHECK(PPU::valid_state(ppu.state()));
+    ppu.map_nametable(2, 1);
+    CHECK(mirrors(ppu, 0x2400 + 0x10, 0x2800 + 0x10) == false); // slot 1 now shows page 3, slot 2 page 1
+    CHECK(mirrors(ppu, 0x2800, 0x2C00));
+}
+
+// The page table travels with save states and comes back exactly
+void test_mapping_survives_save_state() {
+    Emulator emu;
+    emu.load_rom_bytes(rom_with(true));
+    emu.ppu().map_nametable(0, 2);
+    emu.ppu().write_vram(0x2000, 0x77);
+    std::vector<uint8_t> state(emu.state_size());
+    CHECK(emu.save_state(state.data(), state.size()) == state.size());
+    emu.ppu().set_mirroring(Mirroring::Vertical);
+    CHECK(emu.ppu().read_vram(0x2000) != 0x77);
+    CHECK(emu.load_state(state.data(), state.size()));
+    CHECK(emu.ppu().state().nametable_pages_[0] == 2);
+    CHECK(emu.ppu().read_vram(0x2000) == 0x77);
+}
+}
+
+int main() {
+    test_header_mirroring();
+    test_switching_keeps_vram();
+    test_map_nametable_stays_in_vram();
+    test_mapping_survives_save_state();
+    return nes_test::result("mirroring");
+}
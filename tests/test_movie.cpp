@@ -0,0 +1,108 @@
+#include "test_util.h"
+#include "nes/input.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace nes;
+
+namespace {
+// Buttons derived from the frame number, so every recorded byte is checkable
+class CountingInput : public InputProvider {
+public:
+    void poll(uint64_t frame, std::array<uint8_t, 2>& pads) override {
+        pads[0] = static_cast<uint8_t>(frame * 3);
+        pads[1] = static_cast<uint8_t>(frame * 7 + 1);
+    }
+};
+
+template <typename F>
+bool throws(F body) {
+    try { body(); } catch (const std::exception&) { return true; }
+    return false;
+}
+
+void test_record_save_load_play() {
+    CountingInput source;
+    MovieRecorder recorder(source, 2, 4); // grows past the reservation
+    std::array<uint8_t, 2> pads{};
+    for (uint64_t frame = 0; frame < 100; ++frame) recorder.poll(frame, pads);
+    for (uint64_t frame = 50; frame < 60; ++frame) recorder.poll(frame, pads); // rolled back and re-run
+    CHECK(!recorder.truncated());
+    CHECK(recorder.movie().frame_count() == 60);
+
+    const std::string path = "test_movie.nmv";
+    recorder.movie().save(path);
+    const Movie loaded = Movie::load(path);
+    CHECK(loaded.ports == 2);
+    CHECK(loaded.frames == recorder.movie().frames);
+
+    MoviePlayer player(loaded);
+    for (uint64_t frame = 0; frame < 60; ++frame) {
+        player.poll(frame, pads);
+        CHECK(pads[0] == static_cast<uint8_t>(frame * 3) && pads[1] == static_cast<uint8_t>(frame * 7 + 1));
+    }
+    CHECK(!player.finished(59) && player.finished(60));
+    player.poll(60, pads);
+    CHECK(pads[0] == 0 && pads[1] == 0); // past the end
+    std::remove(path.c_str());
+}
+
+void test_rejects_bad_files() {
+    const std::string path = "test_movie_bad.nmv";
+    Movie movie;
+    movie.ports = 1;
+    movie.frames.assign(10, 0x55);
+    movie.save(path);
+
+    // Cut short: one frame missing
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    auto write = [&](const std::vector<char>& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+    write(std::vector<char>(bytes.begin(), bytes.end() - 1));
+    CHECK(throws([&] { Movie::load(path); }));
+
+    // A 12-byte header claiming 4 billion frames is rejected before anything is allocated for them
+    std::vector<char> huge(bytes.begin(), bytes.begin() + 12);
+    huge[8] = huge[9] = huge[10] = huge[11] = static_cast<char>(0xFF);
+    write(huge);
+    CHECK(throws([&] { Movie::load(path); }));
+
+    std::vector<char> ports = bytes;
+    ports[6] = 3;
+    write(ports);
+    CHECK(throws([&] { Movie::load(path); }));
+
+    std::vector<char> magic = bytes;
+    magic[0] = 'X';
+    write(magic);
+    CHECK(throws([&] { Movie::load(path); }));
+
+    write(bytes);
+    CHECK(Movie::load(path).frame_count() == 10);
+    std::remove(path.c_str());
+}
+
+void test_recorder_rejects_bad_ports() {
+    CountingInput source;
+    CHECK(throws([&] { MovieRecorder recorder(source, 0); }));
+    CHECK(throws([&] { MovieRecorder recorder(source, 3); }));
+    MovieRecorder one(source, 1, 0);
+    std::array<uint8_t, 2> pads{};
+    one.poll(0, pads);
+    CHECK(one.movie().frames.size() == 1);
+}
+}
+
+int main() {
+    test_record_save_load_play();
+    test_rejects_bad_files();
+    test_recorder_rejects_bad_ports();
+    return nes_test::result("movie");
+}
@@ -0,0 +1,85 @@
+#include "test_util.h"
+#include "nes/nsf.h"
+#include <cstring>
+
+using namespace nes;
+
+namespace {
+std::vector<uint8_t> nsf_image(uint16_t load, const std::array<uint8_t, 8>& banks, size_t payload) {
+    std::vector<uint8_t> data(0x80 + payload, 0);
+    std::memcpy(data.data(), "NESM\x1A", 5);
+    data[5] = 1;
+    data[6] = 3;    // songs
+    data[7] = 2;    // starting song
+    data[8] = static_cast<uint8_t>(load);
+    data[9] = static_cast<uint8_t>(load >> 8);
+    data[0x0A] = 0x00; data[0x0B] = 0x90; // init $9000
+    data[0x0C] = 0x03; data[0x0D] = 0x90; // play $9003
+    std::memcpy(&data[0x0E], "Test Tune", 9);
+    std::memcpy(&data[0x2E], "Someone", 7);
+    data[0x6E] = 0x1A; data[0x6F] = 0x41; // 16666 us
+    std::copy(banks.begin(), banks.end(), data.begin() + 0x70);
+    for (size_t i = 0; i < payload; ++i) data[0x80 + i] = static_cast<uint8_t>(i / 0x100 + i);
+    return data;
+}
+
+bool rejected(const std::vector<uint8_t>& data) {
+    try { NsfLoader loader(data); } catch (const std::runtime_error&) { return true; }
+    return false;
+}
+
+void test_header() {
+    const std::vector<uint8_t> data = nsf_image(0x8000, {}, 0x100);
+    NsfLoader nsf(data);
+    const NsfHeader& h = nsf.get_header();
+    CHECK(h.version == 1 && h.total_songs == 3 && h.starting_song == 2);
+    CHECK(h.load_address == 0x8000 && h.init_address == 0x9000 && h.play_address == 0x9003);
+    CHECK(h.name == "Test Tune" && h.artist == "Someone" && h.copyright.empty());
+    CHECK(nsf.play_period_us() == 16666);
+    CHECK(!nsf.is_pal() && !nsf.is_bankswitched());
+}
+
+void test_flat_image() {
+    const std::vector<uint8_t> data = nsf_image(0x8234, {}, 0x2000);
+    NsfLoader nsf(data);
+    CHECK(nsf.image_size() == 0x8000);
+    for (int slot = 0; slot < 8; ++slot) CHECK(nsf.initial_bank(slot) == slot);
+    CHECK(nsf.get_bank(0)[0x234] == data[0x80]);            // $8234
+    CHECK(nsf.get_bank(2)[0x233] == data[0x80 + 0x1FFF]);   // $A233, the last payload byte
+    CHECK(nsf.get_bank(2)[0x234] == 0);
+}
+
+void test_bankswitched_image() {
+    const std::array<uint8_t, 8> banks = { 0, 1, 2, 0, 1, 2, 0, 1 };
+    const std::vector<uint8_t> data = nsf_image(0x8100, banks, 0x1500);
+    NsfLoader nsf(data);
+    CHECK(nsf.is_bankswitched());
+    CHECK(nsf.image_size() == 2 * 0x1000); // $100 of padding + $1500 of payload
+    CHECK(nsf.initial_bank(2) == 2 && nsf.initial_bank(7) == 1);
+    CHECK(nsf.get_bank(0)[0x100] == data[0x80]);             // payload starts at the load address' offset
+    CHECK(nsf.get_bank(1)[0] == data[0x80 + 0xF00]);
+    CHECK(nsf.get_bank(2) == nsf.get_bank(0));               // past the end wraps
+}
+
+void test_rejects_bad_files() {
+    CHECK(rejected(std::vector<uint8_t>(0x7F, 0)));
+    std::vector<uint8_t> data = nsf_image(0x8000, {}, 0x100);
+    data[0] = 'X';
+    CHECK(rejected(data));
+    data = nsf_image(0x8000, {}, 0x100);
+    data[6] = 0;
+    CHECK(rejected(data)); // no songs
+    CHECK(rejected(nsf_image(0x6000, {}, 0x100))); // flat image below $8000
+    // No payload: a bankswitched tune would have no banks to map
+    CHECK(rejected(nsf_image(0x8000, { 0, 1, 0, 0, 0, 0, 0, 0 }, 0)));
+    CHECK(rejected(nsf_image(0x8000, {}, 0)));
+}
+}
+
+int main() {
+    test_header();
+    test_flat_image();
+    test_bankswitched_image();
+    test_rejects_bad_files();
+    return nes_test::result("nsf");
+}
@@ -0,0 +1,75 @@
+#include "test_util.h"
+#include "nes/emulator.h"
+#include <set>
+
+using namespace nes;
+
+namespace {
+// Fills $0200-$02FF with 0..255, then DMAs page 2 with 0, 2 and 5 cycles between transfers so both
+// start parities come up
+std::vector<uint8_t> dma_rom() {
+    using M = AddrMode;
+    Assembler a(0x8000);
+    a.label("reset").op("SEI").op("LDX", M::Immediate, 0xFF).op("TXS");
+    a.op("LDX", M::Immediate, 0);
+    a.label("fill").op("TXA").op("STA", M::AbsoluteX, 0x0200).op("INX").op("BNE", M::Relative, "fill");
+    a.op("LDA", M::Immediate, 0x02);
+    a.label("loop").op("STA", M::Absolute, 0x4014).op("NOP").op("STA", M::Absolute, 0x4014);
+    a.op("INC", M::ZeroPage, 0x10).op("STA", M::Absolute, 0x4014).op("JMP", M::Absolute, "loop");
+    a.label("nmi").op("RTI");
+    return RomBuilder().place(a).vectors(a.address_of("nmi"), a.address_of("reset"), a.address_of("nmi")).build();
+}
+
+bool at_dma_write(Emulator& emu) {
+    const uint16_t pc = emu.cpu().registers().program_counter_;
+    const Memory& mem = emu.memory();
+    return mem.read(pc) == 0x8D && mem.read(static_cast<uint16_t>(pc + 1)) == 0x14 && mem.read(static_cast<uint16_t>(pc + 2)) == 0x40; // STA $4014
+}
+
+void test_stall_is_513_or_514_cycles() {
+    Emulator emu;
+    emu.load_rom_bytes(dma_rom());
+    emu.clear_metrics();
+    std::set<uint64_t> stalls;
+    uint64_t stalled = 0;
+    for (int steps = 0; steps < 5000 && stalls.size() < 2; ++steps) {
+        const bool dma = at_dma_write(emu);
+        const uint64_t before = emu.scheduler().now();
+        const int cycles = emu.step();
+        if (!dma) continue;
+        CHECK(cycles == 4);
+        const uint64_t stall = emu.scheduler().now() - before - 4;
+        CHECK(stall == 513 + ((before + 4) & 1)); // one extra alignment cycle when it starts on an odd cycle
+        stalls.insert(stall);
+        stalled += stall;
+    }
+    CHECK(stalls == (std::set<uint64_t>{ 513, 514 }));
+
+    // The page went to OAM in one block, starting at OAMADDR 0
+    bool copied = true;
+    for (int i = 0; i < 256; ++i) copied &= emu.ppu().state().oam_[i] == i;
+    CHECK(copied);
+
+    // step() work is published with the next run call; no further DMA falls in a one-cycle run
+    emu.run_cycles(1);
+    CHECK(emu.metrics().dma_stall_cycles == stalled);
+}
+
+void test_stall_counts_in_a_frame() {
+    Emulator emu;
+    emu.load_rom_bytes(dma_rom());
+    emu.run_frame();
+    emu.clear_metrics();
+    emu.run_frame();
+    const MetricsSnapshot m = emu.metrics();
+    // About 29780 cycles a frame, nearly all of it stalled: roughly 57 transfers
+    CHECK(m.dma_stall_cycles > 50 * 513 && m.dma_stall_cycles < m.cpu_cycles);
+    CHECK(m.dma_stall_cycles % 513 <= m.dma_stall_cycles / 513); // every transfer is 513 or 514
+}
+}
+
+int main() {
+    test_stall_is_513_or_514_cycles();
+    test_stall_counts_in_a_frame();
+    return nes_test::result("oam_dma");
+}
@@ -0,0 +1,65 @@
+#include "test_util.h"
+#include "nes/regression.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace nes;
+
+namespace {
+void test_xxh64_reference_values() {
+    CHECK(xxh64("", 0) == 0xEF46DB3751D8E999ull);
+    CHECK(xxh64("a", 1) == 0xD24EC4F1A98C6E5Bull);
+    CHECK(xxh64("abc", 3) == 0x44BC2CF5AD770999ull);
+    // Past the 32-byte stripe loop, the same bytes hash the same wherever they start
+    std::vector<uint8_t> bytes(101);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 7);
+    std::vector<uint8_t> shifted(bytes.size() + 3);
+    std::memcpy(shifted.data() + 3, bytes.data(), bytes.size());
+    CHECK(xxh64(bytes.data(), bytes.size()) == xxh64(shifted.data() + 3, bytes.size()));
+    CHECK(xxh64(bytes.data(), bytes.size()) != xxh64(bytes.data(), bytes.size(), 1));
+}
+
+bool load_throws(const std::string& path) {
+    try { HashLog::load(path); } catch (const std::runtime_error&) { return true; }
+    return false;
+}
+
+void test_hash_log_round_trip_and_truncation() {
+    const std::string path = "test_regression.nhsh";
+    HashLog log;
+    log.frames = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+    log.save(path);
+    const HashLog loaded = HashLog::load(path);
+    CHECK(loaded.frames.size() == 3);
+    CHECK(first_divergence(loaded, log) == -1);
+
+    // A header claiming ~4 billion frames over a short body is rejected without allocating for them
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    const uint32_t huge = 0xFFFFFFFFu;
+    file.seekp(8);
+    file.write(reinterpret_cast<const char*>(&huge), 4);
+    file.close();
+    CHECK(load_throws(path));
+    std::remove(path.c_str());
+}
+
+void test_first_divergence() {
+    HashLog a, b;
+    a.frames = { { 1, 1 }, { 2, 2 }, { 3, 3 } };
+    b.frames = a.frames;
+    CHECK(first_divergence(a, b) == -1);
+    b.frames[1].audio = 9;
+    CHECK(first_divergence(a, b) == 1);
+    b.frames = { { 1, 1 } };
+    CHECK(first_divergence(a, b) == 1); // golden ends early
+}
+}
+
+int main() {
+    test_xxh64_reference_values();
+    test_hash_log_round_trip_and_truncation();
+    test_first_divergence();
+    return nes_test::result("regression");
+}
@@ -0,0 +1,81 @@
+#include "test_util.h"
+#include "nes/rewind.h"
+#include "nes/workloads.h"
+
+using namespace nes;
+
+namespace {
+std::vector<uint8_t> snapshot(const Emulator& emu) {
+    std::vector<uint8_t> state(emu.state_size());
+    emu.save_state(state.data(), state.size());
+    return state;
+}
+
+// Records frames into a ring too small for all of them, then checks every restored frame (across
+// keyframes and the eviction boundary) against a full save state taken at that frame.
+void test_restores_match_save_states() {
+    const int recorded = 60;
+    Emulator emu;
+    emu.load_rom_bytes(build_workload(Workload::Sprites));
+
+    RewindBuffer probe(RewindConfig{ 64 * 1024 * 1024, 8 });
+    probe.push(emu);
+    const size_t keyframe_size = probe.memory_used();
+    RewindConfig config;
+    config.memory_budget = keyframe_size * 4;
+    config.keyframe_interval = 8;
+    RewindBuffer rewind(config);
+
+    std::vector<std::vector<uint8_t>> states;
+    for (int f = 0; f < recorded; ++f) {
+        emu.run_frame();
+        states.push_back(snapshot(emu));
+        rewind.push(emu);
+        CHECK(rewind.memory_used() <= config.memory_budget);
+    }
+    const size_t kept = rewind.frames();
+    CHECK(kept < static_cast<size_t>(recorded));             // the oldest segments were evicted
+    CHECK(kept > config.keyframe_interval);                  // but at least one whole segment survived
+
+    // Step back a few frames, then run forward again over the same frames: the re-recorded
+    // entries reuse the ring space the stepped-back ones freed
+    int frame = recorded - 1;
+    for (int i = 0; i < 11; ++i) {
+        CHECK(rewind.step_back(emu));
+        --frame;
+        CHECK(snapshot(emu) == states[frame]);
+    }
+    while (frame < recorded - 1) {
+        emu.run_frame();
+        ++frame;
+        CHECK(snapshot(emu) == states[frame]);
+        rewind.push(emu);
+    }
+    CHECK(rewind.frames() == kept);
+
+    // All the way back to the oldest surviving frame
+    while (rewind.step_back(emu)) {
+        --frame;
+        CHECK(snapshot(emu) == states[frame]);
+    }
+    CHECK(rewind.frames() == 1);
+    CHECK(frame == recorded - static_cast<int>(kept));
+    CHECK(!rewind.step_back(emu));
+}
+
+void test_budget_below_one_snapshot_keeps_nothing() {
+    Emulator emu;
+    emu.load_rom_bytes(build_workload(Workload::Alu));
+    RewindBuffer rewind(RewindConfig{ 16, 4 });
+    emu.run_frame();
+    rewind.push(emu);
+    CHECK(rewind.frames() == 0 && rewind.memory_used() == 0);
+    CHECK(!rewind.step_back(emu));
+}
+}
+
+int main() {
+    test_restores_match_save_states();
+    test_budget_below_one_snapshot_keeps_nothing();
+    return nes_test::result("rewind");
+}
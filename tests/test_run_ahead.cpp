@@ -0,0 +1,50 @@
+#include "test_util.h"
+#include "nes/cow_memory.h"
+#include "nes/emulator.h"
+#include "nes/workloads.h"
+
+using namespace nes;
+
+namespace {
+void test_cow_sync_shares_only_changed_pages() {
+    CowMemory<0x1000> a, b;
+    a.write(0x000, 1);
+    a.write(0xC00, 2);
+    CHECK(b.sync_from(a) == 2); // the two pages a made private
+    CHECK(b.read(0x000) == 1 && b.read(0xC00) == 2);
+    CHECK(b.sync_from(a) == 0); // already shared
+    a.write(0x400, 3);          // a copies the page it writes, b keeps the old one
+    CHECK(b.read(0x400) == 0);
+    CHECK(b.sync_from(a) == 1);
+    CHECK(b.read(0x400) == 3);
+    b.write(0x000, 9);          // writes after a sync never leak into the source
+    CHECK(a.read(0x000) == 1);
+}
+
+std::vector<uint8_t> presented(Emulator& emu) {
+    std::vector<uint8_t> rgb(256 * 240 * 3);
+    emu.presented_ppu().copy_frame(rgb.data());
+    return rgb;
+}
+
+void test_shadow_matches_single_instance() {
+    Emulator single, shadow;
+    single.load_rom_bytes(build_workload(Workload::Sprites));
+    shadow.load_rom_bytes(build_workload(Workload::Sprites));
+    single.set_run_ahead(2, false);
+    shadow.set_run_ahead(2, true);
+    for (int i = 0; i < 20; ++i) {
+        single.run_frame_ahead();
+        shadow.run_frame_ahead();
+        CHECK(single.frame_count() == shadow.frame_count());
+        CHECK(single.memory().internal_ram().read(0x10) == shadow.memory().internal_ram().read(0x10));
+        CHECK(presented(single) == presented(shadow));
+    }
+}
+}
+
+int main() {
+    test_cow_sync_shares_only_changed_pages();
+    test_shadow_matches_single_instance();
+    return nes_test::result("run_ahead");
+}
@@ -0,0 +1,216 @@
+#include "test_util.h"
+#include "nes/emulator.h"
+#include "nes/save_state.h"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using namespace nes;
+
+namespace {
+// Payload of the first block with `tag`, or null
+uint8_t* find_block(std::vector<uint8_t>& state, StateBlock tag) {
+    size_t pos = sizeof(SaveStateHeader);
+    while (pos + sizeof(SaveStateBlock) <= state.size()) {
+        SaveStateBlock block;
+        std::memcpy(&block, state.data() + pos, sizeof(block));
+        if (block.tag == static_cast<uint32_t>(tag)) return state.data() + pos + sizeof(block);
+        pos += sizeof(block) + block.size;
+    }
+    return nullptr;
+}
+
+std::vector<uint8_t> save(const Emulator& emu) {
+    std::vector<uint8_t> state(emu.state_size());
+    CHECK(emu.save_state(state.data(), state.size()) == state.size());
+    return state;
+}
+
+void test_round_trip() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    emu.run_frame();
+    std::vector<uint8_t> state = save(emu);
+    const uint8_t counter = emu.memory().internal_ram().read(0x10);
+    const uint64_t frames = emu.frame_count();
+
+    emu.run_frame();
+    CHECK(emu.memory().internal_ram().read(0x10) != counter);
+    CHECK(emu.load_state(state.data(), state.size()));
+    CHECK(emu.memory().internal_ram().read(0x10) == counter);
+    CHECK(emu.frame_count() == frames);
+    CHECK(save(emu) == state); // restoring is exact
+}
+
+void test_rejects_mismatches() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    const std::vector<uint8_t> good = save(emu);
+
+    std::vector<uint8_t> state = good;
+    SaveStateHeader header;
+    std::memcpy(&header, state.data(), sizeof(header));
+    header.version = save_state_version - 1;
+    std::memcpy(state.data(), &header, sizeof(header));
+    CHECK(!emu.load_state(state.data(), state.size()));
+
+    CHECK(!emu.load_state(good.data(), good.size() - 1)); // truncated
+
+    Emulator other;
+    other.load_rom_bytes(nes_test::counter_rom(1));
+    CHECK(!other.load_state(good.data(), good.size())); // same shape, different game
+}
+
+void test_rejects_bad_prg_offsets() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    const std::vector<uint8_t> good = save(emu);
+    const uint8_t counter = emu.memory().internal_ram().read(0x10);
+
+    for (uint32_t offset : { 0x4000u, 0x0800u, 0xFFFFF000u }) { // past the 16 KB image, unaligned, wrapping
+        std::vector<uint8_t> state = good;
+        uint8_t* block = find_block(state, StateBlock::Memory);
+        CHECK(block != nullptr);
+        Memory::State mem;
+        std::memcpy(&mem, block, sizeof(mem));
+        mem.prg_offsets_[3] = offset;
+        std::memcpy(block, &mem, sizeof(mem));
+        emu.run_frame();
+        const uint8_t before = emu.memory().internal_ram().read(0x10);
+        CHECK(!emu.load_state(state.data(), state.size()));
+        CHECK(emu.memory().internal_ram().read(0x10) == before); // left untouched
+    }
+    CHECK(emu.load_state(good.data(), good.size()));
+    CHECK(emu.memory().internal_ram().read(0x10) == counter);
+}
+
+void test_rejects_bad_nametable_pages() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    const std::vector<uint8_t> good = save(emu);
+    const PPU::State before = emu.ppu().state();
+
+    std::vector<uint8_t> state = good;
+    uint8_t* block = find_block(state, StateBlock::Ppu);
+    CHECK(block != nullptr);
+    PPU::State ppu;
+    std::memcpy(&ppu, block, sizeof(ppu));
+    ppu.nametable_pages_[2] = 4; // one past the four VRAM pages
+    std::memcpy(block, &ppu, sizeof(ppu));
+    CHECK(!emu.load_state(state.data(), state.size()));
+    CHECK(emu.ppu().state().nametable_pages_ == before.nametable_pages_);
+
+    ppu.nametable_pages_[2] = 3;
+    ppu.mirroring_ = 0xFF;
+    std::memcpy(block, &ppu, sizeof(ppu));
+    CHECK(!emu.load_state(state.data(), state.size()));
+    CHECK(emu.load_state(good.data(), good.size()));
+}
+
+// `corrupt` edits a copy of the block with `tag`; the state must then be rejected and leave the emulator as it was
+template <typename F>
+void check_rejected(Emulator& emu, const std::vector<uint8_t>& good, StateBlock tag, F corrupt) {
+    std::vector<uint8_t> state = good;
+    uint8_t* block = find_block(state, tag);
+    CHECK(block != nullptr);
+    if (!block) return;
+    corrupt(block);
+    emu.run_frame();
+    const std::vector<uint8_t> before = save(emu);
+    CHECK(!emu.load_state(state.data(), state.size()));
+    CHECK(save(emu) == before);
+}
+
+void test_rejects_bad_scheduler_and_apu() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    const std::vector<uint8_t> good = save(emu);
+
+    // The scheduler block is the Scheduler itself: heap, per-type slots, size
+    check_rejected(emu, good, StateBlock::Scheduler, [](uint8_t* block) { std::memset(block, 0xFF, sizeof(Scheduler)); });
+    check_rejected(emu, good, StateBlock::Scheduler, [](uint8_t* block) { block[offsetof(Event, type)] = 0x7F; }); // heap_[0]
+    check_rejected(emu, good, StateBlock::Scheduler, [](uint8_t* block) {
+        const size_t slots = sizeof(Event) * static_cast<size_t>(EventType::Count);
+        block[slots + static_cast<size_t>(EventType::FrameEnd)] = 0x50; // slot index past the heap
+    });
+
+    check_rejected(emu, good, StateBlock::Apu, [](uint8_t* block) {
+        APU::State apu;
+        std::memcpy(&apu, block, sizeof(apu));
+        apu.pulse1_.duty_ = 4;
+        std::memcpy(block, &apu, sizeof(apu));
+    });
+    check_rejected(emu, good, StateBlock::Apu, [](uint8_t* block) {
+        APU::State apu;
+        std::memcpy(&apu, block, sizeof(apu));
+        apu.frame_mode_ = 0;
+        apu.frame_step_ = 4; // the five-step sequence's last step, in four-step mode
+        std::memcpy(block, &apu, sizeof(apu));
+    });
+    check_rejected(emu, good, StateBlock::Apu, [](uint8_t* block) {
+        APU::State apu;
+        std::memcpy(&apu, block, sizeof(apu));
+        apu.frame_step_ = -1;
+        std::memcpy(block, &apu, sizeof(apu));
+    });
+    CHECK(emu.load_state(good.data(), good.size()));
+}
+
+void test_rejects_bad_ppu_beam_and_sprites() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    const std::vector<uint8_t> good = save(emu);
+    auto with_ppu = [](auto edit) {
+        return [edit](uint8_t* block) {
+            PPU::State ppu;
+            std::memcpy(&ppu, block, sizeof(ppu));
+            edit(ppu);
+            std::memcpy(block, &ppu, sizeof(ppu));
+        };
+    };
+    check_rejected(emu, good, StateBlock::Ppu, with_ppu([](PPU::State& ppu) { ppu.scanline_ = 240 * 100; }));
+    check_rejected(emu, good, StateBlock::Ppu, with_ppu([](PPU::State& ppu) { ppu.scanline_ = -2; }));
+    check_rejected(emu, good, StateBlock::Ppu, with_ppu([](PPU::State& ppu) { ppu.cycle_ = 341; }));
+    check_rejected(emu, good, StateBlock::Ppu, with_ppu([](PPU::State& ppu) { ppu.sprite_count_ = 9; }));
+    check_rejected(emu, good, StateBlock::Ppu, with_ppu([](PPU::State& ppu) { ppu.sprite_count_ = -1; }));
+    CHECK(emu.load_state(good.data(), good.size()));
+}
+
+void test_state_file_is_opened_read_only() {
+    Emulator emu;
+    emu.load_rom_bytes(nes_test::counter_rom());
+    emu.run_frame();
+    const std::string path = "test_save_state.nst";
+    emu.save_state_file(path);
+    const std::vector<uint8_t> state = save(emu);
+    emu.run_frame();
+    emu.load_state_file(path);
+    CHECK(save(emu) == state);
+
+    Emulator other;
+    other.load_rom_bytes(nes_test::counter_rom(1));
+    bool rejected = false;
+    try { other.load_state_file(path); } catch (const std::runtime_error&) { rejected = true; }
+    CHECK(rejected);
+    ::unlink(path.c_str());
+}
+}
+
+int main() {
+    test_round_trip();
+    test_rejects_mismatches();
+    test_rejects_bad_prg_offsets();
+    test_rejects_bad_nametable_pages();
+    test_rejects_bad_scheduler_and_apu();
+    test_rejects_bad_ppu_beam_and_sprites();
+    test_state_file_is_opened_read_only();
+    return nes_test::result("save_state");
+}
@@ -0,0 +1,125 @@
+#include "test_util.h"
+#include "nes/shm_transport.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace nes;
+
+namespace {
+std::string segment_name(const char* test) {
+    return "/nes-test-" + std::string(test) + "-" + std::to_string(getpid());
+}
+
+ShmOptions options_for(const std::string& name, uint32_t slots = 4) {
+    ShmOptions options;
+    options.name = name;
+    options.slots = slots;
+    options.audio_capacity = 64;
+    return options;
+}
+
+std::vector<uint8_t> frame_of(uint8_t value) {
+    return std::vector<uint8_t>(ShmLayout::frame_bytes, value);
+}
+
+void test_existing_segment_is_not_replaced() {
+    const std::string name = segment_name("exclusive");
+    ShmPublisher first(options_for(name));
+    bool threw = false;
+    try { ShmPublisher second(options_for(name)); } catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+    // The first publisher's segment is untouched: a reader still finds it
+    first.publish(frame_of(7).data(), 1);
+    ShmReader reader(name);
+    CHECK(reader.sample_rate() == 44100);
+}
+
+void test_force_replaces_a_leftover_segment() {
+    const std::string name = segment_name("force");
+    ShmPublisher leftover(options_for(name));
+    ShmOptions options = options_for(name);
+    options.force = true;
+    ShmPublisher replacement(options);
+    CHECK(replacement.published() == 0);
+}
+
+void test_reader_follows_in_order_and_counts_missed() {
+    const std::string name = segment_name("order");
+    ShmPublisher publisher(options_for(name, 4));
+    ShmReader reader(name);
+    ShmFrame frame;
+    const int16_t audio[3] = { 1, 2, 3 };
+    publisher.publish(frame_of(1).data(), 10, audio, 3);
+    publisher.publish(frame_of(2).data(), 11);
+    CHECK(reader.next(frame, 0) == ShmReader::Result::Frame);
+    CHECK(frame.index == 0 && frame.frame_number == 10 && frame.missed == 0);
+    CHECK(frame.rgb == frame_of(1) && frame.audio.size() == 3 && frame.audio[2] == 3);
+    CHECK(reader.next(frame, 0) == ShmReader::Result::Frame);
+    CHECK(frame.frame_number == 11 && frame.audio.empty());
+    CHECK(reader.next(frame, 0) == ShmReader::Result::Timeout);
+
+    // Ten frames into a four-slot ring: only the newest three are safe to read, the rest are missed
+    for (uint8_t i = 0; i < 10; ++i) publisher.publish(frame_of(i).data(), 100 + i);
+    CHECK(reader.next(frame, 0) == ShmReader::Result::Frame);
+    CHECK(frame.frame_number == 107 && frame.missed == 7);
+    CHECK(frame.rgb == frame_of(7));
+}
+
+// A publisher thread rewrites the ring as fast as it can; every frame a reader accepts must be whole
+void test_concurrent_reads_are_never_torn() {
+    const std::string name = segment_name("torn");
+    ShmPublisher publisher(options_for(name, 2));
+    ShmReader reader(name);
+    std::atomic<bool> done{ false };
+    std::thread writer([&] {
+        std::vector<uint8_t> rgb(ShmLayout::frame_bytes);
+        for (uint64_t i = 0; i < 2000; ++i) {
+            std::fill(rgb.begin(), rgb.end(), static_cast<uint8_t>(i));
+            publisher.publish(rgb.data(), i);
+        }
+        done = true;
+    });
+    ShmFrame frame;
+    uint64_t frames = 0, missed = 0;
+    for (;;) {
+        const bool finished = done; // read before next(), so the last frames are drained too
+        if (reader.next(frame, 10) != ShmReader::Result::Frame) {
+            if (finished) break;
+            continue;
+        }
+        frames++;
+        missed += frame.missed;
+        const uint8_t expected = static_cast<uint8_t>(frame.frame_number);
+        bool whole = true;
+        for (uint8_t byte : frame.rgb) whole &= byte == expected;
+        CHECK(whole);
+        CHECK(frame.index == frame.frame_number);
+    }
+    writer.join();
+    CHECK(frames > 0);
+    CHECK(frames + missed <= 2000);
+}
+
+void test_close_is_seen_by_readers() {
+    const std::string name = segment_name("close");
+    auto publisher = std::make_unique<ShmPublisher>(options_for(name));
+    ShmReader reader(name);
+    publisher.reset();
+    ShmFrame frame;
+    CHECK(reader.next(frame, 1000) == ShmReader::Result::Closed);
+}
+}
+
+int main() {
+    test_existing_segment_is_not_replaced();
+    test_force_replaces_a_leftover_segment();
+    test_reader_follows_in_order_and_counts_missed();
+    test_concurrent_reads_are_never_torn();
+    test_close_is_seen_by_readers();
+    return nes_test::result("shm_transport");
+}
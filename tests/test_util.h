@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+#include "nes/rom_builder.h"
+
+// Minimal self-checking harness: each test binary runs its cases in main() and exits non-zero if any
+// CHECK failed, which is all CTest looks at.
+namespace nes_test {
+inline int& failures() { static int count = 0; return count; }
+inline int result(const char* name) {
+    if (failures()) std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+    else std::printf("%s: ok\n", name);
+    return failures() ? 1 : 0;
+}
+
+// NROM image whose reset code increments $10 forever; `marker` lands in PRG so images can differ
+inline std::vector<uint8_t> counter_rom(uint8_t marker = 0) {
+    using M = nes::AddrMode;
+    nes::Assembler a(0x8000);
+    a.label("reset").op("SEI").op("LDX", M::Immediate, 0xFF).op("TXS");
+    a.label("loop").op("INC", M::ZeroPage, 0x10).op("JMP", M::Absolute, "loop");
+    a.label("nmi").op("RTI");
+    a.byte(marker);
+    return nes::RomBuilder().place(a).vectors(a.address_of("nmi"), a.address_of("reset"), a.address_of("nmi")).build();
+}
+}
+
+#define CHECK(cond)                                                                         \
+    do {                                                                                    \
+        if (!(cond)) {                                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);   \
+            ++nes_test::failures();                                                         \
+        }                                                                                   \
+    } while (0)
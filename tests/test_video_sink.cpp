@@ -0,0 +1,86 @@
+#include "test_util.h"
+#include "nes/video_sink.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using namespace nes;
+
+namespace {
+constexpr size_t samples_per_frame = 735;
+constexpr size_t yuv_frame_bytes = 256 * 240 * 3 / 2;
+constexpr size_t wav_header_bytes = 44;
+
+size_t file_size(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    return in ? static_cast<size_t>(in.tellg()) : 0;
+}
+
+bool exists(const std::string& path) { return ::access(path.c_str(), F_OK) == 0; }
+
+// Frames in a Y4M file: a header line, then "FRAME\n" and one 4:2:0 image per frame
+size_t y4m_frames(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string header;
+    std::getline(in, header);
+    CHECK(header.rfind("YUV4MPEG2 ", 0) == 0);
+    const size_t body = file_size(path) - header.size() - 1;
+    CHECK(body % (6 + yuv_frame_bytes) == 0);
+    return body / (6 + yuv_frame_bytes);
+}
+
+// Frames drawn, skipped by the pacer (push_repeat) and unrecorded by the interval must all keep
+// the picture as long as the sound
+void check_video_matches_audio(unsigned frame_interval, size_t queue_frames) {
+    const std::string path = "test_video_sink_" + std::to_string(frame_interval) + ".y4m";
+    VideoSinkOptions options;
+    options.path = path;
+    options.audio_path = path + ".wav";
+    options.frame_interval = frame_interval;
+    options.queue_frames = queue_frames;
+    const std::vector<int16_t> audio(samples_per_frame, 100);
+    std::vector<uint8_t> rgb(256 * 240 * 3, 0x40);
+    constexpr size_t frames = 40;
+    {
+        VideoSink sink(options);
+        for (size_t i = 0; i < frames; ++i) {
+            if (i % 5 == 3) sink.push_repeat(audio.data(), audio.size()); // the pacer skipped it
+            else sink.push_frame(rgb, audio.data(), audio.size());
+        }
+        sink.close();
+        CHECK(sink.frames_written() == (frames + frame_interval - 1) / frame_interval);
+    }
+    const size_t video_frames = y4m_frames(path);
+    const size_t audio_samples = (file_size(options.audio_path) - wav_header_bytes) / sizeof(int16_t);
+    CHECK(audio_samples == frames * samples_per_frame);
+    CHECK(video_frames == (frames + frame_interval - 1) / frame_interval);
+    CHECK(video_frames * frame_interval * samples_per_frame >= audio_samples); // in step, not short
+    std::remove(path.c_str());
+    std::remove(options.audio_path.c_str());
+}
+
+void test_lengths_match() {
+    check_video_matches_audio(1, 16);
+    check_video_matches_audio(2, 16);
+    check_video_matches_audio(1, 1); // a one-slot ring also drops, and repeats, frames
+}
+
+void test_failed_open_leaves_no_files() {
+    VideoSinkOptions options;
+    options.path = "no-such-directory/out.y4m";
+    options.audio_path = "test_video_sink_orphan.wav";
+    bool threw = false;
+    try { VideoSink sink(options); } catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+    CHECK(!exists(options.audio_path));
+}
+}
+
+int main() {
+    test_lengths_match();
+    test_failed_open_leaves_no_files();
+    return nes_test::result("video_sink");
+}